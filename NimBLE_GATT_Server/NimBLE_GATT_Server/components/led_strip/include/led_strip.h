@@ -0,0 +1,255 @@
+/*
+ * SPDX-FileCopyrightText: 2022-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "led_strip_rmt.h"
+#include "esp_idf_version.h"
+
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 1, 0)
+#include "led_strip_spi.h"
+#include "led_strip_apa102.h"
+#include "led_strip_i80.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Set RGB for a specific pixel
+ *
+ * @param strip: LED strip
+ * @param index: index of pixel to set
+ * @param red: red part of color
+ * @param green: green part of color
+ * @param blue: blue part of color
+ *
+ * @return
+ *      - ESP_OK: Set RGB for a specific pixel successfully
+ *      - ESP_ERR_INVALID_ARG: Set RGB for a specific pixel failed because of invalid parameters
+ *      - ESP_FAIL: Set RGB for a specific pixel failed because other error occurred
+ */
+esp_err_t led_strip_set_pixel(led_strip_handle_t strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue);
+
+/**
+ * @brief Set RGBW for a specific pixel
+ *
+ * @note Only call this function if your led strip does have the white component (e.g. SK6812-RGBW)
+ * @note Also see `led_strip_set_pixel` if you only want to specify the RGB part of the color and bypass the white component
+ *
+ * @param strip: LED strip
+ * @param index: index of pixel to set
+ * @param red: red part of color
+ * @param green: green part of color
+ * @param blue: blue part of color
+ * @param white: separate white component
+ *
+ * @return
+ *      - ESP_OK: Set RGBW color for a specific pixel successfully
+ *      - ESP_ERR_INVALID_ARG: Set RGBW color for a specific pixel failed because of an invalid argument
+ *      - ESP_FAIL: Set RGBW color for a specific pixel failed because other error occurred
+ */
+esp_err_t led_strip_set_pixel_rgbw(led_strip_handle_t strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue, uint32_t white);
+
+/**
+ * @brief Set HSV for a specific pixel
+ *
+ * @param strip: LED strip
+ * @param index: index of pixel to set
+ * @param hue: hue part of color (0 - 360)
+ * @param saturation: saturation part of color (0 - 255, rescaled from 0 - 1. e.g. saturation = 0.5, rescaled to 127)
+ * @param value: value part of color (0 - 255, rescaled from 0 - 1. e.g. value = 0.5, rescaled to 127)
+ *
+ * @return
+ *      - ESP_OK: Set HSV color for a specific pixel successfully
+ *      - ESP_ERR_INVALID_ARG: Set HSV color for a specific pixel failed because of an invalid argument
+ *      - ESP_FAIL: Set HSV color for a specific pixel failed because other error occurred
+ */
+esp_err_t led_strip_set_pixel_hsv(led_strip_handle_t strip, uint32_t index, uint16_t hue, uint8_t saturation, uint8_t value);
+
+/**
+ * @brief Set HSV for a run of consecutive pixels
+ *
+ * @note Gives the same colors as calling `led_strip_set_pixel_hsv` for every pixel. The pixels are
+ *       converted 16 at a time into a buffer on the stack, which is handed to the backend like
+ *       `led_strip_set_pixels` (white set to 0 on RGBW strips)
+ * @note Stops at the first block of 16 pixels reaching outside the strip, the blocks before it are already set
+ *
+ * @param strip: LED strip
+ * @param start: index of the first pixel to set
+ * @param count: number of pixels to set
+ * @param hsv: pixel colors, count entries
+ *
+ * @return
+ *      - ESP_OK: Set HSV color for the pixels successfully
+ *      - ESP_ERR_INVALID_ARG: Set HSV color failed because of an invalid argument or the range exceeds the strip
+ *      - ESP_FAIL: Set HSV color failed because other error occurred
+ */
+esp_err_t led_strip_set_pixels_hsv(led_strip_handle_t strip, uint32_t start, uint32_t count, const led_strip_hsv_t *hsv);
+
+/**
+ * @brief Set a run of consecutive pixels from a packed buffer
+ *
+ * @note The buffer holds 3 bytes (red, green, blue) per pixel, or 4 bytes (red, green, blue, white)
+ *       if the strip was created with LED_PIXEL_FORMAT_GRBW
+ * @note The range is checked once, then the whole run is reordered / encoded in one pass,
+ *       which is much cheaper than calling `led_strip_set_pixel` for every pixel
+ *
+ * @param strip: LED strip
+ * @param start: index of the first pixel to set
+ * @param count: number of pixels to set
+ * @param pixels: pixel colors, count * 3 (or 4) bytes
+ *
+ * @return
+ *      - ESP_OK: Set pixels successfully
+ *      - ESP_ERR_INVALID_ARG: Set pixels failed because of an invalid argument or the range exceeds the strip
+ *      - ESP_FAIL: Set pixels failed because other error occurred
+ */
+esp_err_t led_strip_set_pixels(led_strip_handle_t strip, uint32_t start, uint32_t count, const uint8_t *pixels);
+
+/**
+ * @brief Set the first count pixels from a packed buffer and refresh the strip
+ *
+ * @note Same buffer layout as `led_strip_set_pixels`
+ *
+ * @param strip: LED strip
+ * @param pixels: pixel colors, count * 3 (or 4) bytes
+ * @param count: number of pixels in the frame
+ *
+ * @return
+ *      - ESP_OK: Write frame successfully
+ *      - ESP_ERR_INVALID_ARG: Write frame failed because of an invalid argument or the frame exceeds the strip
+ *      - ESP_FAIL: Write frame failed because other error occurred
+ */
+esp_err_t led_strip_write_frame(led_strip_handle_t strip, const uint8_t *pixels, uint32_t count);
+
+/**
+ * @brief Refresh memory colors to LEDs
+ *
+ * @param strip: LED strip
+ *
+ * @return
+ *      - ESP_OK: Refresh successfully
+ *      - ESP_FAIL: Refresh failed because some other error occurred
+ *
+ * @note:
+ *      After updating the LED colors in the memory, a following invocation of this API is needed to flush colors to strip.
+ */
+esp_err_t led_strip_refresh(led_strip_handle_t strip);
+
+/**
+ * @brief Start sending memory colors to LEDs and return without waiting for the transmission
+ *
+ * @note The frame is sent from a front buffer, `led_strip_set_pixel` and friends keep writing to a back buffer
+ *       that starts as a copy of the frame being sent. So the next frame can be rendered while this one is
+ *       on the wire, which takes about 30us per pixel.
+ * @note If the previous frame is still being sent, this function waits for it first.
+ * @note Backends that can't transmit asynchronously (RMT with ESP-IDF v4.x) fall back to `led_strip_refresh`.
+ *
+ * @param strip: LED strip
+ *
+ * @return
+ *      - ESP_OK: Refresh started successfully
+ *      - ESP_ERR_NO_MEM: Refresh failed because the front buffer could not be allocated
+ *      - ESP_FAIL: Refresh failed because some other error occurred
+ */
+esp_err_t led_strip_refresh_async(led_strip_handle_t strip);
+
+/**
+ * @brief Wait for the frame started by `led_strip_refresh_async` to be sent
+ *
+ * @param strip: LED strip
+ * @param timeout_ms: timeout value, -1 to wait forever
+ *
+ * @return
+ *      - ESP_OK: The frame is sent, or none was in flight
+ *      - ESP_ERR_INVALID_ARG: Wait failed because of an invalid argument
+ *      - ESP_ERR_TIMEOUT: The frame is still being sent after timeout_ms
+ */
+esp_err_t led_strip_wait_refresh_done(led_strip_handle_t strip, int32_t timeout_ms);
+
+/**
+ * @brief Register a callback run from ISR context whenever a frame has been sent to the LEDs
+ *
+ * @note Frames sent by `led_strip_refresh`, `led_strip_refresh_async` and `led_strip_clear` all count.
+ * @note The callback and everything it touches must be in IRAM if the driver ISR is placed in IRAM
+ *       (CONFIG_RMT_ISR_IRAM_SAFE, CONFIG_SPI_MASTER_ISR_IN_IRAM).
+ * @note Register it while no frame is in flight.
+ *
+ * @param strip: LED strip
+ * @param cb: callback, NULL to remove it
+ * @param user_ctx: passed to the callback
+ *
+ * @return
+ *      - ESP_OK: Register callback successfully
+ *      - ESP_ERR_INVALID_ARG: Register callback failed because of an invalid argument
+ *      - ESP_ERR_NOT_SUPPORTED: The backend has no frame done event (RMT with ESP-IDF v4.x)
+ */
+esp_err_t led_strip_register_frame_done_callback(led_strip_handle_t strip, led_strip_frame_done_cb_t cb, void *user_ctx);
+
+/**
+ * @brief Set the gamma table applied to every color written to the strip
+ *
+ * @note Colors are looked up while the backend fills its pixel buffer, so correction adds no extra
+ *       pass over the frame. The pixels already set are converted again, no need to set them again.
+ * @note Takes effect on the next refresh. E.g. a table for gamma 2.8: table[i] = 255 * powf(i / 255.0f, 2.8f) + 0.5f
+ *
+ * @param strip: LED strip
+ * @param table: 256 entries, copied; NULL for no gamma correction
+ *
+ * @return
+ *      - ESP_OK: Set gamma table successfully
+ *      - ESP_ERR_INVALID_ARG: Set gamma table failed because of an invalid argument
+ *      - ESP_ERR_NO_MEM: Set gamma table failed because of no memory for the color correction state
+ *      - ESP_ERR_NOT_SUPPORTED: The backend has no color correction (RMT with ESP-IDF v4.x)
+ */
+esp_err_t led_strip_set_gamma_table(led_strip_handle_t strip, const uint8_t *table);
+
+/**
+ * @brief Set the global brightness of the strip, applied after the gamma table
+ *
+ * @note Like the gamma table, applied while the pixel buffer is filled; the pixels already set are
+ *       scaled again, no need to set them again. Takes effect on the next refresh.
+ * @note The first gamma or brightness call allocates a copy of the uncorrected colors (one byte per color component)
+ *
+ * @param strip: LED strip
+ * @param brightness: 0-255, 255 for full brightness
+ *
+ * @return
+ *      - ESP_OK: Set brightness successfully
+ *      - ESP_ERR_INVALID_ARG: Set brightness failed because of an invalid argument
+ *      - ESP_ERR_NO_MEM: Set brightness failed because of no memory for the color correction state
+ *      - ESP_ERR_NOT_SUPPORTED: The backend has no color correction (RMT with ESP-IDF v4.x)
+ */
+esp_err_t led_strip_set_brightness(led_strip_handle_t strip, uint8_t brightness);
+
+/**
+ * @brief Clear LED strip (turn off all LEDs)
+ *
+ * @param strip: LED strip
+ *
+ * @return
+ *      - ESP_OK: Clear LEDs successfully
+ *      - ESP_FAIL: Clear LEDs failed because some other error occurred
+ */
+esp_err_t led_strip_clear(led_strip_handle_t strip);
+
+/**
+ * @brief Free LED strip resources
+ *
+ * @param strip: LED strip
+ *
+ * @return
+ *      - ESP_OK: Free resources successfully
+ *      - ESP_FAIL: Free resources failed because error occurred
+ */
+esp_err_t led_strip_del(led_strip_handle_t strip);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,54 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "driver/spi_master.h"
+#include "led_strip_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LED_STRIP_APA102_DEFAULT_CLOCK_HZ (10 * 1000 * 1000) /*!< Default clock of APA102 / SK9822 strips */
+
+/**
+ * @brief LED Strip clocked (APA102 / SK9822) specific configuration
+ */
+typedef struct {
+    spi_clock_source_t clk_src; /*!< SPI clock source */
+    spi_host_device_t spi_bus;  /*!< SPI bus ID. Which buses are available depends on the specific chip */
+    int clk_gpio_num;           /*!< GPIO number of the clock line, the data line is led_config->strip_gpio_num */
+    uint32_t clock_speed_hz;    /*!< Clock frequency, set to 0 for LED_STRIP_APA102_DEFAULT_CLOCK_HZ. Long strips may need a lower one */
+    struct {
+        uint32_t with_dma: 1;   /*!< Use DMA to transmit data */
+    } flags;                    /*!< Extra driver flags */
+} led_strip_apa102_config_t;
+
+/**
+ * @brief Create LED strip of clocked LEDs (APA102 / SK9822) based on SPI MOSI and SCLK
+ *
+ * @note led_config->led_model must be LED_MODEL_APA102 or LED_MODEL_SK9822. Every pixel is sent as one
+ *       32 bit word at the SPI clock, instead of the 3 SPI bits per bit of the single wire protocols.
+ * @note With LED_PIXEL_FORMAT_GRB every pixel runs at full global brightness. With LED_PIXEL_FORMAT_GRBW the
+ *       white component is the 5 bit global brightness of the pixel instead (0-255, the top 5 bits are used),
+ *       `led_strip_set_pixel` keeps the global brightness a pixel has.
+ *
+ * @param led_config LED strip configuration
+ * @param apa102_config Clocked LED specific configuration
+ * @param ret_strip Returned LED strip handle
+ * @return
+ *      - ESP_OK: create LED strip handle successfully
+ *      - ESP_ERR_INVALID_ARG: create LED strip handle failed because of invalid argument
+ *      - ESP_ERR_NO_MEM: create LED strip handle failed because of out of memory
+ *      - ESP_FAIL: create LED strip handle failed because some other error
+ */
+esp_err_t led_strip_new_apa102_device(const led_strip_config_t *led_config, const led_strip_apa102_config_t *apa102_config, led_strip_handle_t *ret_strip);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,50 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "led_strip_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LED_STRIP_I80_MAX_STRIPS 16 /*!< Strips driven by one parallel bus */
+
+/**
+ * @brief LED Strip parallel (i80 bus) specific configuration
+ */
+typedef struct {
+    size_t num_strips;          /*!< Number of strips driven in parallel, 1-16. Set to 0 for a single strip on led_config->strip_gpio_num */
+    int strip_gpio_nums[LED_STRIP_I80_MAX_STRIPS]; /*!< GPIO of each strip, used when num_strips is not 0 */
+    int clk_gpio_num;           /*!< Free GPIO that outputs the bus clock (i80 WR line), not connected to the strips */
+    int dc_gpio_num;            /*!< Free GPIO that outputs the i80 D/C line, not connected to the strips. The data lines without a strip are routed here too */
+} led_strip_i80_config_t;
+
+/**
+ * @brief Create LED strips sending in parallel from one DMA stream of the LCD peripheral (i80 bus)
+ *
+ * @note On ESP32 and ESP32-S2 the i80 bus is the I2S peripheral in LCD mode, on ESP32-S3 the LCD_CAM peripheral.
+ *       Up to 8 strips use an 8 bit bus, up to 16 a 16 bit bus.
+ * @note The returned handle covers all strips: pixel `i` of strip `n` has the index n * led_config->max_leds + i.
+ *       Every refresh sends all strips, which takes as long as sending one of them.
+ *
+ * @param led_config LED strip configuration, max_leds is the number of LEDs of each strip
+ * @param i80_config Parallel bus specific configuration
+ * @param ret_strip Returned LED strip handle
+ * @return
+ *      - ESP_OK: create LED strip handle successfully
+ *      - ESP_ERR_INVALID_ARG: create LED strip handle failed because of invalid argument
+ *      - ESP_ERR_NO_MEM: create LED strip handle failed because of out of memory
+ *      - ESP_FAIL: create LED strip handle failed because some other error
+ */
+esp_err_t led_strip_new_i80_device(const led_strip_config_t *led_config, const led_strip_i80_config_t *i80_config, led_strip_handle_t *ret_strip);
+
+#ifdef __cplusplus
+}
+#endif
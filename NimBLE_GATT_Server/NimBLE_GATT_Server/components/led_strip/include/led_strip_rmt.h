@@ -0,0 +1,151 @@
+/*
+ * SPDX-FileCopyrightText: 2022-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "led_strip_types.h"
+#include "esp_idf_version.h"
+
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+#include "driver/rmt_types.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief LED Strip RMT specific configuration
+ */
+typedef struct {
+#if ESP_IDF_VERSION < ESP_IDF_VERSION_VAL(5, 0, 0)
+    uint8_t rmt_channel;        /*!< Specify the channel number, the legacy RMT driver doesn't support channel allocator */
+#else // new driver supports specify the clock source and clock resolution
+    rmt_clock_source_t clk_src; /*!< RMT clock source */
+    uint32_t resolution_hz;     /*!< RMT tick resolution, if set to zero, a default resolution (10MHz) will be applied */
+#endif
+    size_t mem_block_symbols;   /*!< How many RMT symbols can one RMT channel hold at one time. Set to 0 will fallback to use the default size. */
+    struct {
+        uint32_t with_dma: 1;   /*!< Use DMA to transmit data */
+        uint32_t stream: 1;     /*!< Keep no pixel buffer, frames are rendered while they are sent by `led_strip_rmt_refresh_stream` (IDF v5.0 and later) */
+    } flags;                    /*!< Extra driver flags */
+} led_strip_rmt_config_t;
+
+/**
+ * @brief Create LED strip based on RMT TX channel
+ *
+ * @param led_config LED strip configuration
+ * @param rmt_config RMT specific configuration
+ * @param ret_strip Returned LED strip handle
+ * @return
+ *      - ESP_OK: create LED strip handle successfully
+ *      - ESP_ERR_INVALID_ARG: create LED strip handle failed because of invalid argument
+ *      - ESP_ERR_NO_MEM: create LED strip handle failed because of out of memory
+ *      - ESP_FAIL: create LED strip handle failed because some other error
+ */
+esp_err_t led_strip_new_rmt_device(const led_strip_config_t *led_config, const led_strip_rmt_config_t *rmt_config, led_strip_handle_t *ret_strip);
+
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+#define LED_STRIP_RMT_STREAM_CHUNK_PIXELS 16 /*!< Pixels rendered at a time while a frame is streamed */
+
+/**
+ * @brief Fill a run of pixels of a streamed frame, runs in ISR context while the frame is being sent
+ *
+ * @note Keep it short and don't block, the RMT channel runs out of symbols if the pixels come too late
+ *
+ * @param start: index of the first pixel
+ * @param count: number of pixels, at most LED_STRIP_RMT_STREAM_CHUNK_PIXELS
+ * @param pixels: packed RGB (or RGBW for LED_PIXEL_FORMAT_GRBW) pixels to fill
+ * @param user_ctx: user context from `led_strip_rmt_stream_source_t`
+ */
+typedef void (*led_strip_rmt_fill_cb_t)(uint32_t start, uint32_t count, uint8_t *pixels, void *user_ctx);
+
+/**
+ * @brief Source of the pixels of a streamed frame
+ */
+typedef struct {
+    const uint8_t *pixels;           /*!< Packed RGB / RGBW pixels of the whole strip, NULL to render them by fill_cb */
+    led_strip_rmt_fill_cb_t fill_cb; /*!< Renders the pixels when pixels is NULL. With both NULL the frame is black */
+    void *user_ctx;                  /*!< User context passed to fill_cb */
+} led_strip_rmt_stream_source_t;
+
+/**
+ * @brief Send a frame of a strip created with flags.stream, rendering the pixels from the source as they are sent
+ *
+ * @note The color order, gamma table and brightness are applied on the fly, a few pixels at a time,
+ *       so the strip needs no pixel buffer whatever its length.
+ * @note Returns once the frame has started. The source (and the pixels it points to) must stay valid until
+ *       the frame is sent, see `led_strip_wait_refresh_done` and `led_strip_register_frame_done_callback`.
+ * @note A streamed strip has no pixel buffer: `led_strip_set_pixel*`, `led_strip_refresh*` return ESP_ERR_INVALID_STATE,
+ *       `led_strip_clear` sends a black frame.
+ *
+ * @param strip LED strip created by `led_strip_new_rmt_device` with flags.stream
+ * @param source Pixel source, copied
+ * @return
+ *      - ESP_OK: Frame started successfully
+ *      - ESP_ERR_INVALID_ARG: Refresh failed because of invalid argument or the strip is not an RMT strip
+ *      - ESP_ERR_INVALID_STATE: Refresh failed because the strip was not created with flags.stream
+ *      - ESP_FAIL: Refresh failed because some other error occurred
+ */
+esp_err_t led_strip_rmt_refresh_stream(led_strip_handle_t strip, const led_strip_rmt_stream_source_t *source);
+
+/**
+ * @brief Group of RMT LED strips refreshed together
+ */
+typedef struct led_strip_rmt_group_t *led_strip_rmt_group_handle_t;
+
+/**
+ * @brief Group RMT LED strips so that they are refreshed in parallel
+ *
+ * @note On targets with SOC_RMT_SUPPORT_TX_SYNCHRO the channels are bound to an RMT sync manager and
+ *       start in the same clock cycle, on the others they are started one right after the other.
+ *       Either way the frame time of the group is the one of its longest strip.
+ * @note While grouped, the strips are refreshed with `led_strip_rmt_group_refresh` only:
+ *       `led_strip_refresh` / `led_strip_refresh_async` / `led_strip_del` return ESP_ERR_INVALID_STATE,
+ *       and `led_strip_clear` only clears the pixels until the next group refresh.
+ *
+ * @param strips Strips created by `led_strip_new_rmt_device` without flags.stream, each in at most one group
+ * @param num_strips Number of strips, up to the number of RMT TX channels
+ * @param ret_group Returned group handle
+ * @return
+ *      - ESP_OK: create group successfully
+ *      - ESP_ERR_INVALID_ARG: create group failed because of invalid argument or a strip is not a buffered RMT strip
+ *      - ESP_ERR_INVALID_STATE: create group failed because a strip is already in a group
+ *      - ESP_ERR_NO_MEM: create group failed because of out of memory
+ *      - ESP_FAIL: create group failed because some other error
+ */
+esp_err_t led_strip_new_rmt_group(const led_strip_handle_t *strips, size_t num_strips, led_strip_rmt_group_handle_t *ret_group);
+
+/**
+ * @brief Send the pixel buffers of all strips in the group and wait once until all of them are sent
+ *
+ * @note If a strip fails to start, the frames already queued for the strips before it are aborted
+ *       (or, without a sync manager, waited for), so the group can be refreshed again
+ *
+ * @param group Group handle
+ * @return
+ *      - ESP_OK: Refresh successfully
+ *      - ESP_ERR_INVALID_ARG: Refresh failed because of invalid argument
+ *      - ESP_FAIL: Refresh failed because some other error occurred
+ */
+esp_err_t led_strip_rmt_group_refresh(led_strip_rmt_group_handle_t group);
+
+/**
+ * @brief Delete the group, the strips are kept and can be refreshed on their own again
+ *
+ * @param group Group handle
+ * @return
+ *      - ESP_OK: delete group successfully
+ *      - ESP_ERR_INVALID_ARG: delete group failed because of invalid argument
+ *      - ESP_FAIL: delete group failed because some other error
+ */
+esp_err_t led_strip_rmt_group_del(led_strip_rmt_group_handle_t group);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -5,6 +5,7 @@
  */
 #pragma once
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -27,6 +28,8 @@ typedef enum {
 typedef enum {
     LED_MODEL_WS2812, /*!< LED strip model: WS2812 */
     LED_MODEL_SK6812, /*!< LED strip model: SK6812 */
+    LED_MODEL_APA102, /*!< LED strip model: APA102, clocked, only supported by `led_strip_new_apa102_device` */
+    LED_MODEL_SK9822, /*!< LED strip model: SK9822, clocked, only supported by `led_strip_new_apa102_device` */
     LED_MODEL_INVALID /*!< Invalid LED strip model */
 } led_model_t;
 
@@ -35,6 +38,24 @@ typedef enum {
  */
 typedef struct led_strip_t *led_strip_handle_t;
 
+/**
+ * @brief Frame done callback, runs in ISR context when a frame has been sent to the LEDs
+ *
+ * @param strip: LED strip
+ * @param user_ctx: user context passed to `led_strip_register_frame_done_callback`
+ * @return Whether a higher priority task has been woken up by this callback
+ */
+typedef bool (*led_strip_frame_done_cb_t)(led_strip_handle_t strip, void *user_ctx);
+
+/**
+ * @brief HSV color of one pixel
+ */
+typedef struct {
+    uint16_t hue;            /*!< Hue, 0-359 */
+    uint8_t saturation;      /*!< Saturation, 0-255 */
+    uint8_t value;           /*!< Value, 0-255 */
+} led_strip_hsv_t;
+
 /**
  * @brief LED Strip Configuration
  */
@@ -0,0 +1,194 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "led_strip_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct led_strip_t led_strip_t; /*!< Type of LED strip */
+
+/**
+ * @brief LED strip interface definition
+ */
+struct led_strip_t {
+    /**
+     * @brief Set RGB for a specific pixel
+     *
+     * @param strip: LED strip
+     * @param index: index of pixel to set
+     * @param red: red part of color
+     * @param green: green part of color
+     * @param blue: blue part of color
+     *
+     * @return
+     *      - ESP_OK: Set RGB for a specific pixel successfully
+     *      - ESP_ERR_INVALID_ARG: Set RGB for a specific pixel failed because of invalid parameters
+     *      - ESP_FAIL: Set RGB for a specific pixel failed because other error occurred
+     */
+    esp_err_t (*set_pixel)(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue);
+
+    /**
+     * @brief Set RGBW for a specific pixel. Similar to `set_pixel` but also set the white component
+     *
+     * @param strip: LED strip
+     * @param index: index of pixel to set
+     * @param red: red part of color
+     * @param green: green part of color
+     * @param blue: blue part of color
+     * @param white: separate white component
+     *
+     * @return
+     *      - ESP_OK: Set RGBW color for a specific pixel successfully
+     *      - ESP_ERR_INVALID_ARG: Set RGBW color for a specific pixel failed because of an invalid argument
+     *      - ESP_FAIL: Set RGBW color for a specific pixel failed because other error occurred
+     */
+    esp_err_t (*set_pixel_rgbw)(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue, uint32_t white);
+
+    /**
+     * @brief Set a run of consecutive pixels from a packed buffer
+     *
+     * @param strip: LED strip
+     * @param start: index of the first pixel to set
+     * @param count: number of pixels to set
+     * @param pixels: RGB bytes per pixel, or RGBW for strips with a white component
+     *
+     * @return
+     *      - ESP_OK: Set pixels successfully
+     *      - ESP_ERR_INVALID_ARG: Set pixels failed because the range exceeds the strip
+     *      - ESP_FAIL: Set pixels failed because other error occurred
+     */
+    esp_err_t (*set_pixels)(led_strip_t *strip, uint32_t start, uint32_t count, const uint8_t *pixels);
+
+    /**
+     * @brief Refresh memory colors to LEDs
+     *
+     * @param strip: LED strip
+     * @param timeout_ms: timeout value for refreshing task
+     *
+     * @return
+     *      - ESP_OK: Refresh successfully
+     *      - ESP_FAIL: Refresh failed because some other error occurred
+     *
+     * @note:
+     *      After updating the LED colors in the memory, a following invocation of this API is needed to flush colors to strip.
+     */
+    esp_err_t (*refresh)(led_strip_t *strip);
+
+    /**
+     * @brief Start sending memory colors to LEDs without waiting for the transmission to finish
+     *
+     * @param strip: LED strip
+     *
+     * @return
+     *      - ESP_OK: Refresh started successfully
+     *      - ESP_ERR_NO_MEM: Refresh failed because the front buffer could not be allocated
+     *      - ESP_FAIL: Refresh failed because some other error occurred
+     *
+     * @note:
+     *      Optional, backends without it fall back to `refresh`.
+     */
+    esp_err_t (*refresh_async)(led_strip_t *strip);
+
+    /**
+     * @brief Wait until no frame is being sent to the LEDs
+     *
+     * @param strip: LED strip
+     * @param timeout_ms: timeout value, -1 to wait forever
+     *
+     * @return
+     *      - ESP_OK: No frame in flight
+     *      - ESP_ERR_TIMEOUT: A frame is still being sent after timeout_ms
+     *
+     * @note:
+     *      Optional, backends without `refresh_async` never have a frame in flight.
+     */
+    esp_err_t (*wait_refresh_done)(led_strip_t *strip, int32_t timeout_ms);
+
+    /**
+     * @brief Set the callback run from ISR context whenever a frame has been sent
+     *
+     * @param strip: LED strip
+     * @param cb: callback, NULL to remove it
+     * @param user_ctx: passed to the callback
+     *
+     * @return
+     *      - ESP_OK: Register callback successfully
+     *
+     * @note:
+     *      Optional, the API returns ESP_ERR_NOT_SUPPORTED for backends without it.
+     */
+    esp_err_t (*register_frame_done_cb)(led_strip_t *strip, led_strip_frame_done_cb_t cb, void *user_ctx);
+
+    /**
+     * @brief Set the gamma table applied to every color byte written to the strip
+     *
+     * @param strip: LED strip
+     * @param table: 256 entries, copied; NULL for no gamma correction
+     *
+     * @return
+     *      - ESP_OK: Set gamma table successfully
+     *      - ESP_ERR_NO_MEM: Set gamma table failed because of no memory for the color correction state
+     *
+     * @note:
+     *      Optional, the API returns ESP_ERR_NOT_SUPPORTED for backends without it.
+     */
+    esp_err_t (*set_gamma_table)(led_strip_t *strip, const uint8_t *table);
+
+    /**
+     * @brief Set the brightness applied to every color byte written to the strip, after gamma
+     *
+     * @param strip: LED strip
+     * @param brightness: 0-255, 255 for full brightness
+     *
+     * @return
+     *      - ESP_OK: Set brightness successfully
+     *      - ESP_ERR_NO_MEM: Set brightness failed because of no memory for the color correction state
+     *
+     * @note:
+     *      Optional, the API returns ESP_ERR_NOT_SUPPORTED for backends without it.
+     */
+    esp_err_t (*set_brightness)(led_strip_t *strip, uint8_t brightness);
+
+    /**
+     * @brief Clear LED strip (turn off all LEDs)
+     *
+     * @param strip: LED strip
+     * @param timeout_ms: timeout value for clearing task
+     *
+     * @return
+     *      - ESP_OK: Clear LEDs successfully
+     *      - ESP_FAIL: Clear LEDs failed because some other error occurred
+     */
+    esp_err_t (*clear)(led_strip_t *strip);
+
+    /**
+     * @brief Free LED strip resources
+     *
+     * @param strip: LED strip
+     *
+     * @return
+     *      - ESP_OK: Free resources successfully
+     *      - ESP_FAIL: Free resources failed because error occurred
+     */
+    esp_err_t (*del)(led_strip_t *strip);
+
+    /**
+     * @brief Bytes per pixel in the buffer taken by `set_pixels`, 3 (RGB) or 4 (RGBW)
+     *
+     * @note:
+     *      Optional, with 0 the API sets converted colors (HSV) with `set_pixel` instead of in `set_pixels` blocks.
+     */
+    uint8_t bytes_per_pixel;
+};
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,363 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <sys/cdefs.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_attr.h"
+#include "esp_rom_gpio.h"
+#include "soc/spi_periph.h"
+#include "led_strip.h"
+#include "led_strip_interface.h"
+#include "led_strip_color.h"
+
+#define LED_STRIP_APA102_TRANS_QUEUE_SIZE 4
+// first byte of a pixel: 111 + 5 bit global brightness
+#define LED_STRIP_APA102_HEADER(level) (0xE0 | (level) >> 3)
+#define LED_STRIP_APA102_COLOR_MASK 0xFFFFFF00
+
+static const char *TAG = "led_strip_apa102";
+
+/*
+ * The frame is sent as it is stored, in 32 bit words:
+ *   - a start frame of 32 zero bits
+ *   - one word per pixel: header, blue, green, red (little endian, so the header goes out first)
+ *   - SK9822 only: 32 zero bits, which latch the colors now instead of at the next start frame
+ *   - an end frame of at least one clock per two pixels, as every LED delays the data by half a clock
+ */
+typedef struct {
+    led_strip_t base;
+    spi_host_device_t spi_host;
+    spi_device_handle_t spi_device;
+    spi_transaction_t trans;      // frame queued by refresh_async
+    bool trans_queued;            // trans is owned by the driver until its result is fetched
+    uint32_t mem_caps;
+    led_strip_frame_done_cb_t on_frame_done;
+    void *user_ctx;
+    uint32_t *frame;              // back buffer, written by set_pixel
+    uint32_t *tx_frame;           // front buffer of asynchronous refresh, allocated on first use
+    led_strip_color_t *color;     // gamma / brightness, NULL until the application sets one
+    uint32_t strip_len;
+    uint32_t frame_words;
+    uint8_t bytes_per_pixel;      // 4 if the application sets the global brightness of every pixel
+    uint32_t buf[];
+} led_strip_apa102_obj;
+
+static inline uint32_t led_strip_apa102_pixel(uint32_t header, uint8_t red, uint8_t green, uint8_t blue)
+{
+    return header | blue << 8 | green << 16 | (uint32_t)red << 24;
+}
+
+static void IRAM_ATTR led_strip_apa102_post_cb(spi_transaction_t *trans)
+{
+    led_strip_apa102_obj *apa102_strip = (led_strip_apa102_obj *)trans->user;
+    if (apa102_strip && apa102_strip->on_frame_done && apa102_strip->on_frame_done(&apa102_strip->base, apa102_strip->user_ctx)) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+// fetch the result of the frame queued by refresh_async, if any
+static esp_err_t led_strip_apa102_wait_queued(led_strip_apa102_obj *apa102_strip, TickType_t ticks)
+{
+    spi_transaction_t *done = NULL;
+    if (!apa102_strip->trans_queued) {
+        return ESP_OK;
+    }
+    esp_err_t ret = spi_device_get_trans_result(apa102_strip->spi_device, &done, ticks);
+    if (ret == ESP_OK) {
+        apa102_strip->trans_queued = false;
+    }
+    return ret;
+}
+
+static esp_err_t led_strip_apa102_set_pixel(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue)
+{
+    led_strip_apa102_obj *apa102_strip = __containerof(strip, led_strip_apa102_obj, base);
+    ESP_RETURN_ON_FALSE(index < apa102_strip->strip_len, ESP_ERR_INVALID_ARG, TAG, "index out of maximum number of LEDs");
+    led_strip_color_t *color = apa102_strip->color;
+    uint32_t *pixel = &apa102_strip->frame[1 + index];
+    uint32_t offset = index * 3;
+    // the pixel keeps its global brightness
+    *pixel = led_strip_apa102_pixel(*pixel & ~LED_STRIP_APA102_COLOR_MASK,
+                                    led_strip_color_apply(color, offset + 1, red),
+                                    led_strip_color_apply(color, offset + 0, green),
+                                    led_strip_color_apply(color, offset + 2, blue));
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_apa102_set_pixel_rgbw(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue, uint32_t white)
+{
+    led_strip_apa102_obj *apa102_strip = __containerof(strip, led_strip_apa102_obj, base);
+    ESP_RETURN_ON_FALSE(index < apa102_strip->strip_len, ESP_ERR_INVALID_ARG, TAG, "index out of maximum number of LEDs");
+    ESP_RETURN_ON_FALSE(apa102_strip->bytes_per_pixel == 4, ESP_ERR_INVALID_ARG, TAG, "wrong LED pixel format, expected 4 bytes per pixel");
+    led_strip_color_t *color = apa102_strip->color;
+    uint32_t offset = index * 3;
+    // white is the global brightness of the pixel, it isn't color corrected
+    apa102_strip->frame[1 + index] = led_strip_apa102_pixel(LED_STRIP_APA102_HEADER((uint8_t)white),
+                                                            led_strip_color_apply(color, offset + 1, red),
+                                                            led_strip_color_apply(color, offset + 0, green),
+                                                            led_strip_color_apply(color, offset + 2, blue));
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_apa102_set_pixels(led_strip_t *strip, uint32_t start, uint32_t count, const uint8_t *pixels)
+{
+    led_strip_apa102_obj *apa102_strip = __containerof(strip, led_strip_apa102_obj, base);
+    ESP_RETURN_ON_FALSE(count <= apa102_strip->strip_len && start <= apa102_strip->strip_len - count, ESP_ERR_INVALID_ARG, TAG, "pixel range out of maximum number of LEDs");
+    led_strip_color_t *color = apa102_strip->color;
+    uint8_t bytes_per_pixel = apa102_strip->bytes_per_pixel;
+    uint32_t offset = start * 3;
+    uint32_t *pixel = &apa102_strip->frame[1 + start];
+    // RGB(W) in, one word per pixel out
+    for (uint32_t i = 0; i < count; i++, pixels += bytes_per_pixel, offset += 3, pixel++) {
+        uint32_t header = bytes_per_pixel > 3 ? LED_STRIP_APA102_HEADER(pixels[3]) : LED_STRIP_APA102_HEADER(0xFF);
+        *pixel = led_strip_apa102_pixel(header,
+                                        led_strip_color_apply(color, offset + 1, pixels[0]),
+                                        led_strip_color_apply(color, offset + 0, pixels[1]),
+                                        led_strip_color_apply(color, offset + 2, pixels[2]));
+    }
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_apa102_refresh(led_strip_t *strip)
+{
+    led_strip_apa102_obj *apa102_strip = __containerof(strip, led_strip_apa102_obj, base);
+    spi_transaction_t tx_conf;
+    memset(&tx_conf, 0, sizeof(tx_conf));
+
+    // a blocking transmit must not be mixed with a queued one that is not finalized
+    ESP_RETURN_ON_ERROR(led_strip_apa102_wait_queued(apa102_strip, portMAX_DELAY), TAG, "wait for queued frame failed");
+    tx_conf.length = apa102_strip->frame_words * 32;
+    tx_conf.tx_buffer = apa102_strip->frame;
+    tx_conf.user = apa102_strip;
+    ESP_RETURN_ON_ERROR(spi_device_transmit(apa102_strip->spi_device, &tx_conf), TAG, "transmit pixels by SPI failed");
+
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_apa102_refresh_async(led_strip_t *strip)
+{
+    led_strip_apa102_obj *apa102_strip = __containerof(strip, led_strip_apa102_obj, base);
+    size_t frame_size = apa102_strip->frame_words * sizeof(uint32_t);
+
+    // the front buffer is only needed once the application renders during transmission
+    if (!apa102_strip->tx_frame) {
+        apa102_strip->tx_frame = heap_caps_malloc(frame_size, apa102_strip->mem_caps);
+        ESP_RETURN_ON_FALSE(apa102_strip->tx_frame, ESP_ERR_NO_MEM, TAG, "no mem for front buffer");
+    }
+
+    // the previous frame has left the front buffer once its result is back
+    ESP_RETURN_ON_ERROR(led_strip_apa102_wait_queued(apa102_strip, portMAX_DELAY), TAG, "wait for queued frame failed");
+    uint32_t *front = apa102_strip->frame;
+    apa102_strip->frame = apa102_strip->tx_frame;
+    apa102_strip->tx_frame = front;
+    // the new back buffer starts from the frame just queued, so partial updates keep working
+    memcpy(apa102_strip->frame, front, frame_size);
+
+    memset(&apa102_strip->trans, 0, sizeof(apa102_strip->trans));
+    apa102_strip->trans.length = frame_size * 8;
+    apa102_strip->trans.tx_buffer = front;
+    apa102_strip->trans.user = apa102_strip;
+    ESP_RETURN_ON_ERROR(spi_device_queue_trans(apa102_strip->spi_device, &apa102_strip->trans, portMAX_DELAY), TAG, "queue pixels by SPI failed");
+    apa102_strip->trans_queued = true;
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_apa102_wait_refresh_done(led_strip_t *strip, int32_t timeout_ms)
+{
+    led_strip_apa102_obj *apa102_strip = __containerof(strip, led_strip_apa102_obj, base);
+    return led_strip_apa102_wait_queued(apa102_strip, timeout_ms < 0 ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms));
+}
+
+static esp_err_t led_strip_apa102_register_frame_done_cb(led_strip_t *strip, led_strip_frame_done_cb_t cb, void *user_ctx)
+{
+    led_strip_apa102_obj *apa102_strip = __containerof(strip, led_strip_apa102_obj, base);
+    apa102_strip->on_frame_done = cb;
+    apa102_strip->user_ctx = user_ctx;
+    return ESP_OK;
+}
+
+// the color correction state starts from the colors already in the frame, in GRB order
+static esp_err_t led_strip_apa102_get_color(led_strip_apa102_obj *apa102_strip, led_strip_color_t **ret_color)
+{
+    if (!apa102_strip->color) {
+        apa102_strip->color = led_strip_color_new(apa102_strip->strip_len * 3);
+        ESP_RETURN_ON_FALSE(apa102_strip->color, ESP_ERR_NO_MEM, TAG, "no mem for color correction");
+        uint8_t *raw = apa102_strip->color->raw;
+        for (uint32_t i = 0; i < apa102_strip->strip_len; i++, raw += 3) {
+            uint32_t pixel = apa102_strip->frame[1 + i];
+            raw[0] = pixel >> 16;
+            raw[1] = pixel >> 24;
+            raw[2] = pixel >> 8;
+        }
+    }
+    *ret_color = apa102_strip->color;
+    return ESP_OK;
+}
+
+// write the stored colors again through the new table, the global brightness of every pixel stays
+static void led_strip_apa102_apply_color(led_strip_apa102_obj *apa102_strip)
+{
+    const led_strip_color_t *color = apa102_strip->color;
+    const uint8_t *raw = color->raw;
+    uint32_t *pixel = &apa102_strip->frame[1];
+    for (uint32_t i = 0; i < apa102_strip->strip_len; i++, raw += 3, pixel++) {
+        *pixel = led_strip_apa102_pixel(*pixel & ~LED_STRIP_APA102_COLOR_MASK, color->lut[raw[1]], color->lut[raw[0]], color->lut[raw[2]]);
+    }
+}
+
+static esp_err_t led_strip_apa102_set_gamma_table(led_strip_t *strip, const uint8_t *table)
+{
+    led_strip_apa102_obj *apa102_strip = __containerof(strip, led_strip_apa102_obj, base);
+    led_strip_color_t *color = NULL;
+    ESP_RETURN_ON_ERROR(led_strip_apa102_get_color(apa102_strip, &color), TAG, "set gamma table failed");
+    led_strip_color_set_gamma(color, table);
+    led_strip_apa102_apply_color(apa102_strip);
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_apa102_set_brightness(led_strip_t *strip, uint8_t brightness)
+{
+    led_strip_apa102_obj *apa102_strip = __containerof(strip, led_strip_apa102_obj, base);
+    led_strip_color_t *color = NULL;
+    ESP_RETURN_ON_ERROR(led_strip_apa102_get_color(apa102_strip, &color), TAG, "set brightness failed");
+    led_strip_color_set_brightness(color, brightness);
+    led_strip_apa102_apply_color(apa102_strip);
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_apa102_clear(led_strip_t *strip)
+{
+    led_strip_apa102_obj *apa102_strip = __containerof(strip, led_strip_apa102_obj, base);
+    // black with the global brightness of every pixel kept
+    uint32_t *pixel = &apa102_strip->frame[1];
+    for (uint32_t i = 0; i < apa102_strip->strip_len; i++) {
+        pixel[i] &= ~LED_STRIP_APA102_COLOR_MASK;
+    }
+    if (apa102_strip->color) {
+        memset(apa102_strip->color->raw, 0, apa102_strip->strip_len * 3);
+    }
+
+    return led_strip_apa102_refresh(strip);
+}
+
+static esp_err_t led_strip_apa102_del(led_strip_t *strip)
+{
+    led_strip_apa102_obj *apa102_strip = __containerof(strip, led_strip_apa102_obj, base);
+
+    // let the last frame go out before removing the device
+    ESP_RETURN_ON_ERROR(led_strip_apa102_wait_queued(apa102_strip, portMAX_DELAY), TAG, "wait for queued frame failed");
+    ESP_RETURN_ON_ERROR(spi_bus_remove_device(apa102_strip->spi_device), TAG, "delete spi device failed");
+    ESP_RETURN_ON_ERROR(spi_bus_free(apa102_strip->spi_host), TAG, "free spi bus failed");
+
+    // tx_frame may point into buf after a swap, free whichever buffer was allocated separately
+    free(apa102_strip->frame == apa102_strip->buf ? apa102_strip->tx_frame : apa102_strip->frame);
+    free(apa102_strip->color);
+    free(apa102_strip);
+    return ESP_OK;
+}
+
+esp_err_t led_strip_new_apa102_device(const led_strip_config_t *led_config, const led_strip_apa102_config_t *apa102_config, led_strip_handle_t *ret_strip)
+{
+    led_strip_apa102_obj *apa102_strip = NULL;
+    esp_err_t ret = ESP_OK;
+    ESP_GOTO_ON_FALSE(led_config && apa102_config && ret_strip, ESP_ERR_INVALID_ARG, err, TAG, "invalid argument");
+    ESP_GOTO_ON_FALSE(led_config->led_pixel_format < LED_PIXEL_FORMAT_INVALID, ESP_ERR_INVALID_ARG, err, TAG, "invalid led_pixel_format");
+    ESP_GOTO_ON_FALSE(led_config->led_model == LED_MODEL_APA102 || led_config->led_model == LED_MODEL_SK9822, ESP_ERR_INVALID_ARG, err, TAG, "invalid led model");
+    uint8_t bytes_per_pixel = 3;
+    if (led_config->led_pixel_format == LED_PIXEL_FORMAT_GRBW) {
+        bytes_per_pixel = 4;
+    } else if (led_config->led_pixel_format == LED_PIXEL_FORMAT_GRB) {
+        bytes_per_pixel = 3;
+    } else {
+        assert(false);
+    }
+    uint32_t frame_words = 1 + led_config->max_leds + (led_config->max_leds + 63) / 64;
+    if (led_config->led_model == LED_MODEL_SK9822) {
+        frame_words += 1;
+    }
+    uint32_t mem_caps = MALLOC_CAP_DEFAULT;
+    if (apa102_config->flags.with_dma) {
+        // DMA buffer must be placed in internal SRAM
+        mem_caps |= MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA;
+    }
+    apa102_strip = heap_caps_calloc(1, sizeof(led_strip_apa102_obj) + frame_words * sizeof(uint32_t), mem_caps);
+    ESP_GOTO_ON_FALSE(apa102_strip, ESP_ERR_NO_MEM, err, TAG, "no mem for apa102 strip");
+    apa102_strip->frame = apa102_strip->buf;
+    apa102_strip->frame_words = frame_words;
+    apa102_strip->mem_caps = mem_caps;
+    // start and end frames stay zero, the pixels start black at full global brightness
+    for (uint32_t i = 0; i < led_config->max_leds; i++) {
+        apa102_strip->frame[1 + i] = LED_STRIP_APA102_HEADER(0xFF);
+    }
+
+    apa102_strip->spi_host = apa102_config->spi_bus;
+    // for backward compatibility, if the user does not set the clk_src, use the default value
+    spi_clock_source_t clk_src = SPI_CLK_SRC_DEFAULT;
+    if (apa102_config->clk_src) {
+        clk_src = apa102_config->clk_src;
+    }
+
+    spi_bus_config_t spi_bus_cfg = {
+        .mosi_io_num = led_config->strip_gpio_num,
+        .miso_io_num = -1,
+        .sclk_io_num = apa102_config->clk_gpio_num,
+        .quadwp_io_num = -1,
+        .quadhd_io_num = -1,
+        .max_transfer_sz = frame_words * sizeof(uint32_t),
+    };
+    ESP_GOTO_ON_ERROR(spi_bus_initialize(apa102_strip->spi_host, &spi_bus_cfg, apa102_config->flags.with_dma ? SPI_DMA_CH_AUTO : SPI_DMA_DISABLED), err, TAG, "create SPI bus failed");
+
+    if (led_config->flags.invert_out == true) {
+        esp_rom_gpio_connect_out_signal(led_config->strip_gpio_num, spi_periph_signal[apa102_strip->spi_host].spid_out, true, false);
+    }
+
+    spi_device_interface_config_t spi_dev_cfg = {
+        .clock_source = clk_src,
+        .command_bits = 0,
+        .address_bits = 0,
+        .dummy_bits = 0,
+        .clock_speed_hz = apa102_config->clock_speed_hz ? apa102_config->clock_speed_hz : LED_STRIP_APA102_DEFAULT_CLOCK_HZ,
+        // the LEDs sample the data on the rising clock edge
+        .mode = 0,
+        //set -1 when CS is not used
+        .spics_io_num = -1,
+        .queue_size = LED_STRIP_APA102_TRANS_QUEUE_SIZE,
+        .post_cb = led_strip_apa102_post_cb,
+    };
+    ESP_GOTO_ON_ERROR(spi_bus_add_device(apa102_strip->spi_host, &spi_dev_cfg, &apa102_strip->spi_device), err, TAG, "Failed to add spi device");
+
+    apa102_strip->bytes_per_pixel = bytes_per_pixel;
+    apa102_strip->strip_len = led_config->max_leds;
+    apa102_strip->base.set_pixel = led_strip_apa102_set_pixel;
+    apa102_strip->base.set_pixel_rgbw = led_strip_apa102_set_pixel_rgbw;
+    apa102_strip->base.set_pixels = led_strip_apa102_set_pixels;
+    // a white byte in set_pixels is the pixel brightness, which set_pixel keeps
+    apa102_strip->base.bytes_per_pixel = bytes_per_pixel == 3 ? 3 : 0;
+    apa102_strip->base.refresh = led_strip_apa102_refresh;
+    apa102_strip->base.refresh_async = led_strip_apa102_refresh_async;
+    apa102_strip->base.wait_refresh_done = led_strip_apa102_wait_refresh_done;
+    apa102_strip->base.register_frame_done_cb = led_strip_apa102_register_frame_done_cb;
+    apa102_strip->base.set_gamma_table = led_strip_apa102_set_gamma_table;
+    apa102_strip->base.set_brightness = led_strip_apa102_set_brightness;
+    apa102_strip->base.clear = led_strip_apa102_clear;
+    apa102_strip->base.del = led_strip_apa102_del;
+
+    *ret_strip = &apa102_strip->base;
+    return ESP_OK;
+err:
+    if (apa102_strip) {
+        if (apa102_strip->spi_device) {
+            spi_bus_remove_device(apa102_strip->spi_device);
+        }
+        if (apa102_strip->spi_host) {
+            spi_bus_free(apa102_strip->spi_host);
+        }
+        free(apa102_strip);
+    }
+    return ret;
+}
@@ -0,0 +1,136 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "esp_log.h"
+#include "esp_check.h"
+#include "led_strip.h"
+#include "led_strip_interface.h"
+#include "led_strip_hsv.h"
+
+#define LED_STRIP_HSV_BLOCK_PIXELS 16
+
+static const char *TAG = "led_strip";
+
+esp_err_t led_strip_set_pixel(led_strip_handle_t strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue)
+{
+    ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    return strip->set_pixel(strip, index, red, green, blue);
+}
+
+esp_err_t led_strip_set_pixel_hsv(led_strip_handle_t strip, uint32_t index, uint16_t hue, uint8_t saturation, uint8_t value)
+{
+    ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+
+    uint8_t rgb[3];
+    led_strip_hsv2rgb(hue, saturation, value, rgb);
+    return strip->set_pixel(strip, index, rgb[0], rgb[1], rgb[2]);
+}
+
+esp_err_t led_strip_set_pixels_hsv(led_strip_handle_t strip, uint32_t start, uint32_t count, const led_strip_hsv_t *hsv)
+{
+    ESP_RETURN_ON_FALSE(strip && hsv, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    uint8_t bytes_per_pixel = strip->bytes_per_pixel;
+    if (bytes_per_pixel != 3 && bytes_per_pixel != 4) {
+        uint8_t rgb[3];
+        for (uint32_t i = 0; i < count; i++, hsv++) {
+            led_strip_hsv2rgb(hsv->hue, hsv->saturation, hsv->value, rgb);
+            ESP_RETURN_ON_ERROR(strip->set_pixel(strip, start + i, rgb[0], rgb[1], rgb[2]), TAG, "set pixel %"PRIu32" failed", start + i);
+        }
+        return ESP_OK;
+    }
+
+    // convert a block on the stack, then let the backend reorder / encode it in one pass
+    uint8_t block[LED_STRIP_HSV_BLOCK_PIXELS * 4];
+    while (count > 0) {
+        uint32_t n = count < LED_STRIP_HSV_BLOCK_PIXELS ? count : LED_STRIP_HSV_BLOCK_PIXELS;
+        uint8_t *pixel = block;
+        for (uint32_t i = 0; i < n; i++, hsv++, pixel += bytes_per_pixel) {
+            led_strip_hsv2rgb(hsv->hue, hsv->saturation, hsv->value, pixel);
+            if (bytes_per_pixel > 3) {
+                pixel[3] = 0;
+            }
+        }
+        ESP_RETURN_ON_ERROR(strip->set_pixels(strip, start, n, block), TAG, "set pixels %"PRIu32"-%"PRIu32" failed", start, start + n - 1);
+        start += n;
+        count -= n;
+    }
+    return ESP_OK;
+}
+
+esp_err_t led_strip_set_pixel_rgbw(led_strip_handle_t strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue, uint32_t white)
+{
+    ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    return strip->set_pixel_rgbw(strip, index, red, green, blue, white);
+}
+
+esp_err_t led_strip_set_pixels(led_strip_handle_t strip, uint32_t start, uint32_t count, const uint8_t *pixels)
+{
+    ESP_RETURN_ON_FALSE(strip && pixels, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    return strip->set_pixels(strip, start, count, pixels);
+}
+
+esp_err_t led_strip_write_frame(led_strip_handle_t strip, const uint8_t *pixels, uint32_t count)
+{
+    ESP_RETURN_ON_FALSE(strip && pixels, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    ESP_RETURN_ON_ERROR(strip->set_pixels(strip, 0, count, pixels), TAG, "set pixels failed");
+    return strip->refresh(strip);
+}
+
+esp_err_t led_strip_refresh(led_strip_handle_t strip)
+{
+    ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    return strip->refresh(strip);
+}
+
+esp_err_t led_strip_refresh_async(led_strip_handle_t strip)
+{
+    ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    if (!strip->refresh_async) {
+        return strip->refresh(strip);
+    }
+    return strip->refresh_async(strip);
+}
+
+esp_err_t led_strip_wait_refresh_done(led_strip_handle_t strip, int32_t timeout_ms)
+{
+    ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    if (!strip->wait_refresh_done) {
+        return ESP_OK;
+    }
+    return strip->wait_refresh_done(strip, timeout_ms);
+}
+
+esp_err_t led_strip_register_frame_done_callback(led_strip_handle_t strip, led_strip_frame_done_cb_t cb, void *user_ctx)
+{
+    ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    ESP_RETURN_ON_FALSE(strip->register_frame_done_cb, ESP_ERR_NOT_SUPPORTED, TAG, "frame done callback not supported");
+    return strip->register_frame_done_cb(strip, cb, user_ctx);
+}
+
+esp_err_t led_strip_set_gamma_table(led_strip_handle_t strip, const uint8_t *table)
+{
+    ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    ESP_RETURN_ON_FALSE(strip->set_gamma_table, ESP_ERR_NOT_SUPPORTED, TAG, "gamma table not supported");
+    return strip->set_gamma_table(strip, table);
+}
+
+esp_err_t led_strip_set_brightness(led_strip_handle_t strip, uint8_t brightness)
+{
+    ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    ESP_RETURN_ON_FALSE(strip->set_brightness, ESP_ERR_NOT_SUPPORTED, TAG, "brightness not supported");
+    return strip->set_brightness(strip, brightness);
+}
+
+esp_err_t led_strip_clear(led_strip_handle_t strip)
+{
+    ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    return strip->clear(strip);
+}
+
+esp_err_t led_strip_del(led_strip_handle_t strip)
+{
+    ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    return strip->del(strip);
+}
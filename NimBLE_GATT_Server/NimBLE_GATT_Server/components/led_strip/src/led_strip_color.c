@@ -0,0 +1,45 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "led_strip_color.h"
+
+static void led_strip_color_build(led_strip_color_t *color)
+{
+    for (int i = 0; i < 256; i++) {
+        // rounded, so full brightness leaves the gamma table unchanged
+        color->lut[i] = (color->gamma[i] * color->brightness + 127) / 255;
+    }
+}
+
+led_strip_color_t *led_strip_color_new(size_t raw_len)
+{
+    led_strip_color_t *color = calloc(1, sizeof(led_strip_color_t) + raw_len);
+    if (!color) {
+        return NULL;
+    }
+    color->brightness = 255;
+    led_strip_color_set_gamma(color, NULL);
+    return color;
+}
+
+void led_strip_color_set_gamma(led_strip_color_t *color, const uint8_t *gamma)
+{
+    if (gamma) {
+        memcpy(color->gamma, gamma, sizeof(color->gamma));
+    } else {
+        for (int i = 0; i < 256; i++) {
+            color->gamma[i] = i;
+        }
+    }
+    led_strip_color_build(color);
+}
+
+void led_strip_color_set_brightness(led_strip_color_t *color, uint8_t brightness)
+{
+    color->brightness = brightness;
+    led_strip_color_build(color);
+}
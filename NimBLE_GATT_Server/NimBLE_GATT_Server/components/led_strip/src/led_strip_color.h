@@ -0,0 +1,72 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Color correction state of a strip, allocated on the first gamma / brightness change
+ *
+ * The backend keeps the colors as the application set them in `raw`, in the byte order of its
+ * pixel buffer, and writes `lut[raw]` to the pixel buffer. So a new table only has to be
+ * reapplied to the stored frame, the application doesn't have to set the pixels again.
+ */
+typedef struct {
+    uint8_t lut[256];        // gamma, then brightness
+    uint8_t gamma[256];      // identity unless the application set a table
+    uint8_t brightness;
+    uint8_t raw[];           // uncorrected color bytes, one per pixel buffer color byte
+} led_strip_color_t;
+
+/**
+ * @brief Allocate the color correction state with an identity table
+ *
+ * @param[in] raw_len Number of color bytes of the strip (pixels * bytes per pixel)
+ * @return Color correction state, NULL if out of memory
+ */
+led_strip_color_t *led_strip_color_new(size_t raw_len);
+
+/**
+ * @brief Set the gamma table and rebuild the lookup table
+ *
+ * @param[in] color Color correction state
+ * @param[in] gamma 256 entry table, copied; NULL for identity
+ */
+void led_strip_color_set_gamma(led_strip_color_t *color, const uint8_t *gamma);
+
+/**
+ * @brief Set the brightness and rebuild the lookup table
+ *
+ * @param[in] color Color correction state
+ * @param[in] brightness 0-255, 255 keeps the gamma corrected colors as they are
+ */
+void led_strip_color_set_brightness(led_strip_color_t *color, uint8_t brightness);
+
+/**
+ * @brief Record a color byte and return the corrected one to write to the pixel buffer
+ *
+ * @param[in] color Color correction state, NULL if color correction is off
+ * @param[in] offset Color byte index, pixel * bytes per pixel + component
+ * @param[in] value Color byte from the application
+ * @return Color byte to write
+ */
+static inline uint8_t led_strip_color_apply(led_strip_color_t *color, uint32_t offset, uint8_t value)
+{
+    if (!color) {
+        return value;
+    }
+    color->raw[offset] = value;
+    return color->lut[value];
+}
+
+#ifdef __cplusplus
+}
+#endif
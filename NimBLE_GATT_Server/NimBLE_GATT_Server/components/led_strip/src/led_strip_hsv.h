@@ -0,0 +1,55 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Convert HSV to RGB with integer arithmetic only
+ *
+ * Hue is split into a 60 degree sector and the offset inside it, every hue from 360 up
+ * falls into the last sector. The divisions by 255 and by 60 are done by multiplying with
+ * a reciprocal, which is exact over the whole input range (checked exhaustively by the
+ * host test in host/led_strip_hsv_bench.c), so there is no floating point and no divide
+ * instruction on any target. The sector picks the channel levels from a table, not a branch.
+ *
+ * @param[in] hue Hue, 0-359 (larger values behave as in the last sector)
+ * @param[in] saturation Saturation, 0-255
+ * @param[in] value Value, 0-255
+ * @param[out] rgb Red, green and blue
+ */
+static inline void led_strip_hsv2rgb(uint16_t hue, uint8_t saturation, uint8_t value, uint8_t rgb[3])
+{
+    uint32_t rgb_max = value;
+    // floor(x / 255) for x <= 65025
+    uint32_t rgb_min = (rgb_max * (255 - saturation) * 0x8081U) >> 23;
+
+    // floor(hue / 60) for any 16 bit hue
+    uint32_t i = ((uint32_t)hue * 34953U) >> 21;
+    uint32_t diff = hue - i * 60;
+
+    // RGB adjustment amount by hue, same reciprocal as above
+    uint32_t rgb_adj = ((rgb_max - rgb_min) * diff * 34953U) >> 21;
+
+    // which of max, min, rising and falling edge goes to red, green and blue in each sector
+    static const uint8_t sector_map[6][3] = {
+        {0, 2, 1}, {3, 0, 1}, {1, 0, 2}, {1, 3, 0}, {2, 1, 0}, {0, 1, 3},
+    };
+    const uint8_t *map = sector_map[i < 5 ? i : 5];
+    uint8_t level[4] = {rgb_max, rgb_min, rgb_min + rgb_adj, rgb_max - rgb_adj};
+
+    rgb[0] = level[map[0]];
+    rgb[1] = level[map[1]];
+    rgb[2] = level[map[2]];
+}
+
+#ifdef __cplusplus
+}
+#endif
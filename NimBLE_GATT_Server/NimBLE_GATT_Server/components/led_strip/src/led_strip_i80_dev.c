@@ -0,0 +1,364 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <sys/cdefs.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_lcd_panel_io.h"
+#include "led_strip.h"
+#include "led_strip_interface.h"
+#include "led_strip_color.h"
+#include "led_strip_i80_transpose.h"
+
+// 3 bus cycles per color bit, as the SPI backend: 100 for 0, 110 for 1, 400ns each
+#define LED_STRIP_I80_PCLK_HZ (2500 * 1000)
+#define LED_STRIP_I80_CYCLES_PER_BIT 3
+#define LED_STRIP_I80_CYCLES_PER_COLOR_BYTE (LED_STRIP_I80_CYCLES_PER_BIT * 8)
+// 280us low after the frame, see the reset time of the SPI backend
+#define LED_STRIP_I80_RESET_CYCLES (280 * LED_STRIP_I80_PCLK_HZ / 1000000)
+#define LED_STRIP_I80_TRANS_QUEUE_SIZE 4
+
+static const char *TAG = "led_strip_i80";
+
+typedef struct {
+    led_strip_t base;
+    esp_lcd_i80_bus_handle_t bus;
+    esp_lcd_panel_io_handle_t io;
+    SemaphoreHandle_t frame_done; // available while no frame is on the wire
+    led_strip_frame_done_cb_t on_frame_done;
+    void *user_ctx;
+    led_strip_color_t *color;     // gamma / brightness, NULL until the application sets one
+    uint8_t *dma_buf;             // bit planes of all strips, encoded by refresh
+    size_t dma_len;
+    uint16_t high_lines;          // data lines with a strip, driven high in the first cycle of every bit
+    uint8_t bus_bytes;            // 1 for an 8 bit bus, 2 for a 16 bit one
+    uint8_t num_strips;
+    uint32_t leds_per_strip;
+    uint32_t strip_len;           // pixels of all strips together
+    uint8_t bytes_per_pixel;
+    uint8_t pixel_buf[];          // GRB(W) of strip 0, then strip 1, ...
+} led_strip_i80_obj;
+
+static bool IRAM_ATTR led_strip_i80_trans_done(esp_lcd_panel_io_handle_t io, esp_lcd_panel_io_event_data_t *edata, void *user_ctx)
+{
+    led_strip_i80_obj *i80_strip = (led_strip_i80_obj *)user_ctx;
+    BaseType_t task_woken = pdFALSE;
+    bool need_yield = false;
+    if (i80_strip->on_frame_done) {
+        need_yield = i80_strip->on_frame_done(&i80_strip->base, i80_strip->user_ctx);
+    }
+    xSemaphoreGiveFromISR(i80_strip->frame_done, &task_woken);
+    return need_yield || task_woken == pdTRUE;
+}
+
+// turn the strips' color bytes into bus words: the same byte of every strip is transposed, so
+// each bus word carries one bit of all strips
+static void led_strip_i80_encode(led_strip_i80_obj *i80_strip)
+{
+    uint32_t bytes_per_strip = i80_strip->leds_per_strip * i80_strip->bytes_per_pixel;
+    uint8_t in[LED_STRIP_I80_MAX_STRIPS] = {0};
+    uint8_t bits[LED_STRIP_I80_MAX_STRIPS / 8][8];
+    uint8_t *out = i80_strip->dma_buf;
+
+    for (uint32_t i = 0; i < bytes_per_strip; i++) {
+        for (uint8_t n = 0; n < i80_strip->num_strips; n++) {
+            in[n] = i80_strip->pixel_buf[n * bytes_per_strip + i];
+        }
+        led_strip_i80_transpose8(in, bits[0]);
+        if (i80_strip->bus_bytes == 1) {
+            for (int b = 0; b < 8; b++, out += LED_STRIP_I80_CYCLES_PER_BIT) {
+                out[0] = i80_strip->high_lines;
+                out[1] = bits[0][b];
+                out[2] = 0;
+            }
+        } else {
+            uint16_t *words = (uint16_t *)out;
+            led_strip_i80_transpose8(in + 8, bits[1]);
+            for (int b = 0; b < 8; b++, words += LED_STRIP_I80_CYCLES_PER_BIT) {
+                words[0] = i80_strip->high_lines;
+                words[1] = bits[0][b] | bits[1][b] << 8;
+                words[2] = 0;
+            }
+            out = (uint8_t *)words;
+        }
+    }
+}
+
+// the caller must hold frame_done, the transfer done callback gives it back
+static esp_err_t led_strip_i80_transmit(led_strip_i80_obj *i80_strip)
+{
+    led_strip_i80_encode(i80_strip);
+    // no command phase, the whole buffer goes out as color data
+    esp_err_t ret = esp_lcd_panel_io_tx_color(i80_strip->io, -1, i80_strip->dma_buf, i80_strip->dma_len);
+    if (ret != ESP_OK) {
+        xSemaphoreGive(i80_strip->frame_done);
+    }
+    return ret;
+}
+
+static esp_err_t led_strip_i80_set_pixel(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue)
+{
+    led_strip_i80_obj *i80_strip = __containerof(strip, led_strip_i80_obj, base);
+    ESP_RETURN_ON_FALSE(index < i80_strip->strip_len, ESP_ERR_INVALID_ARG, TAG, "index out of maximum number of LEDs");
+    led_strip_color_t *color = i80_strip->color;
+    uint32_t start = index * i80_strip->bytes_per_pixel;
+    i80_strip->pixel_buf[start + 0] = led_strip_color_apply(color, start + 0, green & 0xFF);
+    i80_strip->pixel_buf[start + 1] = led_strip_color_apply(color, start + 1, red & 0xFF);
+    i80_strip->pixel_buf[start + 2] = led_strip_color_apply(color, start + 2, blue & 0xFF);
+    if (i80_strip->bytes_per_pixel > 3) {
+        i80_strip->pixel_buf[start + 3] = led_strip_color_apply(color, start + 3, 0);
+    }
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_i80_set_pixel_rgbw(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue, uint32_t white)
+{
+    led_strip_i80_obj *i80_strip = __containerof(strip, led_strip_i80_obj, base);
+    ESP_RETURN_ON_FALSE(index < i80_strip->strip_len, ESP_ERR_INVALID_ARG, TAG, "index out of maximum number of LEDs");
+    ESP_RETURN_ON_FALSE(i80_strip->bytes_per_pixel == 4, ESP_ERR_INVALID_ARG, TAG, "wrong LED pixel format, expected 4 bytes per pixel");
+    led_strip_color_t *color = i80_strip->color;
+    uint32_t start = index * 4;
+    // SK6812 component order is GRBW
+    i80_strip->pixel_buf[start + 0] = led_strip_color_apply(color, start + 0, green & 0xFF);
+    i80_strip->pixel_buf[start + 1] = led_strip_color_apply(color, start + 1, red & 0xFF);
+    i80_strip->pixel_buf[start + 2] = led_strip_color_apply(color, start + 2, blue & 0xFF);
+    i80_strip->pixel_buf[start + 3] = led_strip_color_apply(color, start + 3, white & 0xFF);
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_i80_set_pixels(led_strip_t *strip, uint32_t start, uint32_t count, const uint8_t *pixels)
+{
+    led_strip_i80_obj *i80_strip = __containerof(strip, led_strip_i80_obj, base);
+    ESP_RETURN_ON_FALSE(count <= i80_strip->strip_len && start <= i80_strip->strip_len - count, ESP_ERR_INVALID_ARG, TAG, "pixel range out of maximum number of LEDs");
+    led_strip_color_t *color = i80_strip->color;
+    uint8_t bytes_per_pixel = i80_strip->bytes_per_pixel;
+    uint32_t offset = start * bytes_per_pixel;
+    uint8_t *buf = i80_strip->pixel_buf + offset;
+    // RGB(W) in, GRB(W) out
+    for (uint32_t i = 0; i < count; i++, buf += bytes_per_pixel, pixels += bytes_per_pixel, offset += bytes_per_pixel) {
+        buf[0] = led_strip_color_apply(color, offset + 0, pixels[1]);
+        buf[1] = led_strip_color_apply(color, offset + 1, pixels[0]);
+        buf[2] = led_strip_color_apply(color, offset + 2, pixels[2]);
+        if (bytes_per_pixel > 3) {
+            buf[3] = led_strip_color_apply(color, offset + 3, pixels[3]);
+        }
+    }
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_i80_refresh(led_strip_t *strip)
+{
+    led_strip_i80_obj *i80_strip = __containerof(strip, led_strip_i80_obj, base);
+
+    // wait for a frame started by refresh_async, then for our own
+    xSemaphoreTake(i80_strip->frame_done, portMAX_DELAY);
+    ESP_RETURN_ON_ERROR(led_strip_i80_transmit(i80_strip), TAG, "refresh failed");
+    xSemaphoreTake(i80_strip->frame_done, portMAX_DELAY);
+    xSemaphoreGive(i80_strip->frame_done);
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_i80_refresh_async(led_strip_t *strip)
+{
+    led_strip_i80_obj *i80_strip = __containerof(strip, led_strip_i80_obj, base);
+
+    // the pixels are encoded into the DMA buffer, so they can be changed as soon as this returns
+    xSemaphoreTake(i80_strip->frame_done, portMAX_DELAY);
+    return led_strip_i80_transmit(i80_strip);
+}
+
+static esp_err_t led_strip_i80_wait_refresh_done(led_strip_t *strip, int32_t timeout_ms)
+{
+    led_strip_i80_obj *i80_strip = __containerof(strip, led_strip_i80_obj, base);
+    TickType_t ticks = timeout_ms < 0 ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+
+    ESP_RETURN_ON_FALSE(xSemaphoreTake(i80_strip->frame_done, ticks) == pdTRUE, ESP_ERR_TIMEOUT, TAG, "wait for frame done timeout");
+    xSemaphoreGive(i80_strip->frame_done);
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_i80_register_frame_done_cb(led_strip_t *strip, led_strip_frame_done_cb_t cb, void *user_ctx)
+{
+    led_strip_i80_obj *i80_strip = __containerof(strip, led_strip_i80_obj, base);
+    i80_strip->on_frame_done = cb;
+    i80_strip->user_ctx = user_ctx;
+    return ESP_OK;
+}
+
+// the color correction state starts from the colors already in the pixel buffer
+static esp_err_t led_strip_i80_get_color(led_strip_i80_obj *i80_strip, led_strip_color_t **ret_color)
+{
+    if (!i80_strip->color) {
+        size_t len = i80_strip->strip_len * i80_strip->bytes_per_pixel;
+        i80_strip->color = led_strip_color_new(len);
+        ESP_RETURN_ON_FALSE(i80_strip->color, ESP_ERR_NO_MEM, TAG, "no mem for color correction");
+        memcpy(i80_strip->color->raw, i80_strip->pixel_buf, len);
+    }
+    *ret_color = i80_strip->color;
+    return ESP_OK;
+}
+
+// write the stored frame again through the new table
+static void led_strip_i80_apply_color(led_strip_i80_obj *i80_strip)
+{
+    const led_strip_color_t *color = i80_strip->color;
+    for (uint32_t i = 0; i < i80_strip->strip_len * i80_strip->bytes_per_pixel; i++) {
+        i80_strip->pixel_buf[i] = color->lut[color->raw[i]];
+    }
+}
+
+static esp_err_t led_strip_i80_set_gamma_table(led_strip_t *strip, const uint8_t *table)
+{
+    led_strip_i80_obj *i80_strip = __containerof(strip, led_strip_i80_obj, base);
+    led_strip_color_t *color = NULL;
+    ESP_RETURN_ON_ERROR(led_strip_i80_get_color(i80_strip, &color), TAG, "set gamma table failed");
+    led_strip_color_set_gamma(color, table);
+    led_strip_i80_apply_color(i80_strip);
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_i80_set_brightness(led_strip_t *strip, uint8_t brightness)
+{
+    led_strip_i80_obj *i80_strip = __containerof(strip, led_strip_i80_obj, base);
+    led_strip_color_t *color = NULL;
+    ESP_RETURN_ON_ERROR(led_strip_i80_get_color(i80_strip, &color), TAG, "set brightness failed");
+    led_strip_color_set_brightness(color, brightness);
+    led_strip_i80_apply_color(i80_strip);
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_i80_clear(led_strip_t *strip)
+{
+    led_strip_i80_obj *i80_strip = __containerof(strip, led_strip_i80_obj, base);
+    // Write zero to turn off all leds
+    memset(i80_strip->pixel_buf, 0, i80_strip->strip_len * i80_strip->bytes_per_pixel);
+    if (i80_strip->color) {
+        memset(i80_strip->color->raw, 0, i80_strip->strip_len * i80_strip->bytes_per_pixel);
+    }
+    return led_strip_i80_refresh(strip);
+}
+
+static esp_err_t led_strip_i80_del(led_strip_t *strip)
+{
+    led_strip_i80_obj *i80_strip = __containerof(strip, led_strip_i80_obj, base);
+    // let the last frame go out before tearing down the bus
+    xSemaphoreTake(i80_strip->frame_done, portMAX_DELAY);
+    ESP_RETURN_ON_ERROR(esp_lcd_panel_io_del(i80_strip->io), TAG, "delete panel io failed");
+    ESP_RETURN_ON_ERROR(esp_lcd_del_i80_bus(i80_strip->bus), TAG, "delete i80 bus failed");
+    vSemaphoreDelete(i80_strip->frame_done);
+    free(i80_strip->dma_buf);
+    free(i80_strip->color);
+    free(i80_strip);
+    return ESP_OK;
+}
+
+esp_err_t led_strip_new_i80_device(const led_strip_config_t *led_config, const led_strip_i80_config_t *i80_config, led_strip_handle_t *ret_strip)
+{
+    led_strip_i80_obj *i80_strip = NULL;
+    esp_err_t ret = ESP_OK;
+    ESP_GOTO_ON_FALSE(led_config && i80_config && ret_strip, ESP_ERR_INVALID_ARG, err, TAG, "invalid argument");
+    ESP_GOTO_ON_FALSE(led_config->led_pixel_format < LED_PIXEL_FORMAT_INVALID, ESP_ERR_INVALID_ARG, err, TAG, "invalid led_pixel_format");
+    ESP_GOTO_ON_FALSE(led_config->led_model == LED_MODEL_WS2812 || led_config->led_model == LED_MODEL_SK6812, ESP_ERR_INVALID_ARG, err, TAG, "invalid led model");
+    ESP_GOTO_ON_FALSE(i80_config->num_strips <= LED_STRIP_I80_MAX_STRIPS, ESP_ERR_INVALID_ARG, err, TAG, "too many strips");
+    ESP_GOTO_ON_FALSE(i80_config->clk_gpio_num >= 0 && i80_config->dc_gpio_num >= 0, ESP_ERR_INVALID_ARG, err, TAG, "invalid clk / dc GPIO");
+    uint8_t bytes_per_pixel = 3;
+    if (led_config->led_pixel_format == LED_PIXEL_FORMAT_GRBW) {
+        bytes_per_pixel = 4;
+    } else if (led_config->led_pixel_format == LED_PIXEL_FORMAT_GRB) {
+        bytes_per_pixel = 3;
+    } else {
+        assert(false);
+    }
+    uint8_t num_strips = i80_config->num_strips ? i80_config->num_strips : 1;
+    uint8_t bus_bytes = num_strips > 8 ? 2 : 1;
+    uint32_t strip_len = led_config->max_leds * num_strips;
+
+    i80_strip = calloc(1, sizeof(led_strip_i80_obj) + strip_len * bytes_per_pixel);
+    ESP_GOTO_ON_FALSE(i80_strip, ESP_ERR_NO_MEM, err, TAG, "no mem for i80 strip");
+    // the bus needs whole words
+    i80_strip->dma_len = (led_config->max_leds * bytes_per_pixel * LED_STRIP_I80_CYCLES_PER_COLOR_BYTE + LED_STRIP_I80_RESET_CYCLES) * bus_bytes;
+    i80_strip->dma_len = (i80_strip->dma_len + 3) & ~3;
+    // the tail after the encoded frame stays zero, that is the reset time
+    i80_strip->dma_buf = heap_caps_calloc(1, i80_strip->dma_len, MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA);
+    ESP_GOTO_ON_FALSE(i80_strip->dma_buf, ESP_ERR_NO_MEM, err, TAG, "no mem for DMA buffer");
+    i80_strip->frame_done = xSemaphoreCreateBinary();
+    ESP_GOTO_ON_FALSE(i80_strip->frame_done, ESP_ERR_NO_MEM, err, TAG, "no mem for frame done semaphore");
+    xSemaphoreGive(i80_strip->frame_done);
+
+    esp_lcd_i80_bus_config_t bus_config = {
+        .clk_src = LCD_CLK_SRC_DEFAULT,
+        .dc_gpio_num = i80_config->dc_gpio_num,
+        .wr_gpio_num = i80_config->clk_gpio_num,
+        .bus_width = bus_bytes * 8,
+        .max_transfer_bytes = i80_strip->dma_len,
+    };
+    // the bus driver wants a GPIO for every data line, the lines without a strip always send 0
+    // and share the D/C pin, which the strips don't use either
+    for (int i = 0; i < bus_config.bus_width; i++) {
+        bus_config.data_gpio_nums[i] = i80_config->dc_gpio_num;
+    }
+    if (i80_config->num_strips) {
+        for (uint8_t n = 0; n < num_strips; n++) {
+            bus_config.data_gpio_nums[n] = i80_config->strip_gpio_nums[n];
+        }
+    } else {
+        bus_config.data_gpio_nums[0] = led_config->strip_gpio_num;
+    }
+    ESP_GOTO_ON_ERROR(esp_lcd_new_i80_bus(&bus_config, &i80_strip->bus), err, TAG, "create i80 bus failed");
+
+    esp_lcd_panel_io_i80_config_t io_config = {
+        .cs_gpio_num = -1,
+        .pclk_hz = LED_STRIP_I80_PCLK_HZ,
+        .trans_queue_depth = LED_STRIP_I80_TRANS_QUEUE_SIZE,
+        .on_color_trans_done = led_strip_i80_trans_done,
+        .user_ctx = i80_strip,
+        .lcd_cmd_bits = 8,
+        .lcd_param_bits = 8,
+    };
+    ESP_GOTO_ON_ERROR(esp_lcd_new_panel_io_i80(i80_strip->bus, &io_config, &i80_strip->io), err, TAG, "create panel io failed");
+
+    i80_strip->high_lines = (1U << num_strips) - 1;
+    i80_strip->bus_bytes = bus_bytes;
+    i80_strip->num_strips = num_strips;
+    i80_strip->leds_per_strip = led_config->max_leds;
+    i80_strip->strip_len = strip_len;
+    i80_strip->bytes_per_pixel = bytes_per_pixel;
+    i80_strip->base.set_pixel = led_strip_i80_set_pixel;
+    i80_strip->base.set_pixel_rgbw = led_strip_i80_set_pixel_rgbw;
+    i80_strip->base.set_pixels = led_strip_i80_set_pixels;
+    i80_strip->base.bytes_per_pixel = bytes_per_pixel;
+    i80_strip->base.refresh = led_strip_i80_refresh;
+    i80_strip->base.refresh_async = led_strip_i80_refresh_async;
+    i80_strip->base.wait_refresh_done = led_strip_i80_wait_refresh_done;
+    i80_strip->base.register_frame_done_cb = led_strip_i80_register_frame_done_cb;
+    i80_strip->base.set_gamma_table = led_strip_i80_set_gamma_table;
+    i80_strip->base.set_brightness = led_strip_i80_set_brightness;
+    i80_strip->base.clear = led_strip_i80_clear;
+    i80_strip->base.del = led_strip_i80_del;
+
+    *ret_strip = &i80_strip->base;
+    return ESP_OK;
+err:
+    if (i80_strip) {
+        if (i80_strip->io) {
+            esp_lcd_panel_io_del(i80_strip->io);
+        }
+        if (i80_strip->bus) {
+            esp_lcd_del_i80_bus(i80_strip->bus);
+        }
+        if (i80_strip->frame_done) {
+            vSemaphoreDelete(i80_strip->frame_done);
+        }
+        free(i80_strip->dma_buf);
+        free(i80_strip);
+    }
+    return ret;
+}
@@ -0,0 +1,55 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Transpose 8 color bytes, one per strip, into 8 bus bytes, one per color bit
+ *
+ * Bit k of out[j] is bit (7 - j) of in[k], so out[0] carries the MSB of every strip and
+ * strip k drives data line k. Done with the 32-bit delta swaps of Hacker's Delight
+ * (transpose8rS32), about 30 ALU operations instead of 64 single bit moves.
+ *
+ * @param[in] in Color byte of strips 0-7
+ * @param[out] out Bus byte of color bits 7-0
+ */
+static inline void led_strip_i80_transpose8(const uint8_t in[8], uint8_t out[8])
+{
+    // rows in reverse, so that strip k ends up in bit k and not in bit 7 - k
+    uint32_t x = (uint32_t)in[7] << 24 | (uint32_t)in[6] << 16 | (uint32_t)in[5] << 8 | in[4];
+    uint32_t y = (uint32_t)in[3] << 24 | (uint32_t)in[2] << 16 | (uint32_t)in[1] << 8 | in[0];
+    uint32_t t;
+
+    t = (x ^ (x >> 7)) & 0x00AA00AA;
+    x = x ^ t ^ (t << 7);
+    t = (y ^ (y >> 7)) & 0x00AA00AA;
+    y = y ^ t ^ (t << 7);
+    t = (x ^ (x >> 14)) & 0x0000CCCC;
+    x = x ^ t ^ (t << 14);
+    t = (y ^ (y >> 14)) & 0x0000CCCC;
+    y = y ^ t ^ (t << 14);
+    t = (x & 0xF0F0F0F0) | ((y >> 4) & 0x0F0F0F0F);
+    y = ((x << 4) & 0xF0F0F0F0) | (y & 0x0F0F0F0F);
+    x = t;
+
+    out[0] = x >> 24;
+    out[1] = x >> 16;
+    out[2] = x >> 8;
+    out[3] = x;
+    out[4] = y >> 24;
+    out[5] = y >> 16;
+    out[6] = y >> 8;
+    out[7] = y;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,514 @@
+/*
+ * SPDX-FileCopyrightText: 2022-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <sys/cdefs.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_attr.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "driver/rmt_tx.h"
+#include "soc/soc_caps.h"
+#include "led_strip.h"
+#include "led_strip_interface.h"
+#include "led_strip_rmt_encoder.h"
+#include "led_strip_color.h"
+
+#define LED_STRIP_RMT_DEFAULT_RESOLUTION 10000000 // 10MHz resolution
+#define LED_STRIP_RMT_DEFAULT_TRANS_QUEUE_SIZE 4
+// the memory size of each RMT channel, in words (4 bytes)
+#if CONFIG_IDF_TARGET_ESP32 || CONFIG_IDF_TARGET_ESP32S2
+#define LED_STRIP_RMT_DEFAULT_MEM_BLOCK_SYMBOLS 64
+#else
+#define LED_STRIP_RMT_DEFAULT_MEM_BLOCK_SYMBOLS 48
+#endif
+
+static const char *TAG = "led_strip_rmt";
+
+typedef struct led_strip_rmt_obj_t led_strip_rmt_obj;
+
+struct led_strip_rmt_group_t {
+#if SOC_RMT_SUPPORT_TX_SYNCHRO
+    rmt_sync_manager_handle_t synchro; // starts the TX channels in the same clock cycle
+#endif
+    size_t num_strips;
+    led_strip_rmt_obj *strips[];
+};
+
+struct led_strip_rmt_obj_t {
+    led_strip_t base;
+    rmt_channel_handle_t rmt_chan;
+    rmt_encoder_handle_t strip_encoder;
+    SemaphoreHandle_t frame_done; // available while no frame is on the wire
+    led_strip_frame_done_cb_t on_frame_done;
+    void *user_ctx;
+    uint8_t *pixel_buf;           // back buffer, written by set_pixel; NULL for a streamed strip
+    uint8_t *tx_buf;              // front buffer of asynchronous refresh, allocated on first use
+    led_strip_color_t *color;     // gamma / brightness, NULL until the application sets one
+    led_strip_rmt_group_handle_t group; // set while the strip is refreshed through a group
+    led_strip_rmt_stream_t stream; // frame being streamed, read by the encoder until it is sent
+    uint32_t strip_len;
+    uint8_t bytes_per_pixel;
+    uint8_t buf[];
+};
+
+static bool IRAM_ATTR led_strip_rmt_tx_done(rmt_channel_handle_t chan, const rmt_tx_done_event_data_t *edata, void *user_ctx)
+{
+    led_strip_rmt_obj *rmt_strip = (led_strip_rmt_obj *)user_ctx;
+    BaseType_t task_woken = pdFALSE;
+    bool need_yield = false;
+    if (rmt_strip->on_frame_done) {
+        need_yield = rmt_strip->on_frame_done(&rmt_strip->base, rmt_strip->user_ctx);
+    }
+    xSemaphoreGiveFromISR(rmt_strip->frame_done, &task_woken);
+    return need_yield || task_woken == pdTRUE;
+}
+
+// the caller must hold frame_done, the TX done callback gives it back
+// data is a GRB(W) buffer, or the led_strip_rmt_stream_t of a streamed strip
+static esp_err_t led_strip_rmt_transmit(led_strip_rmt_obj *rmt_strip, const void *data)
+{
+    rmt_transmit_config_t tx_conf = {
+        .loop_count = 0,
+    };
+    esp_err_t ret = rmt_transmit(rmt_strip->rmt_chan, rmt_strip->strip_encoder, data,
+                                 rmt_strip->strip_len * rmt_strip->bytes_per_pixel, &tx_conf);
+    if (ret != ESP_OK) {
+        xSemaphoreGive(rmt_strip->frame_done);
+    }
+    ESP_RETURN_ON_ERROR(ret, TAG, "transmit pixels by RMT failed");
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_rmt_set_pixel(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue)
+{
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    ESP_RETURN_ON_FALSE(rmt_strip->pixel_buf, ESP_ERR_INVALID_STATE, TAG, "streamed strip has no pixel buffer");
+    ESP_RETURN_ON_FALSE(index < rmt_strip->strip_len, ESP_ERR_INVALID_ARG, TAG, "index out of maximum number of LEDs");
+    led_strip_color_t *color = rmt_strip->color;
+    uint32_t start = index * rmt_strip->bytes_per_pixel;
+    // In thr order of GRB, as LED strip like WS2812 sends out pixels in this order
+    rmt_strip->pixel_buf[start + 0] = led_strip_color_apply(color, start + 0, green & 0xFF);
+    rmt_strip->pixel_buf[start + 1] = led_strip_color_apply(color, start + 1, red & 0xFF);
+    rmt_strip->pixel_buf[start + 2] = led_strip_color_apply(color, start + 2, blue & 0xFF);
+    if (rmt_strip->bytes_per_pixel > 3) {
+        rmt_strip->pixel_buf[start + 3] = led_strip_color_apply(color, start + 3, 0);
+    }
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_rmt_set_pixel_rgbw(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue, uint32_t white)
+{
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    ESP_RETURN_ON_FALSE(rmt_strip->pixel_buf, ESP_ERR_INVALID_STATE, TAG, "streamed strip has no pixel buffer");
+    ESP_RETURN_ON_FALSE(index < rmt_strip->strip_len, ESP_ERR_INVALID_ARG, TAG, "index out of maximum number of LEDs");
+    ESP_RETURN_ON_FALSE(rmt_strip->bytes_per_pixel == 4, ESP_ERR_INVALID_ARG, TAG, "wrong LED pixel format, expected 4 bytes per pixel");
+    led_strip_color_t *color = rmt_strip->color;
+    uint32_t start = index * 4;
+    uint8_t *buf_start = rmt_strip->pixel_buf + start;
+    // SK6812 component order is GRBW
+    *buf_start = led_strip_color_apply(color, start + 0, green & 0xFF);
+    *++buf_start = led_strip_color_apply(color, start + 1, red & 0xFF);
+    *++buf_start = led_strip_color_apply(color, start + 2, blue & 0xFF);
+    *++buf_start = led_strip_color_apply(color, start + 3, white & 0xFF);
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_rmt_set_pixels(led_strip_t *strip, uint32_t start, uint32_t count, const uint8_t *pixels)
+{
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    ESP_RETURN_ON_FALSE(rmt_strip->pixel_buf, ESP_ERR_INVALID_STATE, TAG, "streamed strip has no pixel buffer");
+    ESP_RETURN_ON_FALSE(count <= rmt_strip->strip_len && start <= rmt_strip->strip_len - count, ESP_ERR_INVALID_ARG, TAG, "pixel range out of maximum number of LEDs");
+    led_strip_color_t *color = rmt_strip->color;
+    uint32_t offset = start * rmt_strip->bytes_per_pixel;
+    uint8_t *buf = rmt_strip->pixel_buf + offset;
+    // RGB(W) in, GRB(W) out
+    if (rmt_strip->bytes_per_pixel > 3) {
+        for (uint32_t i = 0; i < count; i++, buf += 4, pixels += 4, offset += 4) {
+            buf[0] = led_strip_color_apply(color, offset + 0, pixels[1]);
+            buf[1] = led_strip_color_apply(color, offset + 1, pixels[0]);
+            buf[2] = led_strip_color_apply(color, offset + 2, pixels[2]);
+            buf[3] = led_strip_color_apply(color, offset + 3, pixels[3]);
+        }
+    } else {
+        for (uint32_t i = 0; i < count; i++, buf += 3, pixels += 3, offset += 3) {
+            buf[0] = led_strip_color_apply(color, offset + 0, pixels[1]);
+            buf[1] = led_strip_color_apply(color, offset + 1, pixels[0]);
+            buf[2] = led_strip_color_apply(color, offset + 2, pixels[2]);
+        }
+    }
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_rmt_refresh(led_strip_t *strip)
+{
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    ESP_RETURN_ON_FALSE(!rmt_strip->group, ESP_ERR_INVALID_STATE, TAG, "strip is refreshed by its group");
+    ESP_RETURN_ON_FALSE(rmt_strip->pixel_buf, ESP_ERR_INVALID_STATE, TAG, "streamed strip has no pixel buffer");
+
+    // wait for a frame started by refresh_async, then for our own
+    xSemaphoreTake(rmt_strip->frame_done, portMAX_DELAY);
+    ESP_RETURN_ON_ERROR(led_strip_rmt_transmit(rmt_strip, rmt_strip->pixel_buf), TAG, "refresh failed");
+    xSemaphoreTake(rmt_strip->frame_done, portMAX_DELAY);
+    xSemaphoreGive(rmt_strip->frame_done);
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_rmt_refresh_async(led_strip_t *strip)
+{
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    size_t frame_size = rmt_strip->strip_len * rmt_strip->bytes_per_pixel;
+    ESP_RETURN_ON_FALSE(!rmt_strip->group, ESP_ERR_INVALID_STATE, TAG, "strip is refreshed by its group");
+    ESP_RETURN_ON_FALSE(rmt_strip->pixel_buf, ESP_ERR_INVALID_STATE, TAG, "streamed strip has no pixel buffer");
+
+    // the front buffer is only needed once the application renders during transmission
+    if (!rmt_strip->tx_buf) {
+        rmt_strip->tx_buf = malloc(frame_size);
+        ESP_RETURN_ON_FALSE(rmt_strip->tx_buf, ESP_ERR_NO_MEM, TAG, "no mem for front buffer");
+    }
+
+    // the previous frame has left the front buffer once its TX done callback fired
+    xSemaphoreTake(rmt_strip->frame_done, portMAX_DELAY);
+    uint8_t *front = rmt_strip->pixel_buf;
+    rmt_strip->pixel_buf = rmt_strip->tx_buf;
+    rmt_strip->tx_buf = front;
+    // the new back buffer starts from the frame just sent, so partial updates keep working
+    memcpy(rmt_strip->pixel_buf, front, frame_size);
+    return led_strip_rmt_transmit(rmt_strip, front);
+}
+
+static esp_err_t led_strip_rmt_wait_refresh_done(led_strip_t *strip, int32_t timeout_ms)
+{
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    TickType_t ticks = timeout_ms < 0 ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+
+    ESP_RETURN_ON_FALSE(xSemaphoreTake(rmt_strip->frame_done, ticks) == pdTRUE, ESP_ERR_TIMEOUT, TAG, "wait for frame done timeout");
+    xSemaphoreGive(rmt_strip->frame_done);
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_rmt_register_frame_done_cb(led_strip_t *strip, led_strip_frame_done_cb_t cb, void *user_ctx)
+{
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    rmt_strip->on_frame_done = cb;
+    rmt_strip->user_ctx = user_ctx;
+    return ESP_OK;
+}
+
+// the color correction state starts from the colors already in the pixel buffer
+static esp_err_t led_strip_rmt_get_color(led_strip_rmt_obj *rmt_strip, led_strip_color_t **ret_color)
+{
+    if (!rmt_strip->color) {
+        // a streamed strip has no stored frame, its table is applied while the next one is sent
+        size_t len = rmt_strip->pixel_buf ? rmt_strip->strip_len * rmt_strip->bytes_per_pixel : 0;
+        rmt_strip->color = led_strip_color_new(len);
+        ESP_RETURN_ON_FALSE(rmt_strip->color, ESP_ERR_NO_MEM, TAG, "no mem for color correction");
+        if (len) {
+            memcpy(rmt_strip->color->raw, rmt_strip->pixel_buf, len);
+        }
+    }
+    *ret_color = rmt_strip->color;
+    return ESP_OK;
+}
+
+// write the stored frame again through the new table
+static void led_strip_rmt_apply_color(led_strip_rmt_obj *rmt_strip)
+{
+    const led_strip_color_t *color = rmt_strip->color;
+    if (!rmt_strip->pixel_buf) {
+        return;
+    }
+    for (uint32_t i = 0; i < rmt_strip->strip_len * rmt_strip->bytes_per_pixel; i++) {
+        rmt_strip->pixel_buf[i] = color->lut[color->raw[i]];
+    }
+}
+
+static esp_err_t led_strip_rmt_set_gamma_table(led_strip_t *strip, const uint8_t *table)
+{
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    led_strip_color_t *color = NULL;
+    ESP_RETURN_ON_ERROR(led_strip_rmt_get_color(rmt_strip, &color), TAG, "set gamma table failed");
+    led_strip_color_set_gamma(color, table);
+    led_strip_rmt_apply_color(rmt_strip);
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_rmt_set_brightness(led_strip_t *strip, uint8_t brightness)
+{
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    led_strip_color_t *color = NULL;
+    ESP_RETURN_ON_ERROR(led_strip_rmt_get_color(rmt_strip, &color), TAG, "set brightness failed");
+    led_strip_color_set_brightness(color, brightness);
+    led_strip_rmt_apply_color(rmt_strip);
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_rmt_clear(led_strip_t *strip)
+{
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    if (!rmt_strip->pixel_buf) {
+        // a source without pixels renders a black frame
+        led_strip_rmt_stream_source_t black = {};
+        ESP_RETURN_ON_ERROR(led_strip_rmt_refresh_stream(strip, &black), TAG, "clear failed");
+        return led_strip_rmt_wait_refresh_done(strip, -1);
+    }
+    // Write zero to turn off all leds
+    memset(rmt_strip->pixel_buf, 0, rmt_strip->strip_len * rmt_strip->bytes_per_pixel);
+    if (rmt_strip->color) {
+        memset(rmt_strip->color->raw, 0, rmt_strip->strip_len * rmt_strip->bytes_per_pixel);
+    }
+    // group members go dark with the next group refresh
+    if (rmt_strip->group) {
+        return ESP_OK;
+    }
+    return led_strip_rmt_refresh(strip);
+}
+
+static esp_err_t led_strip_rmt_del(led_strip_t *strip)
+{
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    ESP_RETURN_ON_FALSE(!rmt_strip->group, ESP_ERR_INVALID_STATE, TAG, "delete the group first");
+    // let the last frame go out before tearing down the channel
+    xSemaphoreTake(rmt_strip->frame_done, portMAX_DELAY);
+    ESP_RETURN_ON_ERROR(rmt_disable(rmt_strip->rmt_chan), TAG, "disable RMT channel failed");
+    ESP_RETURN_ON_ERROR(rmt_del_channel(rmt_strip->rmt_chan), TAG, "delete RMT channel failed");
+    ESP_RETURN_ON_ERROR(rmt_del_encoder(rmt_strip->strip_encoder), TAG, "delete strip encoder failed");
+    vSemaphoreDelete(rmt_strip->frame_done);
+    // tx_buf may point into buf after a swap, free whichever buffer was allocated separately
+    free(rmt_strip->pixel_buf == rmt_strip->buf ? rmt_strip->tx_buf : rmt_strip->pixel_buf);
+    free(rmt_strip->color);
+    free(rmt_strip);
+    return ESP_OK;
+}
+
+esp_err_t led_strip_new_rmt_device(const led_strip_config_t *led_config, const led_strip_rmt_config_t *rmt_config, led_strip_handle_t *ret_strip)
+{
+    led_strip_rmt_obj *rmt_strip = NULL;
+    esp_err_t ret = ESP_OK;
+    ESP_GOTO_ON_FALSE(led_config && rmt_config && ret_strip, ESP_ERR_INVALID_ARG, err, TAG, "invalid argument");
+    ESP_GOTO_ON_FALSE(led_config->led_pixel_format < LED_PIXEL_FORMAT_INVALID, ESP_ERR_INVALID_ARG, err, TAG, "invalid led_pixel_format");
+    uint8_t bytes_per_pixel = 3;
+    if (led_config->led_pixel_format == LED_PIXEL_FORMAT_GRBW) {
+        bytes_per_pixel = 4;
+    } else if (led_config->led_pixel_format == LED_PIXEL_FORMAT_GRB) {
+        bytes_per_pixel = 3;
+    } else {
+        assert(false);
+    }
+    // a streamed strip renders its frames while they are sent, it needs no pixel buffer
+    size_t buf_size = rmt_config->flags.stream ? 0 : led_config->max_leds * bytes_per_pixel;
+    rmt_strip = calloc(1, sizeof(led_strip_rmt_obj) + buf_size);
+    ESP_GOTO_ON_FALSE(rmt_strip, ESP_ERR_NO_MEM, err, TAG, "no mem for rmt strip");
+    rmt_strip->pixel_buf = buf_size ? rmt_strip->buf : NULL;
+    rmt_strip->frame_done = xSemaphoreCreateBinary();
+    ESP_GOTO_ON_FALSE(rmt_strip->frame_done, ESP_ERR_NO_MEM, err, TAG, "no mem for frame done semaphore");
+    xSemaphoreGive(rmt_strip->frame_done);
+    uint32_t resolution = rmt_config->resolution_hz ? rmt_config->resolution_hz : LED_STRIP_RMT_DEFAULT_RESOLUTION;
+
+    // for backward compatibility, if the user does not set the clk_src, use the default value
+    rmt_clock_source_t clk_src = RMT_CLK_SRC_DEFAULT;
+    if (rmt_config->clk_src) {
+        clk_src = rmt_config->clk_src;
+    }
+    size_t mem_block_symbols = LED_STRIP_RMT_DEFAULT_MEM_BLOCK_SYMBOLS;
+    // override the default value if the user sets it
+    if (rmt_config->mem_block_symbols) {
+        mem_block_symbols = rmt_config->mem_block_symbols;
+    }
+    rmt_tx_channel_config_t rmt_chan_config = {
+        .clk_src = clk_src,
+        .gpio_num = led_config->strip_gpio_num,
+        .mem_block_symbols = mem_block_symbols,
+        .resolution_hz = resolution,
+        .trans_queue_depth = LED_STRIP_RMT_DEFAULT_TRANS_QUEUE_SIZE,
+        .flags.with_dma = rmt_config->flags.with_dma,
+        .flags.invert_out = led_config->flags.invert_out,
+    };
+    ESP_GOTO_ON_ERROR(rmt_new_tx_channel(&rmt_chan_config, &rmt_strip->rmt_chan), err, TAG, "create RMT TX channel failed");
+
+    led_strip_encoder_config_t strip_encoder_conf = {
+        .resolution = resolution,
+        .led_model = led_config->led_model,
+        .stream = rmt_config->flags.stream,
+    };
+    ESP_GOTO_ON_ERROR(rmt_new_led_strip_encoder(&strip_encoder_conf, &rmt_strip->strip_encoder), err, TAG, "create LED strip encoder failed");
+
+    rmt_tx_event_callbacks_t cbs = {
+        .on_trans_done = led_strip_rmt_tx_done,
+    };
+    ESP_GOTO_ON_ERROR(rmt_tx_register_event_callbacks(rmt_strip->rmt_chan, &cbs, rmt_strip), err, TAG, "register TX done callback failed");
+    // the channel stays enabled for the lifetime of the strip, so refresh doesn't pay for enable / disable
+    ESP_GOTO_ON_ERROR(rmt_enable(rmt_strip->rmt_chan), err, TAG, "enable RMT channel failed");
+
+    rmt_strip->bytes_per_pixel = bytes_per_pixel;
+    rmt_strip->strip_len = led_config->max_leds;
+    rmt_strip->base.set_pixel = led_strip_rmt_set_pixel;
+    rmt_strip->base.set_pixel_rgbw = led_strip_rmt_set_pixel_rgbw;
+    rmt_strip->base.set_pixels = led_strip_rmt_set_pixels;
+    rmt_strip->base.bytes_per_pixel = bytes_per_pixel;
+    rmt_strip->base.refresh = led_strip_rmt_refresh;
+    rmt_strip->base.refresh_async = led_strip_rmt_refresh_async;
+    rmt_strip->base.wait_refresh_done = led_strip_rmt_wait_refresh_done;
+    rmt_strip->base.register_frame_done_cb = led_strip_rmt_register_frame_done_cb;
+    rmt_strip->base.set_gamma_table = led_strip_rmt_set_gamma_table;
+    rmt_strip->base.set_brightness = led_strip_rmt_set_brightness;
+    rmt_strip->base.clear = led_strip_rmt_clear;
+    rmt_strip->base.del = led_strip_rmt_del;
+
+    *ret_strip = &rmt_strip->base;
+    return ESP_OK;
+err:
+    if (rmt_strip) {
+        if (rmt_strip->rmt_chan) {
+            rmt_del_channel(rmt_strip->rmt_chan);
+        }
+        if (rmt_strip->strip_encoder) {
+            rmt_del_encoder(rmt_strip->strip_encoder);
+        }
+        if (rmt_strip->frame_done) {
+            vSemaphoreDelete(rmt_strip->frame_done);
+        }
+        free(rmt_strip);
+    }
+    return ret;
+}
+
+esp_err_t led_strip_rmt_refresh_stream(led_strip_handle_t strip, const led_strip_rmt_stream_source_t *source)
+{
+    ESP_RETURN_ON_FALSE(strip && source && strip->refresh == led_strip_rmt_refresh, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    ESP_RETURN_ON_FALSE(!rmt_strip->pixel_buf, ESP_ERR_INVALID_STATE, TAG, "strip was not created with flags.stream");
+
+    // the encoder reads the stream until the TX done callback fired
+    xSemaphoreTake(rmt_strip->frame_done, portMAX_DELAY);
+    rmt_strip->stream = (led_strip_rmt_stream_t) {
+        .source = *source,
+        .lut = rmt_strip->color ? rmt_strip->color->lut : NULL,
+        .num_pixels = rmt_strip->strip_len,
+        .bytes_per_pixel = rmt_strip->bytes_per_pixel,
+    };
+    return led_strip_rmt_transmit(rmt_strip, &rmt_strip->stream);
+}
+
+esp_err_t led_strip_new_rmt_group(const led_strip_handle_t *strips, size_t num_strips, led_strip_rmt_group_handle_t *ret_group)
+{
+    led_strip_rmt_group_handle_t group = NULL;
+    rmt_channel_handle_t *channels = NULL;
+    esp_err_t ret = ESP_OK;
+    ESP_GOTO_ON_FALSE(strips && num_strips && ret_group, ESP_ERR_INVALID_ARG, err, TAG, "invalid argument");
+    group = calloc(1, sizeof(struct led_strip_rmt_group_t) + num_strips * sizeof(led_strip_rmt_obj *));
+    channels = calloc(num_strips, sizeof(rmt_channel_handle_t));
+    ESP_GOTO_ON_FALSE(group && channels, ESP_ERR_NO_MEM, err, TAG, "no mem for rmt group");
+    for (size_t i = 0; i < num_strips; i++) {
+        ESP_GOTO_ON_FALSE(strips[i] && strips[i]->refresh == led_strip_rmt_refresh, ESP_ERR_INVALID_ARG, err, TAG, "strip %zu is not an RMT strip", i);
+        led_strip_rmt_obj *rmt_strip = __containerof(strips[i], led_strip_rmt_obj, base);
+        ESP_GOTO_ON_FALSE(!rmt_strip->group, ESP_ERR_INVALID_STATE, err, TAG, "strip %zu is already in a group", i);
+        ESP_GOTO_ON_FALSE(rmt_strip->pixel_buf, ESP_ERR_INVALID_ARG, err, TAG, "strip %zu is streamed", i);
+        // the sync manager is installed on idle channels
+        xSemaphoreTake(rmt_strip->frame_done, portMAX_DELAY);
+        xSemaphoreGive(rmt_strip->frame_done);
+        group->strips[i] = rmt_strip;
+        channels[i] = rmt_strip->rmt_chan;
+    }
+    group->num_strips = num_strips;
+#if SOC_RMT_SUPPORT_TX_SYNCHRO
+    rmt_sync_manager_config_t sync_config = {
+        .tx_channel_array = channels,
+        .array_size = num_strips,
+    };
+    ESP_GOTO_ON_ERROR(rmt_new_sync_manager(&sync_config, &group->synchro), err, TAG, "create RMT sync manager failed");
+#endif
+    for (size_t i = 0; i < num_strips; i++) {
+        group->strips[i]->group = group;
+    }
+    free(channels);
+    *ret_group = group;
+    return ESP_OK;
+err:
+    free(channels);
+    free(group);
+    return ret;
+}
+
+// the first `queued` strips of the group have a frame queued, drop it and give their frame_done back
+static void led_strip_rmt_group_abort(led_strip_rmt_group_handle_t group, size_t queued)
+{
+#if SOC_RMT_SUPPORT_TX_SYNCHRO
+    // they wait for the sync manager to see every channel, which is never going to happen
+    if (queued > 0) {
+        rmt_sync_reset(group->synchro);
+    }
+    for (size_t i = 0; i < queued; i++) {
+        led_strip_rmt_obj *rmt_strip = group->strips[i];
+        // disabling the channel aborts the pending transaction, its TX done callback never runs
+        rmt_disable(rmt_strip->rmt_chan);
+        rmt_enable(rmt_strip->rmt_chan);
+        xSemaphoreGive(rmt_strip->frame_done);
+    }
+#else
+    // without a sync manager they are already being sent, their TX done callbacks give frame_done back
+    for (size_t i = 0; i < queued; i++) {
+        xSemaphoreTake(group->strips[i]->frame_done, portMAX_DELAY);
+        xSemaphoreGive(group->strips[i]->frame_done);
+    }
+#endif
+}
+
+esp_err_t led_strip_rmt_group_refresh(led_strip_rmt_group_handle_t group)
+{
+    esp_err_t ret = ESP_OK;
+    size_t started = 0;
+    ESP_RETURN_ON_FALSE(group, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+
+    // every strip gives its frame_done back from its own TX done callback
+    for (size_t i = 0; i < group->num_strips; i++) {
+        xSemaphoreTake(group->strips[i]->frame_done, portMAX_DELAY);
+    }
+#if SOC_RMT_SUPPORT_TX_SYNCHRO
+    // re-arm the sync manager, the channels start together once the last one has been given its frame
+    ESP_GOTO_ON_ERROR(rmt_sync_reset(group->synchro), err, TAG, "reset RMT sync manager failed");
+#endif
+    for (; started < group->num_strips; started++) {
+        led_strip_rmt_obj *rmt_strip = group->strips[started];
+        ret = led_strip_rmt_transmit(rmt_strip, rmt_strip->pixel_buf);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "refresh strip %zu failed", started);
+            led_strip_rmt_group_abort(group, started);
+            // led_strip_rmt_transmit gave back this strip's semaphore already
+            started++;
+            goto err;
+        }
+    }
+    // one wait for the whole group, the frame time is the one of the longest strip
+    for (size_t i = 0; i < group->num_strips; i++) {
+        xSemaphoreTake(group->strips[i]->frame_done, portMAX_DELAY);
+        xSemaphoreGive(group->strips[i]->frame_done);
+    }
+    return ESP_OK;
+err:
+    for (size_t i = started; i < group->num_strips; i++) {
+        xSemaphoreGive(group->strips[i]->frame_done);
+    }
+    return ret;
+}
+
+esp_err_t led_strip_rmt_group_del(led_strip_rmt_group_handle_t group)
+{
+    ESP_RETURN_ON_FALSE(group, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    for (size_t i = 0; i < group->num_strips; i++) {
+        xSemaphoreTake(group->strips[i]->frame_done, portMAX_DELAY);
+        xSemaphoreGive(group->strips[i]->frame_done);
+    }
+#if SOC_RMT_SUPPORT_TX_SYNCHRO
+    ESP_RETURN_ON_ERROR(rmt_del_sync_manager(group->synchro), TAG, "delete RMT sync manager failed");
+#endif
+    for (size_t i = 0; i < group->num_strips; i++) {
+        group->strips[i]->group = NULL;
+    }
+    free(group);
+    return ESP_OK;
+}
@@ -93,6 +93,29 @@ static esp_err_t led_strip_rmt_set_pixel(led_strip_t *strip, uint32_t index, uin
     return ESP_OK;
 }
 
+static esp_err_t led_strip_rmt_set_pixels(led_strip_t *strip, uint32_t start, uint32_t count, const uint8_t *pixels)
+{
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    ESP_RETURN_ON_FALSE(count <= rmt_strip->strip_len && start <= rmt_strip->strip_len - count, ESP_ERR_INVALID_ARG, TAG, "pixel range out of the maximum number of leds");
+    uint8_t *buf = rmt_strip->buffer + start * rmt_strip->bytes_per_pixel;
+    // RGB(W) in, GRB(W) out
+    if (rmt_strip->bytes_per_pixel > 3) {
+        for (uint32_t i = 0; i < count; i++, buf += 4, pixels += 4) {
+            buf[0] = pixels[1];
+            buf[1] = pixels[0];
+            buf[2] = pixels[2];
+            buf[3] = pixels[3];
+        }
+    } else {
+        for (uint32_t i = 0; i < count; i++, buf += 3, pixels += 3) {
+            buf[0] = pixels[1];
+            buf[1] = pixels[0];
+            buf[2] = pixels[2];
+        }
+    }
+    return ESP_OK;
+}
+
 static esp_err_t led_strip_rmt_refresh(led_strip_t *strip)
 {
     led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
@@ -124,7 +147,9 @@ esp_err_t led_strip_new_rmt_device(const led_strip_config_t *led_config, const l
     esp_err_t ret = ESP_OK;
     ESP_RETURN_ON_FALSE(led_config && dev_config && ret_strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
     ESP_RETURN_ON_FALSE(led_config->led_pixel_format < LED_PIXEL_FORMAT_INVALID, ESP_ERR_INVALID_ARG, TAG, "invalid led_pixel_format");
+    ESP_RETURN_ON_FALSE(led_config->led_model == LED_MODEL_WS2812 || led_config->led_model == LED_MODEL_SK6812, ESP_ERR_INVALID_ARG, TAG, "invalid led model");
     ESP_RETURN_ON_FALSE(dev_config->flags.with_dma == 0, ESP_ERR_NOT_SUPPORTED, TAG, "DMA is not supported");
+    ESP_RETURN_ON_FALSE(dev_config->flags.stream == 0, ESP_ERR_NOT_SUPPORTED, TAG, "stream is not supported");
 
     uint8_t bytes_per_pixel = 3;
     if (led_config->led_pixel_format == LED_PIXEL_FORMAT_GRBW) {
@@ -179,6 +204,8 @@ esp_err_t led_strip_new_rmt_device(const led_strip_config_t *led_config, const l
     rmt_strip->rmt_channel = (rmt_channel_t)dev_config->rmt_channel;
     rmt_strip->strip_len = led_config->max_leds;
     rmt_strip->base.set_pixel = led_strip_rmt_set_pixel;
+    rmt_strip->base.set_pixels = led_strip_rmt_set_pixels;
+    rmt_strip->base.bytes_per_pixel = bytes_per_pixel;
     rmt_strip->base.refresh = led_strip_rmt_refresh;
     rmt_strip->base.clear = led_strip_rmt_clear;
     rmt_strip->base.del = led_strip_rmt_del;
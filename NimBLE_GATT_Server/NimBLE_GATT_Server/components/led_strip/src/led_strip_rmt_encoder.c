@@ -4,9 +4,12 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <string.h>
 #include "esp_check.h"
 #include "led_strip_rmt_encoder.h"
 
+#define LED_STRIP_RMT_STREAM_CHUNK_BYTES (LED_STRIP_RMT_STREAM_CHUNK_PIXELS * 4)
+
 static const char *TAG = "led_rmt_encoder";
 
 typedef struct {
@@ -15,8 +18,71 @@ typedef struct {
     rmt_encoder_t *copy_encoder;
     int state;
     rmt_symbol_word_t reset_code;
+    bool stream;
+    uint32_t next_pixel;     // stream: first pixel of the next chunk
+    size_t chunk_len;        // stream: GRB(W) bytes in chunk, 0 once they are encoded
+    uint8_t *rgb;            // stream: pixels from fill_cb
+    uint8_t *chunk;          // stream: GRB(W) bytes being encoded
+    uint8_t buf[];
 } rmt_led_strip_encoder_t;
 
+// RGB(W) in, color corrected GRB(W) out
+static void rmt_led_strip_render_chunk(rmt_led_strip_encoder_t *led_encoder, const led_strip_rmt_stream_t *stream)
+{
+    uint8_t bytes_per_pixel = stream->bytes_per_pixel;
+    uint32_t count = stream->num_pixels - led_encoder->next_pixel;
+    if (count > LED_STRIP_RMT_STREAM_CHUNK_PIXELS) {
+        count = LED_STRIP_RMT_STREAM_CHUNK_PIXELS;
+    }
+    const uint8_t *rgb = led_encoder->rgb;
+    if (stream->source.pixels) {
+        rgb = stream->source.pixels + led_encoder->next_pixel * bytes_per_pixel;
+    } else if (stream->source.fill_cb) {
+        stream->source.fill_cb(led_encoder->next_pixel, count, led_encoder->rgb, stream->source.user_ctx);
+    } else {
+        memset(led_encoder->rgb, 0, count * bytes_per_pixel);
+    }
+
+    const uint8_t *lut = stream->lut;
+    uint8_t *out = led_encoder->chunk;
+    for (uint32_t i = 0; i < count; i++, rgb += bytes_per_pixel, out += bytes_per_pixel) {
+        out[0] = lut ? lut[rgb[1]] : rgb[1];
+        out[1] = lut ? lut[rgb[0]] : rgb[0];
+        out[2] = lut ? lut[rgb[2]] : rgb[2];
+        if (bytes_per_pixel > 3) {
+            out[3] = lut ? lut[rgb[3]] : rgb[3];
+        }
+    }
+    led_encoder->next_pixel += count;
+    led_encoder->chunk_len = count * bytes_per_pixel;
+}
+
+// the bytes encoder keeps its position in the chunk across calls, the chunk is only rendered again once it is done
+static size_t rmt_encode_led_strip_stream(rmt_led_strip_encoder_t *led_encoder, rmt_channel_handle_t channel, const led_strip_rmt_stream_t *stream, rmt_encode_state_t *ret_state)
+{
+    rmt_encoder_handle_t bytes_encoder = led_encoder->bytes_encoder;
+    rmt_encode_state_t session_state = 0;
+    size_t encoded_symbols = 0;
+    for (;;) {
+        if (!led_encoder->chunk_len) {
+            if (led_encoder->next_pixel >= stream->num_pixels) {
+                led_encoder->next_pixel = 0;
+                *ret_state = RMT_ENCODING_COMPLETE;
+                return encoded_symbols;
+            }
+            rmt_led_strip_render_chunk(led_encoder, stream);
+        }
+        encoded_symbols += bytes_encoder->encode(bytes_encoder, channel, led_encoder->chunk, led_encoder->chunk_len, &session_state);
+        if (session_state & RMT_ENCODING_COMPLETE) {
+            led_encoder->chunk_len = 0;
+        }
+        if (session_state & RMT_ENCODING_MEM_FULL) {
+            *ret_state = RMT_ENCODING_MEM_FULL;
+            return encoded_symbols;
+        }
+    }
+}
+
 static size_t rmt_encode_led_strip(rmt_encoder_t *encoder, rmt_channel_handle_t channel, const void *primary_data, size_t data_size, rmt_encode_state_t *ret_state)
 {
     rmt_led_strip_encoder_t *led_encoder = __containerof(encoder, rmt_led_strip_encoder_t, base);
@@ -27,7 +93,11 @@ static size_t rmt_encode_led_strip(rmt_encoder_t *encoder, rmt_channel_handle_t
     size_t encoded_symbols = 0;
     switch (led_encoder->state) {
     case 0: // send RGB data
-        encoded_symbols += bytes_encoder->encode(bytes_encoder, channel, primary_data, data_size, &session_state);
+        if (led_encoder->stream) {
+            encoded_symbols += rmt_encode_led_strip_stream(led_encoder, channel, primary_data, &session_state);
+        } else {
+            encoded_symbols += bytes_encoder->encode(bytes_encoder, channel, primary_data, data_size, &session_state);
+        }
         if (session_state & RMT_ENCODING_COMPLETE) {
             led_encoder->state = 1; // switch to next state when current encoding session finished
         }
@@ -68,6 +138,8 @@ static esp_err_t rmt_led_strip_encoder_reset(rmt_encoder_t *encoder)
     rmt_encoder_reset(led_encoder->bytes_encoder);
     rmt_encoder_reset(led_encoder->copy_encoder);
     led_encoder->state = 0;
+    led_encoder->next_pixel = 0;
+    led_encoder->chunk_len = 0;
     return ESP_OK;
 }
 
@@ -76,9 +148,15 @@ esp_err_t rmt_new_led_strip_encoder(const led_strip_encoder_config_t *config, rm
     esp_err_t ret = ESP_OK;
     rmt_led_strip_encoder_t *led_encoder = NULL;
     ESP_GOTO_ON_FALSE(config && ret_encoder, ESP_ERR_INVALID_ARG, err, TAG, "invalid argument");
-    ESP_GOTO_ON_FALSE(config->led_model < LED_MODEL_INVALID, ESP_ERR_INVALID_ARG, err, TAG, "invalid led model");
-    led_encoder = calloc(1, sizeof(rmt_led_strip_encoder_t));
+    ESP_GOTO_ON_FALSE(config->led_model == LED_MODEL_WS2812 || config->led_model == LED_MODEL_SK6812, ESP_ERR_INVALID_ARG, err, TAG, "invalid led model");
+    // a stream encoder renders into two chunk buffers, the pixel source and the bytes being encoded
+    led_encoder = calloc(1, sizeof(rmt_led_strip_encoder_t) + (config->stream ? LED_STRIP_RMT_STREAM_CHUNK_BYTES * 2 : 0));
     ESP_GOTO_ON_FALSE(led_encoder, ESP_ERR_NO_MEM, err, TAG, "no mem for led strip encoder");
+    if (config->stream) {
+        led_encoder->stream = true;
+        led_encoder->rgb = led_encoder->buf;
+        led_encoder->chunk = led_encoder->buf + LED_STRIP_RMT_STREAM_CHUNK_BYTES;
+    }
     led_encoder->base.encode = rmt_encode_led_strip;
     led_encoder->base.del = rmt_del_led_strip_encoder;
     led_encoder->base.reset = rmt_led_strip_encoder_reset;
@@ -8,6 +8,7 @@
 #include <stdint.h>
 #include "driver/rmt_encoder.h"
 #include "led_strip_types.h"
+#include "led_strip_rmt.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -19,8 +20,19 @@ extern "C" {
 typedef struct {
     uint32_t resolution;   /*!< Encoder resolution, in Hz */
     led_model_t led_model; /*!< LED model */
+    bool stream;           /*!< The data to encode is a led_strip_rmt_stream_t instead of GRB(W) bytes */
 } led_strip_encoder_config_t;
 
+/**
+ * @brief Frame rendered by a stream encoder, passed to `rmt_transmit` as its payload
+ */
+typedef struct {
+    led_strip_rmt_stream_source_t source; /*!< Where the RGB(W) pixels come from */
+    const uint8_t *lut;                   /*!< Gamma / brightness table, NULL for none */
+    uint32_t num_pixels;                  /*!< Pixels of the frame */
+    uint8_t bytes_per_pixel;              /*!< 3 for GRB, 4 for GRBW */
+} led_strip_rmt_stream_t;
+
 /**
  * @brief Create RMT encoder for encoding LED strip pixels into RMT symbols
  *
@@ -0,0 +1,359 @@
+/*
+ * SPDX-FileCopyrightText: 2022-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <sys/cdefs.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_attr.h"
+#include "esp_rom_gpio.h"
+#include "soc/spi_periph.h"
+#include "led_strip.h"
+#include "led_strip_interface.h"
+#include "led_strip_spi_encoder.h"
+#include "led_strip_color.h"
+#include "hal/spi_hal.h"
+
+#define LED_STRIP_SPI_DEFAULT_RESOLUTION (2.5 * 1000 * 1000) // 2.5MHz resolution
+#define LED_STRIP_SPI_DEFAULT_TRANS_QUEUE_SIZE 4
+
+static const char *TAG = "led_strip_spi";
+
+typedef struct {
+    led_strip_t base;
+    spi_host_device_t spi_host;
+    spi_device_handle_t spi_device;
+    spi_transaction_t trans;      // frame queued by refresh_async
+    bool trans_queued;            // trans is owned by the driver until its result is fetched
+    uint32_t mem_caps;
+    led_strip_frame_done_cb_t on_frame_done;
+    void *user_ctx;
+    uint8_t *pixel_buf;           // back buffer, written by set_pixel
+    uint8_t *tx_buf;              // front buffer of asynchronous refresh, allocated on first use
+    led_strip_color_t *color;     // gamma / brightness, NULL until the application sets one
+    uint32_t strip_len;
+    uint8_t bytes_per_pixel;
+    uint8_t buf[] __attribute__((aligned(4))); // word aligned, so DMA can read it without a bounce buffer
+} led_strip_spi_obj;
+
+static void IRAM_ATTR led_strip_spi_post_cb(spi_transaction_t *trans)
+{
+    led_strip_spi_obj *spi_strip = (led_strip_spi_obj *)trans->user;
+    if (spi_strip && spi_strip->on_frame_done && spi_strip->on_frame_done(&spi_strip->base, spi_strip->user_ctx)) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+// fetch the result of the frame queued by refresh_async, if any
+static esp_err_t led_strip_spi_wait_queued(led_strip_spi_obj *spi_strip, TickType_t ticks)
+{
+    spi_transaction_t *done = NULL;
+    if (!spi_strip->trans_queued) {
+        return ESP_OK;
+    }
+    esp_err_t ret = spi_device_get_trans_result(spi_strip->spi_device, &done, ticks);
+    if (ret == ESP_OK) {
+        spi_strip->trans_queued = false;
+    }
+    return ret;
+}
+
+static esp_err_t led_strip_spi_set_pixel(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue)
+{
+    led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
+    ESP_RETURN_ON_FALSE(index < spi_strip->strip_len, ESP_ERR_INVALID_ARG, TAG, "index out of maximum number of LEDs");
+    led_strip_color_t *color = spi_strip->color;
+    uint32_t offset = index * spi_strip->bytes_per_pixel;
+    // LED_PIXEL_FORMAT_GRB takes 72bits(9bytes)
+    uint32_t start = offset * SPI_BYTES_PER_COLOR_BYTE;
+    led_strip_spi_encode_byte(led_strip_color_apply(color, offset + 0, green), &spi_strip->pixel_buf[start]);
+    led_strip_spi_encode_byte(led_strip_color_apply(color, offset + 1, red), &spi_strip->pixel_buf[start + SPI_BYTES_PER_COLOR_BYTE]);
+    led_strip_spi_encode_byte(led_strip_color_apply(color, offset + 2, blue), &spi_strip->pixel_buf[start + SPI_BYTES_PER_COLOR_BYTE * 2]);
+    if (spi_strip->bytes_per_pixel > 3) {
+        led_strip_spi_encode_byte(led_strip_color_apply(color, offset + 3, 0), &spi_strip->pixel_buf[start + SPI_BYTES_PER_COLOR_BYTE * 3]);
+    }
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_spi_set_pixel_rgbw(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue, uint32_t white)
+{
+    led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
+    ESP_RETURN_ON_FALSE(index < spi_strip->strip_len, ESP_ERR_INVALID_ARG, TAG, "index out of maximum number of LEDs");
+    ESP_RETURN_ON_FALSE(spi_strip->bytes_per_pixel == 4, ESP_ERR_INVALID_ARG, TAG, "wrong LED pixel format, expected 4 bytes per pixel");
+    led_strip_color_t *color = spi_strip->color;
+    uint32_t offset = index * spi_strip->bytes_per_pixel;
+    // LED_PIXEL_FORMAT_GRBW takes 96bits(12bytes)
+    uint32_t start = offset * SPI_BYTES_PER_COLOR_BYTE;
+    // SK6812 component order is GRBW
+    led_strip_spi_encode_byte(led_strip_color_apply(color, offset + 0, green), &spi_strip->pixel_buf[start]);
+    led_strip_spi_encode_byte(led_strip_color_apply(color, offset + 1, red), &spi_strip->pixel_buf[start + SPI_BYTES_PER_COLOR_BYTE]);
+    led_strip_spi_encode_byte(led_strip_color_apply(color, offset + 2, blue), &spi_strip->pixel_buf[start + SPI_BYTES_PER_COLOR_BYTE * 2]);
+    led_strip_spi_encode_byte(led_strip_color_apply(color, offset + 3, white), &spi_strip->pixel_buf[start + SPI_BYTES_PER_COLOR_BYTE * 3]);
+
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_spi_set_pixels(led_strip_t *strip, uint32_t start, uint32_t count, const uint8_t *pixels)
+{
+    led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
+    ESP_RETURN_ON_FALSE(count <= spi_strip->strip_len && start <= spi_strip->strip_len - count, ESP_ERR_INVALID_ARG, TAG, "pixel range out of maximum number of LEDs");
+    led_strip_color_t *color = spi_strip->color;
+    uint8_t bytes_per_pixel = spi_strip->bytes_per_pixel;
+    uint32_t offset = start * bytes_per_pixel;
+    uint8_t *buf = spi_strip->pixel_buf + offset * SPI_BYTES_PER_COLOR_BYTE;
+    // RGB(W) in, GRB(W) out
+    for (uint32_t i = 0; i < count; i++, pixels += bytes_per_pixel, offset += bytes_per_pixel) {
+        led_strip_spi_encode_byte(led_strip_color_apply(color, offset + 0, pixels[1]), buf);
+        led_strip_spi_encode_byte(led_strip_color_apply(color, offset + 1, pixels[0]), buf + SPI_BYTES_PER_COLOR_BYTE);
+        led_strip_spi_encode_byte(led_strip_color_apply(color, offset + 2, pixels[2]), buf + SPI_BYTES_PER_COLOR_BYTE * 2);
+        buf += SPI_BYTES_PER_COLOR_BYTE * 3;
+        if (bytes_per_pixel > 3) {
+            led_strip_spi_encode_byte(led_strip_color_apply(color, offset + 3, pixels[3]), buf);
+            buf += SPI_BYTES_PER_COLOR_BYTE;
+        }
+    }
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_spi_refresh(led_strip_t *strip)
+{
+    led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
+    spi_transaction_t tx_conf;
+    memset(&tx_conf, 0, sizeof(tx_conf));
+
+    // a blocking transmit must not be mixed with a queued one that is not finalized
+    ESP_RETURN_ON_ERROR(led_strip_spi_wait_queued(spi_strip, portMAX_DELAY), TAG, "wait for queued frame failed");
+    tx_conf.length = spi_strip->strip_len * spi_strip->bytes_per_pixel * SPI_BITS_PER_COLOR_BYTE;
+    tx_conf.tx_buffer = spi_strip->pixel_buf;
+    tx_conf.rx_buffer = NULL;
+    tx_conf.user = spi_strip;
+    ESP_RETURN_ON_ERROR(spi_device_transmit(spi_strip->spi_device, &tx_conf), TAG, "transmit pixels by SPI failed");
+
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_spi_refresh_async(led_strip_t *strip)
+{
+    led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
+    size_t frame_size = spi_strip->strip_len * spi_strip->bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE;
+
+    // the front buffer is only needed once the application encodes during transmission
+    if (!spi_strip->tx_buf) {
+        spi_strip->tx_buf = heap_caps_malloc(frame_size, spi_strip->mem_caps);
+        ESP_RETURN_ON_FALSE(spi_strip->tx_buf, ESP_ERR_NO_MEM, TAG, "no mem for front buffer");
+    }
+
+    // the previous frame has left the front buffer once its result is back
+    ESP_RETURN_ON_ERROR(led_strip_spi_wait_queued(spi_strip, portMAX_DELAY), TAG, "wait for queued frame failed");
+    uint8_t *front = spi_strip->pixel_buf;
+    spi_strip->pixel_buf = spi_strip->tx_buf;
+    spi_strip->tx_buf = front;
+    // the new back buffer starts from the frame just queued, so partial updates keep working
+    memcpy(spi_strip->pixel_buf, front, frame_size);
+
+    memset(&spi_strip->trans, 0, sizeof(spi_strip->trans));
+    spi_strip->trans.length = frame_size * 8;
+    spi_strip->trans.tx_buffer = front;
+    spi_strip->trans.user = spi_strip;
+    ESP_RETURN_ON_ERROR(spi_device_queue_trans(spi_strip->spi_device, &spi_strip->trans, portMAX_DELAY), TAG, "queue pixels by SPI failed");
+    spi_strip->trans_queued = true;
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_spi_wait_refresh_done(led_strip_t *strip, int32_t timeout_ms)
+{
+    led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
+    return led_strip_spi_wait_queued(spi_strip, timeout_ms < 0 ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms));
+}
+
+static esp_err_t led_strip_spi_register_frame_done_cb(led_strip_t *strip, led_strip_frame_done_cb_t cb, void *user_ctx)
+{
+    led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
+    spi_strip->on_frame_done = cb;
+    spi_strip->user_ctx = user_ctx;
+    return ESP_OK;
+}
+
+// the color correction state starts from the colors already encoded in the pixel buffer
+static esp_err_t led_strip_spi_get_color(led_strip_spi_obj *spi_strip, led_strip_color_t **ret_color)
+{
+    if (!spi_strip->color) {
+        size_t len = spi_strip->strip_len * spi_strip->bytes_per_pixel;
+        spi_strip->color = led_strip_color_new(len);
+        ESP_RETURN_ON_FALSE(spi_strip->color, ESP_ERR_NO_MEM, TAG, "no mem for color correction");
+        for (size_t i = 0; i < len; i++) {
+            spi_strip->color->raw[i] = led_strip_spi_decode_byte(spi_strip->pixel_buf + i * SPI_BYTES_PER_COLOR_BYTE);
+        }
+    }
+    *ret_color = spi_strip->color;
+    return ESP_OK;
+}
+
+// encode the stored frame again through the new table
+static void led_strip_spi_apply_color(led_strip_spi_obj *spi_strip)
+{
+    const led_strip_color_t *color = spi_strip->color;
+    uint8_t *buf = spi_strip->pixel_buf;
+    for (uint32_t i = 0; i < spi_strip->strip_len * spi_strip->bytes_per_pixel; i++) {
+        led_strip_spi_encode_byte(color->lut[color->raw[i]], buf);
+        buf += SPI_BYTES_PER_COLOR_BYTE;
+    }
+}
+
+static esp_err_t led_strip_spi_set_gamma_table(led_strip_t *strip, const uint8_t *table)
+{
+    led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
+    led_strip_color_t *color = NULL;
+    ESP_RETURN_ON_ERROR(led_strip_spi_get_color(spi_strip, &color), TAG, "set gamma table failed");
+    led_strip_color_set_gamma(color, table);
+    led_strip_spi_apply_color(spi_strip);
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_spi_set_brightness(led_strip_t *strip, uint8_t brightness)
+{
+    led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
+    led_strip_color_t *color = NULL;
+    ESP_RETURN_ON_ERROR(led_strip_spi_get_color(spi_strip, &color), TAG, "set brightness failed");
+    led_strip_color_set_brightness(color, brightness);
+    led_strip_spi_apply_color(spi_strip);
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_spi_clear(led_strip_t *strip)
+{
+    led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
+    //Write zero to turn off all leds
+    uint8_t *buf = spi_strip->pixel_buf;
+    for (int index = 0; index < spi_strip->strip_len * spi_strip->bytes_per_pixel; index++) {
+        led_strip_spi_encode_byte(0, buf);
+        buf += SPI_BYTES_PER_COLOR_BYTE;
+    }
+    if (spi_strip->color) {
+        memset(spi_strip->color->raw, 0, spi_strip->strip_len * spi_strip->bytes_per_pixel);
+    }
+
+    return led_strip_spi_refresh(strip);
+}
+
+static esp_err_t led_strip_spi_del(led_strip_t *strip)
+{
+    led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
+
+    // let the last frame go out before removing the device
+    ESP_RETURN_ON_ERROR(led_strip_spi_wait_queued(spi_strip, portMAX_DELAY), TAG, "wait for queued frame failed");
+    ESP_RETURN_ON_ERROR(spi_bus_remove_device(spi_strip->spi_device), TAG, "delete spi device failed");
+    ESP_RETURN_ON_ERROR(spi_bus_free(spi_strip->spi_host), TAG, "free spi bus failed");
+
+    // tx_buf may point into buf after a swap, free whichever buffer was allocated separately
+    free(spi_strip->pixel_buf == spi_strip->buf ? spi_strip->tx_buf : spi_strip->pixel_buf);
+    free(spi_strip->color);
+    free(spi_strip);
+    return ESP_OK;
+}
+
+esp_err_t led_strip_new_spi_device(const led_strip_config_t *led_config, const led_strip_spi_config_t *spi_config, led_strip_handle_t *ret_strip)
+{
+    led_strip_spi_obj *spi_strip = NULL;
+    esp_err_t ret = ESP_OK;
+    ESP_GOTO_ON_FALSE(led_config && spi_config && ret_strip, ESP_ERR_INVALID_ARG, err, TAG, "invalid argument");
+    ESP_GOTO_ON_FALSE(led_config->led_pixel_format < LED_PIXEL_FORMAT_INVALID, ESP_ERR_INVALID_ARG, err, TAG, "invalid led_pixel_format");
+    // clocked LEDs have their own backend
+    ESP_GOTO_ON_FALSE(led_config->led_model == LED_MODEL_WS2812 || led_config->led_model == LED_MODEL_SK6812, ESP_ERR_INVALID_ARG, err, TAG, "invalid led model");
+    uint8_t bytes_per_pixel = 3;
+    if (led_config->led_pixel_format == LED_PIXEL_FORMAT_GRBW) {
+        bytes_per_pixel = 4;
+    } else if (led_config->led_pixel_format == LED_PIXEL_FORMAT_GRB) {
+        bytes_per_pixel = 3;
+    } else {
+        assert(false);
+    }
+    uint32_t mem_caps = MALLOC_CAP_DEFAULT;
+    if (spi_config->flags.with_dma) {
+        // DMA buffer must be placed in internal SRAM
+        mem_caps |= MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA;
+    }
+    spi_strip = heap_caps_calloc(1, sizeof(led_strip_spi_obj) + led_config->max_leds * bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE, mem_caps);
+
+    ESP_GOTO_ON_FALSE(spi_strip, ESP_ERR_NO_MEM, err, TAG, "no mem for spi strip");
+    spi_strip->pixel_buf = spi_strip->buf;
+    spi_strip->mem_caps = mem_caps;
+
+    spi_strip->spi_host = spi_config->spi_bus;
+    // for backward compatibility, if the user does not set the clk_src, use the default value
+    spi_clock_source_t clk_src = SPI_CLK_SRC_DEFAULT;
+    if (spi_config->clk_src) {
+        clk_src = spi_config->clk_src;
+    }
+
+    spi_bus_config_t spi_bus_cfg = {
+        .mosi_io_num = led_config->strip_gpio_num,
+        //Only use MOSI to generate the signal, set -1 when other pins are not used.
+        .miso_io_num = -1,
+        .sclk_io_num = -1,
+        .quadwp_io_num = -1,
+        .quadhd_io_num = -1,
+        .max_transfer_sz = led_config->max_leds * bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE,
+    };
+    ESP_GOTO_ON_ERROR(spi_bus_initialize(spi_strip->spi_host, &spi_bus_cfg, spi_config->flags.with_dma ? SPI_DMA_CH_AUTO : SPI_DMA_DISABLED), err, TAG, "create SPI bus failed");
+
+    if (led_config->flags.invert_out == true) {
+        esp_rom_gpio_connect_out_signal(led_config->strip_gpio_num, spi_periph_signal[spi_strip->spi_host].spid_out, true, false);
+    }
+
+    spi_device_interface_config_t spi_dev_cfg = {
+        .clock_source = clk_src,
+        .command_bits = 0,
+        .address_bits = 0,
+        .dummy_bits = 0,
+        .clock_speed_hz = LED_STRIP_SPI_DEFAULT_RESOLUTION,
+        .mode = 0,
+        //set -1 when CS is not used
+        .spics_io_num = -1,
+        .queue_size = LED_STRIP_SPI_DEFAULT_TRANS_QUEUE_SIZE,
+        .post_cb = led_strip_spi_post_cb,
+    };
+
+    ESP_GOTO_ON_ERROR(spi_bus_add_device(spi_strip->spi_host, &spi_dev_cfg, &spi_strip->spi_device), err, TAG, "Failed to add spi device");
+    //ensure the reset time is enough
+    esp_rom_delay_us(10);
+    int clock_resolution_khz = 0;
+    spi_device_get_actual_freq(spi_strip->spi_device, &clock_resolution_khz);
+    // TODO: ideally we should decide the SPI_BYTES_PER_COLOR_BYTE by the real clock resolution
+    // But now, let's fixed the resolution, the downside is, we don't support a clock source whose frequency is not multiple of LED_STRIP_SPI_DEFAULT_RESOLUTION
+    // clock_resolution between 2.2MHz to 2.8MHz is supported
+    ESP_GOTO_ON_FALSE((clock_resolution_khz < LED_STRIP_SPI_DEFAULT_RESOLUTION / 1000 + 300) && (clock_resolution_khz > LED_STRIP_SPI_DEFAULT_RESOLUTION / 1000 - 300), ESP_ERR_NOT_SUPPORTED, err,
+                      TAG, "unsupported clock resolution:%dKHz", clock_resolution_khz);
+
+    spi_strip->bytes_per_pixel = bytes_per_pixel;
+    spi_strip->strip_len = led_config->max_leds;
+    spi_strip->base.set_pixel = led_strip_spi_set_pixel;
+    spi_strip->base.set_pixel_rgbw = led_strip_spi_set_pixel_rgbw;
+    spi_strip->base.set_pixels = led_strip_spi_set_pixels;
+    spi_strip->base.bytes_per_pixel = bytes_per_pixel;
+    spi_strip->base.refresh = led_strip_spi_refresh;
+    spi_strip->base.refresh_async = led_strip_spi_refresh_async;
+    spi_strip->base.wait_refresh_done = led_strip_spi_wait_refresh_done;
+    spi_strip->base.register_frame_done_cb = led_strip_spi_register_frame_done_cb;
+    spi_strip->base.set_gamma_table = led_strip_spi_set_gamma_table;
+    spi_strip->base.set_brightness = led_strip_spi_set_brightness;
+    spi_strip->base.clear = led_strip_spi_clear;
+    spi_strip->base.del = led_strip_spi_del;
+
+    *ret_strip = &spi_strip->base;
+    return ESP_OK;
+err:
+    if (spi_strip) {
+        if (spi_strip->spi_device) {
+            spi_bus_remove_device(spi_strip->spi_device);
+        }
+        if (spi_strip->spi_host) {
+            spi_bus_free(spi_strip->spi_host);
+        }
+        free(spi_strip);
+    }
+    return ret;
+}
@@ -0,0 +1,24 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "esp_attr.h"
+#include "led_strip_spi_encoder.h"
+
+// 3 SPI bits of color bit n: 110 for 1, 100 for 0
+#define SPI_BIT(data, n) ((((data) >> (n)) & 1) ? 0x6 : 0x4)
+#define SPI_PATTERN(data) ((uint32_t)SPI_BIT(data, 7) << 21 | (uint32_t)SPI_BIT(data, 6) << 18 | \
+                           (uint32_t)SPI_BIT(data, 5) << 15 | (uint32_t)SPI_BIT(data, 4) << 12 | \
+                           (uint32_t)SPI_BIT(data, 3) << 9 | (uint32_t)SPI_BIT(data, 2) << 6 |   \
+                           (uint32_t)SPI_BIT(data, 1) << 3 | (uint32_t)SPI_BIT(data, 0))
+
+#define LUT_1(d) {(SPI_PATTERN(d) >> 16) & 0xFF, (SPI_PATTERN(d) >> 8) & 0xFF, SPI_PATTERN(d) & 0xFF}
+#define LUT_4(d) LUT_1(d), LUT_1((d) + 1), LUT_1((d) + 2), LUT_1((d) + 3)
+#define LUT_16(d) LUT_4(d), LUT_4((d) + 4), LUT_4((d) + 8), LUT_4((d) + 12)
+#define LUT_64(d) LUT_16(d), LUT_16((d) + 16), LUT_16((d) + 32), LUT_16((d) + 48)
+
+// Kept in DRAM: encoding a frame must not stall on flash cache misses
+DRAM_ATTR const uint8_t led_strip_spi_bit_lut[256][SPI_BYTES_PER_COLOR_BYTE] = {
+    LUT_64(0), LUT_64(64), LUT_64(128), LUT_64(192),
+};
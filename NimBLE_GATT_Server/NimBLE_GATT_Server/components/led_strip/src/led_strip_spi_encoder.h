@@ -0,0 +1,59 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SPI_BYTES_PER_COLOR_BYTE 3
+#define SPI_BITS_PER_COLOR_BYTE (SPI_BYTES_PER_COLOR_BYTE * 8)
+
+/**
+ * @brief SPI bit pattern of every color byte value
+ *
+ * Each color bit is sent as 3 SPI bits, MSB first: 0 as 100, 1 as 110.
+ * So a color byte occupies 3 bytes of SPI.
+ */
+extern const uint8_t led_strip_spi_bit_lut[256][SPI_BYTES_PER_COLOR_BYTE];
+
+/**
+ * @brief Encode one color byte into 3 SPI bytes
+ *
+ * @note The destination is overwritten, no need to clear it beforehand
+ *
+ * @param[in] data Color byte
+ * @param[out] buf Destination, SPI_BYTES_PER_COLOR_BYTE bytes
+ */
+static inline void led_strip_spi_encode_byte(uint8_t data, uint8_t *buf)
+{
+    const uint8_t *bits = led_strip_spi_bit_lut[data];
+    buf[0] = bits[0];
+    buf[1] = bits[1];
+    buf[2] = bits[2];
+}
+
+/**
+ * @brief Recover the color byte from its 3 SPI bytes
+ *
+ * @param[in] buf SPI_BYTES_PER_COLOR_BYTE bytes written by `led_strip_spi_encode_byte`
+ * @return Color byte, the middle bit of every 3 bit group
+ */
+static inline uint8_t led_strip_spi_decode_byte(const uint8_t *buf)
+{
+    uint32_t bits = (uint32_t)buf[0] << 16 | (uint32_t)buf[1] << 8 | buf[2];
+    uint8_t data = 0;
+    for (int n = 7; n >= 0; n--) {
+        data |= ((bits >> (3 * n + 1)) & 1) << n;
+    }
+    return data;
+}
+
+#ifdef __cplusplus
+}
+#endif
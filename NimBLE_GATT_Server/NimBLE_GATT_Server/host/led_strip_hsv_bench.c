@@ -0,0 +1,254 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+/* Includes */
+#include "led_strip_hsv.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+
+/*
+ * led_strip HSV conversion test and benchmark
+ *      Checks the integer HSV to RGB conversion of the led_strip component
+ *      against the floating point one it replaced. The output depends on
+ *      the hue only through its sector (capped at the last one) and the
+ *      offset inside it, so the sector split is checked for every 16 bit
+ *      hue and the colors for hue 0-419 (all sectors and offsets) times
+ *      every saturation and value; -a sweeps all 2^32 inputs instead.
+ *      Then both are timed over a random frame. Exits non-zero on a
+ *      mismatch.
+ */
+
+/* Defines */
+#define HUE_CLASSES 420
+
+/* Private variables */
+static size_t pixels = 1000;
+static unsigned runs = 200;
+static bool json = false;
+static bool all = false;
+
+/* Private functions */
+static uint64_t now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static uint64_t now_cycles(void) {
+#ifdef HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/* The previous conversion from led_strip_set_pixel_hsv */
+static void ref_hsv2rgb(uint16_t hue, uint8_t saturation, uint8_t value,
+                        uint8_t rgb[3]) {
+    uint32_t red, green, blue;
+    uint32_t rgb_max = value;
+    uint32_t rgb_min = rgb_max * (255 - saturation) / 255.0f;
+    uint32_t i = hue / 60;
+    uint32_t diff = hue % 60;
+    uint32_t rgb_adj = (rgb_max - rgb_min) * diff / 60;
+
+    switch (i) {
+    case 0:
+        red = rgb_max;
+        green = rgb_min + rgb_adj;
+        blue = rgb_min;
+        break;
+    case 1:
+        red = rgb_max - rgb_adj;
+        green = rgb_max;
+        blue = rgb_min;
+        break;
+    case 2:
+        red = rgb_min;
+        green = rgb_max;
+        blue = rgb_min + rgb_adj;
+        break;
+    case 3:
+        red = rgb_min;
+        green = rgb_max - rgb_adj;
+        blue = rgb_max;
+        break;
+    case 4:
+        red = rgb_min + rgb_adj;
+        green = rgb_min;
+        blue = rgb_max;
+        break;
+    default:
+        red = rgb_max;
+        green = rgb_min;
+        blue = rgb_max - rgb_adj;
+        break;
+    }
+    rgb[0] = red;
+    rgb[1] = green;
+    rgb[2] = blue;
+}
+
+static int check_sectors(void) {
+    int bad = 0;
+
+    for (uint32_t h = 0; h <= UINT16_MAX; h++) {
+        uint32_t i = (h * 34953U) >> 21;
+
+        if (i != h / 60 || h - i * 60 != h % 60) {
+            fprintf(stderr, "hue %u: sector %u, expected %u\n", h, i, h / 60);
+            bad++;
+        }
+    }
+    return bad;
+}
+
+static uint64_t check_colors(uint32_t hues) {
+    uint64_t bad = 0;
+
+    for (uint32_t h = 0; h < hues; h++) {
+        for (uint32_t s = 0; s < 256; s++) {
+            for (uint32_t v = 0; v < 256; v++) {
+                uint8_t ref[3], out[3];
+
+                ref_hsv2rgb(h, s, v, ref);
+                led_strip_hsv2rgb(h, s, v, out);
+                if (memcmp(ref, out, sizeof(ref)) != 0) {
+                    if (bad < 10) {
+                        fprintf(stderr,
+                                "hsv %u %u %u: %u %u %u, expected %u %u %u\n",
+                                h, s, v, out[0], out[1], out[2], ref[0],
+                                ref[1], ref[2]);
+                    }
+                    bad++;
+                }
+            }
+        }
+    }
+    return bad;
+}
+
+/* Best of runs, in ns and TSC cycles per frame */
+static void time_frame(void (*conv)(uint16_t, uint8_t, uint8_t, uint8_t *),
+                       const uint16_t *hue, const uint8_t *sv, uint8_t *out,
+                       uint64_t *ns, uint64_t *cycles) {
+    *ns = UINT64_MAX;
+    *cycles = UINT64_MAX;
+    for (unsigned r = 0; r < runs; r++) {
+        uint64_t t0 = now_ns();
+        uint64_t c0 = now_cycles();
+
+        for (size_t i = 0; i < pixels; i++) {
+            conv(hue[i], sv[i * 2], sv[i * 2 + 1], out + i * 3);
+        }
+        /* Keep the compiler from dropping or merging the runs */
+        __asm__ volatile("" : : "r"(out) : "memory");
+        uint64_t c = now_cycles() - c0;
+        uint64_t t = now_ns() - t0;
+        *ns = t < *ns ? t : *ns;
+        *cycles = c < *cycles ? c : *cycles;
+    }
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s [-n pixels] [-r runs] [-a] [-j]\n"
+            "  -n  pixels per frame (default 1000)\n"
+            "  -r  frames converted per implementation, best is reported "
+            "(default 200)\n"
+            "  -a  compare every 16 bit hue, not only 0-%d\n"
+            "  -j  print results as JSON\n",
+            prog, HUE_CLASSES - 1);
+}
+
+/* Public functions */
+int main(int argc, char **argv) {
+    uint16_t *hue;
+    uint8_t *sv, *ref, *out;
+    uint64_t ref_ns, int_ns, ref_cyc, int_cyc, bad;
+    uint32_t x = 0x5eed;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:r:ajh")) != -1) {
+        switch (opt) {
+        case 'n':
+            pixels = strtoul(optarg, NULL, 0);
+            break;
+        case 'r':
+            runs = atoi(optarg);
+            break;
+        case 'a':
+            all = true;
+            break;
+        case 'j':
+            json = true;
+            break;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (pixels == 0 || runs == 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    hue = malloc(pixels * sizeof(*hue));
+    sv = malloc(pixels * 2);
+    ref = malloc(pixels * 3);
+    out = malloc(pixels * 3);
+    for (size_t i = 0; i < pixels * 3; i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        if (i < pixels) {
+            hue[i] = x % 360;
+        } else {
+            sv[i - pixels] = x;
+        }
+    }
+
+    bad = check_sectors();
+    bad += check_colors(all ? UINT16_MAX + 1 : HUE_CLASSES);
+    time_frame(ref_hsv2rgb, hue, sv, ref, &ref_ns, &ref_cyc);
+    time_frame(led_strip_hsv2rgb, hue, sv, out, &int_ns, &int_cyc);
+    if (memcmp(ref, out, pixels * 3) != 0) {
+        fprintf(stderr, "converted frames differ\n");
+        bad++;
+    }
+
+    if (json) {
+        printf("{\"bench\": \"led_strip_hsv\", \"pixels\": %zu, \"runs\": %u"
+               ", \"float_ns\": %llu, \"int_ns\": %llu"
+               ", \"float_cycles\": %llu, \"int_cycles\": %llu"
+               ", \"match\": %s}\n",
+               pixels, runs, (unsigned long long)ref_ns,
+               (unsigned long long)int_ns, (unsigned long long)ref_cyc,
+               (unsigned long long)int_cyc, bad ? "false" : "true");
+    } else {
+        printf("%zu pixels, best of %u frames\n", pixels, runs);
+        printf("float   %8.2f ns/pixel %8.2f cycles/pixel\n",
+               (double)ref_ns / pixels, (double)ref_cyc / pixels);
+        printf("integer %8.2f ns/pixel %8.2f cycles/pixel  %.1fx\n",
+               (double)int_ns / pixels, (double)int_cyc / pixels,
+               int_ns ? (double)ref_ns / int_ns : 0);
+        printf("result  %s\n", bad ? "MISMATCH" : "OK");
+    }
+
+    free(out);
+    free(ref);
+    free(sv);
+    free(hue);
+    return bad ? 1 : 0;
+}
@@ -0,0 +1,186 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+/* Includes */
+#include "led_strip_i80_transpose.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * led_strip parallel bus transpose benchmark
+ *      Checks the 8x8 bit transpose of the led_strip i80 backend against a
+ *      bit by bit one, over random inputs and every single set bit, then
+ *      times turning 8 GRB strips into bus bytes (one bit of every strip
+ *      per byte) both ways. Exits non-zero on a mismatch.
+ */
+
+/* Defines */
+#define STRIPS 8
+#define BYTES_PER_PIXEL 3
+
+/* Private variables */
+static size_t pixels = 500;
+static unsigned runs = 200;
+static bool json = false;
+
+/* Private functions */
+static uint64_t now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void ref_transpose8(const uint8_t in[8], uint8_t out[8]) {
+    for (int j = 0; j < 8; j++) {
+        out[j] = 0;
+        for (int k = 0; k < 8; k++) {
+            out[j] |= ((in[k] >> (7 - j)) & 1) << k;
+        }
+    }
+}
+
+/* The same loop as led_strip_i80_encode, without the 3 cycle framing */
+static void encode_frame(void (*transpose)(const uint8_t *, uint8_t *),
+                         const uint8_t *strips, uint8_t *out) {
+    size_t bytes_per_strip = pixels * BYTES_PER_PIXEL;
+    uint8_t in[STRIPS];
+
+    for (size_t i = 0; i < bytes_per_strip; i++, out += 8) {
+        for (int n = 0; n < STRIPS; n++) {
+            in[n] = strips[n * bytes_per_strip + i];
+        }
+        transpose(in, out);
+    }
+}
+
+static int check_kernel(void) {
+    uint32_t x = 0x1234567;
+    int bad = 0;
+
+    for (int n = 0; n < 100000 + 64; n++) {
+        uint8_t in[8], ref[8], out[8];
+
+        for (int k = 0; k < 8; k++) {
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            /* the first 64 rounds set one bit each */
+            in[k] = n < 64 ? (n / 8 == k) << (n % 8) : x;
+        }
+        ref_transpose8(in, ref);
+        led_strip_i80_transpose8(in, out);
+        if (memcmp(ref, out, sizeof(ref)) != 0) {
+            if (bad < 10) {
+                fprintf(stderr, "%02x %02x %02x %02x %02x %02x %02x %02x\n",
+                        in[0], in[1], in[2], in[3], in[4], in[5], in[6],
+                        in[7]);
+            }
+            bad++;
+        }
+    }
+    return bad;
+}
+
+/* Best of runs, in ns per frame */
+static uint64_t time_frame(void (*transpose)(const uint8_t *, uint8_t *),
+                           const uint8_t *strips, uint8_t *out) {
+    uint64_t best = UINT64_MAX;
+
+    for (unsigned r = 0; r < runs; r++) {
+        uint64_t t0 = now_ns();
+        encode_frame(transpose, strips, out);
+        /* Keep the compiler from dropping or merging the runs */
+        __asm__ volatile("" : : "r"(out) : "memory");
+        uint64_t t = now_ns() - t0;
+        best = t < best ? t : best;
+    }
+    return best;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s [-n pixels] [-r runs] [-j]\n"
+            "  -n  pixels per strip (default 500)\n"
+            "  -r  frames encoded per kernel, best is reported "
+            "(default 200)\n"
+            "  -j  print results as JSON\n",
+            prog);
+}
+
+/* Public functions */
+int main(int argc, char **argv) {
+    size_t frame_len;
+    uint8_t *strips, *ref, *out;
+    uint64_t ref_ns, fast_ns;
+    uint32_t x = 0x5eed;
+    int opt, bad;
+
+    while ((opt = getopt(argc, argv, "n:r:jh")) != -1) {
+        switch (opt) {
+        case 'n':
+            pixels = strtoul(optarg, NULL, 0);
+            break;
+        case 'r':
+            runs = atoi(optarg);
+            break;
+        case 'j':
+            json = true;
+            break;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (pixels == 0 || runs == 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    frame_len = pixels * BYTES_PER_PIXEL * STRIPS;
+    strips = malloc(frame_len);
+    ref = malloc(frame_len);
+    out = malloc(frame_len);
+    for (size_t i = 0; i < frame_len; i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        strips[i] = x;
+    }
+
+    bad = check_kernel();
+    ref_ns = time_frame(ref_transpose8, strips, ref);
+    fast_ns = time_frame(led_strip_i80_transpose8, strips, out);
+    if (memcmp(ref, out, frame_len) != 0) {
+        fprintf(stderr, "encoded frames differ\n");
+        bad++;
+    }
+
+    if (json) {
+        printf("{\"bench\": \"led_strip_i80\", \"strips\": %d, \"pixels\": %zu"
+               ", \"runs\": %u, \"bitwise_ns\": %llu, \"transpose_ns\": %llu"
+               ", \"match\": %s}\n",
+               STRIPS, pixels, runs, (unsigned long long)ref_ns,
+               (unsigned long long)fast_ns, bad ? "false" : "true");
+    } else {
+        printf("%d strips x %zu pixels, best of %u frames\n", STRIPS, pixels,
+               runs);
+        printf("bitwise   %10.1f us/frame %8.2f ns/LED\n", ref_ns / 1e3,
+               (double)ref_ns / (pixels * STRIPS));
+        printf("transpose %10.1f us/frame %8.2f ns/LED  %.1fx\n",
+               fast_ns / 1e3, (double)fast_ns / (pixels * STRIPS),
+               fast_ns ? (double)ref_ns / fast_ns : 0);
+        printf("result    %s\n", bad ? "MISMATCH" : "OK");
+    }
+
+    free(out);
+    free(ref);
+    free(strips);
+    return bad ? 1 : 0;
+}
@@ -0,0 +1,185 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+/* Includes */
+#include "led_strip_spi_encoder.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * led_strip SPI encoder benchmark
+ *      Compares the lookup table encoder of the led_strip SPI backend
+ *      with the bitwise encoder it replaced: first bit for bit over all
+ *      256 color byte values, then the time to encode a GRB frame the
+ *      way led_strip_spi_set_pixel does. Exits non-zero on a mismatch.
+ */
+
+/* Defines */
+#define BIT(n) (1U << (n))
+#define BYTES_PER_PIXEL 3
+
+/* Private variables */
+static size_t pixels = 1000;
+static unsigned runs = 200;
+static bool json = false;
+
+/* Private functions */
+static uint64_t now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* The previous encoder, the destination must be zeroed first */
+static void ref_encode_byte(uint8_t data, uint8_t *buf) {
+    *(buf + 2) |= data & BIT(0) ? BIT(2) | BIT(1) : BIT(2);
+    *(buf + 2) |= data & BIT(1) ? BIT(5) | BIT(4) : BIT(5);
+    *(buf + 2) |= data & BIT(2) ? BIT(7) : 0x00;
+    *(buf + 1) |= BIT(0);
+    *(buf + 1) |= data & BIT(3) ? BIT(3) | BIT(2) : BIT(3);
+    *(buf + 1) |= data & BIT(4) ? BIT(6) | BIT(5) : BIT(6);
+    *(buf + 0) |= data & BIT(5) ? BIT(1) | BIT(0) : BIT(1);
+    *(buf + 0) |= data & BIT(6) ? BIT(4) | BIT(3) : BIT(4);
+    *(buf + 0) |= data & BIT(7) ? BIT(7) | BIT(6) : BIT(7);
+}
+
+static void ref_encode_frame(const uint8_t *rgb, uint8_t *out) {
+    for (size_t i = 0; i < pixels; i++, rgb += 3) {
+        uint8_t *dst = out + i * BYTES_PER_PIXEL * SPI_BYTES_PER_COLOR_BYTE;
+
+        memset(dst, 0, BYTES_PER_PIXEL * SPI_BYTES_PER_COLOR_BYTE);
+        ref_encode_byte(rgb[1], dst);
+        ref_encode_byte(rgb[0], dst + SPI_BYTES_PER_COLOR_BYTE);
+        ref_encode_byte(rgb[2], dst + SPI_BYTES_PER_COLOR_BYTE * 2);
+    }
+}
+
+static void lut_encode_frame(const uint8_t *rgb, uint8_t *out) {
+    for (size_t i = 0; i < pixels; i++, rgb += 3) {
+        uint8_t *dst = out + i * BYTES_PER_PIXEL * SPI_BYTES_PER_COLOR_BYTE;
+
+        led_strip_spi_encode_byte(rgb[1], dst);
+        led_strip_spi_encode_byte(rgb[0], dst + SPI_BYTES_PER_COLOR_BYTE);
+        led_strip_spi_encode_byte(rgb[2], dst + SPI_BYTES_PER_COLOR_BYTE * 2);
+    }
+}
+
+static int check_table(void) {
+    int bad = 0;
+
+    for (int v = 0; v < 256; v++) {
+        uint8_t ref[SPI_BYTES_PER_COLOR_BYTE] = {0};
+        uint8_t lut[SPI_BYTES_PER_COLOR_BYTE] = {0xAA, 0xAA, 0xAA};
+
+        ref_encode_byte(v, ref);
+        led_strip_spi_encode_byte(v, lut);
+        if (memcmp(ref, lut, sizeof(ref)) != 0) {
+            fprintf(stderr, "0x%02x: %02x %02x %02x, expected %02x %02x %02x\n",
+                    v, lut[0], lut[1], lut[2], ref[0], ref[1], ref[2]);
+            bad++;
+        }
+    }
+    return bad;
+}
+
+/* Best of runs, in ns per frame */
+static uint64_t time_frame(void (*encode)(const uint8_t *, uint8_t *),
+                           const uint8_t *rgb, uint8_t *out) {
+    uint64_t best = UINT64_MAX;
+
+    for (unsigned r = 0; r < runs; r++) {
+        uint64_t t0 = now_ns();
+        encode(rgb, out);
+        /* Keep the compiler from dropping or merging the runs */
+        __asm__ volatile("" : : "r"(out) : "memory");
+        uint64_t t = now_ns() - t0;
+        best = t < best ? t : best;
+    }
+    return best;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s [-n pixels] [-r runs] [-j]\n"
+            "  -n  pixels per frame (default 1000)\n"
+            "  -r  frames encoded per encoder, best is reported "
+            "(default 200)\n"
+            "  -j  print results as JSON\n",
+            prog);
+}
+
+/* Public functions */
+int main(int argc, char **argv) {
+    size_t frame_len;
+    uint8_t *rgb, *ref, *out;
+    uint64_t ref_ns, lut_ns;
+    uint32_t x = 0x5eed;
+    int opt, bad;
+
+    while ((opt = getopt(argc, argv, "n:r:jh")) != -1) {
+        switch (opt) {
+        case 'n':
+            pixels = strtoul(optarg, NULL, 0);
+            break;
+        case 'r':
+            runs = atoi(optarg);
+            break;
+        case 'j':
+            json = true;
+            break;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (pixels == 0 || runs == 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    frame_len = pixels * BYTES_PER_PIXEL * SPI_BYTES_PER_COLOR_BYTE;
+    rgb = malloc(pixels * 3);
+    ref = malloc(frame_len);
+    out = malloc(frame_len);
+    for (size_t i = 0; i < pixels * 3; i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        rgb[i] = x;
+    }
+
+    bad = check_table();
+    ref_ns = time_frame(ref_encode_frame, rgb, ref);
+    lut_ns = time_frame(lut_encode_frame, rgb, out);
+    if (memcmp(ref, out, frame_len) != 0) {
+        fprintf(stderr, "encoded frames differ\n");
+        bad++;
+    }
+
+    if (json) {
+        printf("{\"bench\": \"led_strip_spi\", \"pixels\": %zu, \"runs\": %u"
+               ", \"bitwise_ns\": %llu, \"lut_ns\": %llu, \"match\": %s}\n",
+               pixels, runs, (unsigned long long)ref_ns,
+               (unsigned long long)lut_ns, bad ? "false" : "true");
+    } else {
+        printf("%zu pixels, best of %u frames\n", pixels, runs);
+        printf("bitwise %10.1f us/frame %8.2f ns/pixel\n", ref_ns / 1e3,
+               (double)ref_ns / pixels);
+        printf("lut     %10.1f us/frame %8.2f ns/pixel  %.1fx\n", lut_ns / 1e3,
+               (double)lut_ns / pixels,
+               lut_ns ? (double)ref_ns / lut_ns : 0);
+        printf("result  %s\n", bad ? "MISMATCH" : "OK");
+    }
+
+    free(out);
+    free(ref);
+    free(rgb);
+    return bad ? 1 : 0;
+}
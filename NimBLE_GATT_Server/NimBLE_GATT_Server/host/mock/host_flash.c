@@ -0,0 +1,208 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+/* Includes */
+#include "esp_log.h"
+#include "esp_ota_ops.h"
+#include "esp_partition.h"
+#include "host_sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * File backed flash
+ *      The partition table of partitions.csv, each partition stored as
+ *      <label>.bin under HOST_FLASH_DIR. Bytes past the end of a file
+ *      read back as erased flash (0xFF). esp_ota_begin truncates the
+ *      target file in place of erasing it; esp_ota_end rejects images
+ *      that do not start with the 0xE9 magic like the real validation.
+ */
+
+/* Defines */
+#define HOST_OTA_HANDLES 4
+#define HOST_MAPS 4
+#define HOST_IMAGE_MAGIC 0xE9
+
+typedef struct {
+    const esp_partition_t *part;
+    FILE *file;
+    uint32_t written;
+    uint8_t first;
+} host_ota_t;
+
+/* Private variables */
+static const esp_partition_t partitions[] = {
+    {ESP_PARTITION_TYPE_DATA, 0x02, 0x9000, 0x6000, "nvs", false},
+    {ESP_PARTITION_TYPE_DATA, 0x01, 0xf000, 0x1000, "phy_init", false},
+    {ESP_PARTITION_TYPE_APP, 0x00, 0x10000, 0x100000, "factory", false},
+    {ESP_PARTITION_TYPE_APP, 0x10, 0x110000, 0x100000, "ota_0", false},
+    {ESP_PARTITION_TYPE_APP, 0x11, 0x210000, 0x100000, "ota_1", false},
+    {ESP_PARTITION_TYPE_DATA, 0x00, 0x310000, 0x2000, "otadata", false},
+    {ESP_PARTITION_TYPE_DATA, 0x82, 0x312000, 0x50000, "spiffs", false},
+    {ESP_PARTITION_TYPE_DATA, 0x40, 0x362000, 0x9E000, "rawlog", false},
+};
+
+static const esp_partition_t *boot_part = &partitions[2];
+static host_ota_t ota[HOST_OTA_HANDLES];
+static uint8_t *maps[HOST_MAPS];
+
+/* Public functions */
+void host_partition_path(const esp_partition_t *part, char *path,
+                         size_t size) {
+    snprintf(path, size, HOST_FLASH_DIR "/%s.bin", part->label);
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type,
+                                                esp_partition_subtype_t subtype,
+                                                const char *label) {
+    for (size_t i = 0; i < sizeof(partitions) / sizeof(partitions[0]); i++) {
+        const esp_partition_t *p = &partitions[i];
+
+        if ((type == ESP_PARTITION_TYPE_ANY || p->type == type) &&
+            (subtype == ESP_PARTITION_SUBTYPE_ANY || p->subtype == subtype) &&
+            (!label || strcmp(p->label, label) == 0)) {
+            return p;
+        }
+    }
+    return NULL;
+}
+
+esp_err_t esp_partition_mmap(const esp_partition_t *partition, size_t offset,
+                             size_t size, esp_partition_mmap_memory_t memory,
+                             const void **out_ptr,
+                             esp_partition_mmap_handle_t *out_handle) {
+    char path[256];
+    uint8_t *buf;
+    FILE *f;
+    size_t i;
+
+    (void)memory;
+    if (offset + size > partition->size) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (i = 0; i < HOST_MAPS && maps[i]; i++) {
+    }
+    if (i == HOST_MAPS) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    buf = malloc(size);
+    if (!buf) {
+        return ESP_ERR_NO_MEM;
+    }
+    memset(buf, 0xff, size);
+
+    host_partition_path(partition, path, sizeof(path));
+    f = fopen(path, "rb");
+    if (f) {
+        if (fseek(f, offset, SEEK_SET) == 0) {
+            fread(buf, 1, size, f);
+        }
+        fclose(f);
+    }
+
+    maps[i] = buf;
+    *out_ptr = buf;
+    *out_handle = i;
+    return ESP_OK;
+}
+
+void esp_partition_munmap(esp_partition_mmap_handle_t handle) {
+    if (handle < HOST_MAPS) {
+        free(maps[handle]);
+        maps[handle] = NULL;
+    }
+}
+
+const esp_partition_t *
+esp_ota_get_next_update_partition(const esp_partition_t *start_from) {
+    (void)start_from;
+    return esp_partition_find_first(
+        ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_ANY,
+        strcmp(boot_part->label, "ota_0") == 0 ? "ota_1" : "ota_0");
+}
+
+esp_err_t esp_ota_begin(const esp_partition_t *partition, size_t image_size,
+                        esp_ota_handle_t *out_handle) {
+    char path[256];
+    size_t i;
+
+    if (!partition || partition->type != ESP_PARTITION_TYPE_APP ||
+        partition == boot_part) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (image_size != OTA_SIZE_UNKNOWN && image_size > partition->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    for (i = 0; i < HOST_OTA_HANDLES && ota[i].part; i++) {
+    }
+    if (i == HOST_OTA_HANDLES) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    host_sim_flash_erase();
+    host_partition_path(partition, path, sizeof(path));
+    ota[i].file = fopen(path, "wb");
+    if (!ota[i].file) {
+        ESP_LOGE("host", "cannot create %s", path);
+        return ESP_FAIL;
+    }
+    ota[i].part = partition;
+    ota[i].written = 0;
+    *out_handle = i + 1;
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_write(esp_ota_handle_t handle, const void *data,
+                        size_t size) {
+    host_ota_t *h;
+
+    if (handle == 0 || handle > HOST_OTA_HANDLES || !ota[handle - 1].part) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    h = &ota[handle - 1];
+    if (h->written + size > h->part->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (h->written == 0 && size > 0) {
+        h->first = *(const uint8_t *)data;
+        if (h->first != HOST_IMAGE_MAGIC) {
+            return ESP_ERR_OTA_VALIDATE_FAILED;
+        }
+    }
+    host_sim_flash_write(size);
+    if (fwrite(data, 1, size, h->file) != size) {
+        return ESP_FAIL;
+    }
+    h->written += size;
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_end(esp_ota_handle_t handle) {
+    host_ota_t *h;
+    esp_err_t err = ESP_OK;
+
+    if (handle == 0 || handle > HOST_OTA_HANDLES || !ota[handle - 1].part) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    h = &ota[handle - 1];
+    if (h->written == 0 || h->first != HOST_IMAGE_MAGIC) {
+        err = ESP_ERR_OTA_VALIDATE_FAILED;
+    }
+    fclose(h->file);
+    memset(h, 0, sizeof(*h));
+    return err;
+}
+
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t *partition) {
+    if (!partition || partition->type != ESP_PARTITION_TYPE_APP) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    boot_part = partition;
+    return ESP_OK;
+}
+
+const esp_partition_t *esp_ota_get_boot_partition(void) { return boot_part; }
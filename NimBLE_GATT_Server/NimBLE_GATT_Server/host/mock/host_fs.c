@@ -0,0 +1,55 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+/* Includes */
+#include "fs_maint.h"
+#include "fs_mount.h"
+#include "host_fs.h"
+#include "storage.h"
+#include "storage_bench.h"
+#include <string.h>
+
+/*
+ * Host file system glue
+ *      FS_BASE_PATH is a plain directory standing in for the mounted
+ *      SPIFFS partition, so the SPIFFS backend of storage_fs.c runs on
+ *      stdio as is. There is no GC to run; write timings are still
+ *      collected so telemetry reports stalls of the host file system.
+ */
+
+/* Public variables */
+const storage_backend_t *host_storage = &storage_spiffs_backend;
+
+/* Private variables */
+static fs_maint_stats_t maint;
+
+/* Public functions */
+fs_type_t fs_mount_type(void) { return FS_TYPE_SPIFFS; }
+
+const char *fs_type_name(fs_type_t type) {
+    return type == FS_TYPE_SPIFFS ? "spiffs" : "none";
+}
+
+uint32_t fs_mount_time_us(void) { return 0; }
+
+void fs_maint_activity(void) {}
+
+void fs_maint_session(bool active) { (void)active; }
+
+void fs_maint_note_write(uint32_t us) {
+    if (us > maint.write_max_us) {
+        maint.write_max_us = us;
+    }
+    if (us > FS_MAINT_STALL_US) {
+        maint.write_stalls++;
+    }
+}
+
+void fs_maint_get_stats(fs_maint_stats_t *stats) { *stats = maint; }
+
+/* The storage bench never runs on the host */
+bool storage_bench_running(void) { return false; }
+
+const storage_backend_t *storage_get(void) { return host_storage; }
@@ -0,0 +1,173 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+/* Includes */
+#include "host/ble_hs.h"
+#include "sdkconfig.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Host mbuf pool
+ *      Every block holds CONFIG_BT_NIMBLE_MSYS_1_BLOCK_SIZE bytes, appends
+ *      spill into new blocks chained behind the packet, the same way the
+ *      msys pool grows a response on the target. Allocations are counted
+ *      and can be capped to provoke BLE_ATT_ERR_INSUFFICIENT_RES.
+ */
+
+/* Defines */
+#define HOST_MBUF_BLOCK CONFIG_BT_NIMBLE_MSYS_1_BLOCK_SIZE
+
+/* Private variables */
+static host_mbuf_stats_t stats;
+static uint32_t limit = 0; /* 0 = unlimited */
+
+/* Private functions */
+static struct os_mbuf *mbuf_get(void) {
+    struct os_mbuf *om;
+
+    if (limit && stats.live >= limit) {
+        stats.failed++;
+        return NULL;
+    }
+
+    om = malloc(sizeof(*om) + HOST_MBUF_BLOCK);
+    if (!om) {
+        stats.failed++;
+        return NULL;
+    }
+    om->om_data = (uint8_t *)(om + 1);
+    om->om_len = 0;
+    om->om_size = HOST_MBUF_BLOCK;
+    om->om_next = NULL;
+
+    stats.allocs++;
+    stats.live++;
+    if (stats.live > stats.peak) {
+        stats.peak = stats.live;
+    }
+    return om;
+}
+
+/* Public functions */
+struct os_mbuf *os_msys_get_pkthdr(uint16_t dsize, uint16_t user_hdr_len) {
+    (void)dsize;
+    (void)user_hdr_len;
+    return mbuf_get();
+}
+
+int os_mbuf_free_chain(struct os_mbuf *om) {
+    while (om) {
+        struct os_mbuf *next = om->om_next;
+        free(om);
+        stats.frees++;
+        stats.live--;
+        om = next;
+    }
+    return 0;
+}
+
+int os_mbuf_append(struct os_mbuf *om, const void *data, uint16_t len) {
+    const uint8_t *src = data;
+
+    if (!om) {
+        return -1;
+    }
+    while (om->om_next) {
+        om = om->om_next;
+    }
+
+    while (len > 0) {
+        uint16_t n = om->om_size - om->om_len;
+
+        if (n == 0) {
+            om->om_next = mbuf_get();
+            if (!om->om_next) {
+                return -1;
+            }
+            om = om->om_next;
+            continue;
+        }
+        if (n > len) {
+            n = len;
+        }
+        memcpy(om->om_data + om->om_len, src, n);
+        om->om_len += n;
+        src += n;
+        len -= n;
+    }
+    return 0;
+}
+
+uint16_t os_mbuf_pktlen(const struct os_mbuf *om) {
+    uint16_t len = 0;
+
+    for (; om; om = om->om_next) {
+        len += om->om_len;
+    }
+    return len;
+}
+
+int ble_hs_mbuf_to_flat(const struct os_mbuf *om, void *flat, uint16_t max_len,
+                        uint16_t *out_copy_len) {
+    uint8_t *dst = flat;
+    uint16_t total = os_mbuf_pktlen(om);
+    uint16_t copied = 0;
+
+    for (; om && copied < max_len; om = om->om_next) {
+        uint16_t n = om->om_len;
+
+        if (n > max_len - copied) {
+            n = max_len - copied;
+        }
+        memcpy(dst + copied, om->om_data, n);
+        copied += n;
+    }
+    if (out_copy_len) {
+        *out_copy_len = copied;
+    }
+    return total > max_len ? BLE_HS_EMSGSIZE : 0;
+}
+
+struct os_mbuf *ble_hs_mbuf_from_flat(const void *buf, uint16_t len) {
+    struct os_mbuf *om = mbuf_get();
+
+    if (om && os_mbuf_append(om, buf, len) != 0) {
+        os_mbuf_free_chain(om);
+        return NULL;
+    }
+    return om;
+}
+
+/* Packet of len bytes split over blocks holding at most seg bytes each */
+struct os_mbuf *host_mbuf_chain(const void *data, uint16_t len, uint16_t seg) {
+    const uint8_t *src = data;
+    struct os_mbuf *head = NULL;
+    struct os_mbuf **tail = &head;
+
+    if (seg == 0 || seg > HOST_MBUF_BLOCK) {
+        seg = HOST_MBUF_BLOCK;
+    }
+    do {
+        uint16_t n = len < seg ? len : seg;
+        struct os_mbuf *om = mbuf_get();
+
+        if (!om) {
+            os_mbuf_free_chain(head);
+            return NULL;
+        }
+        memcpy(om->om_data, src, n);
+        om->om_len = n;
+        *tail = om;
+        tail = &om->om_next;
+        src += n;
+        len -= n;
+    } while (len > 0);
+    return head;
+}
+
+void host_mbuf_set_limit(uint32_t blocks) { limit = blocks; }
+
+void host_mbuf_get_stats(host_mbuf_stats_t *out) { *out = stats; }
@@ -0,0 +1,180 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+/* Includes */
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * Threaded tasks and queues
+ *      Every task gets a detached pthread and queues are ring buffers
+ *      behind one mutex and condition variable, so main/src/upload_writer.c
+ *      runs unchanged with its writer task draining the queue while the
+ *      caller keeps submitting. Timeouts are converted from ticks at
+ *      CONFIG_FREERTOS_HZ; portMAX_DELAY waits forever.
+ */
+
+/* Private types */
+struct host_queue {
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t head;
+    UBaseType_t count;
+    uint8_t items[];
+};
+
+typedef struct {
+    TaskFunction_t fn;
+    void *arg;
+} host_task_t;
+
+/* Private functions */
+static void deadline_after(struct timespec *ts, TickType_t ticks) {
+    uint64_t ns = (uint64_t)ticks * portTICK_PERIOD_MS * 1000000;
+
+    clock_gettime(CLOCK_MONOTONIC, ts);
+    ns += ts->tv_nsec;
+    ts->tv_sec += ns / 1000000000;
+    ts->tv_nsec = ns % 1000000000;
+}
+
+static bool queue_ready(const struct host_queue *q, bool space) {
+    return space ? q->count < q->length : q->count > 0;
+}
+
+/* Wait for a free item (space) or a queued one, with the lock held */
+static bool queue_wait(struct host_queue *q, bool space, TickType_t ticks) {
+    struct timespec ts;
+
+    if (ticks != portMAX_DELAY) {
+        deadline_after(&ts, ticks);
+    }
+    while (!queue_ready(q, space)) {
+        if (ticks == portMAX_DELAY) {
+            pthread_cond_wait(&q->changed, &q->lock);
+        } else if (pthread_cond_timedwait(&q->changed, &q->lock, &ts) ==
+                   ETIMEDOUT) {
+            return queue_ready(q, space);
+        }
+    }
+    return true;
+}
+
+static void *task_entry(void *param) {
+    host_task_t task = *(host_task_t *)param;
+
+    free(param);
+    task.fn(task.arg);
+    return NULL;
+}
+
+/* Public functions */
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+    struct host_queue *q = calloc(1, sizeof(*q) + length * item_size);
+    pthread_condattr_t attr;
+
+    if (!q) {
+        return NULL;
+    }
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->changed, &attr);
+    pthread_condattr_destroy(&attr);
+    q->length = length;
+    q->item_size = item_size;
+    return q;
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t ticks) {
+    BaseType_t ret = pdFALSE;
+
+    pthread_mutex_lock(&q->lock);
+    if (queue_wait(q, true, ticks)) {
+        UBaseType_t tail = (q->head + q->count) % q->length;
+
+        if (q->item_size) {
+            memcpy(q->items + tail * q->item_size, item, q->item_size);
+        }
+        q->count++;
+        pthread_cond_broadcast(&q->changed);
+        ret = pdTRUE;
+    }
+    pthread_mutex_unlock(&q->lock);
+    return ret;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t ticks) {
+    BaseType_t ret = pdFALSE;
+
+    pthread_mutex_lock(&q->lock);
+    if (queue_wait(q, false, ticks)) {
+        if (q->item_size) {
+            memcpy(item, q->items + q->head * q->item_size, q->item_size);
+        }
+        q->head = (q->head + 1) % q->length;
+        q->count--;
+        pthread_cond_broadcast(&q->changed);
+        ret = pdTRUE;
+    }
+    pthread_mutex_unlock(&q->lock);
+    return ret;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q) {
+    UBaseType_t count;
+
+    pthread_mutex_lock(&q->lock);
+    count = q->count;
+    pthread_mutex_unlock(&q->lock);
+    return count;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack,
+                       void *arg, UBaseType_t prio, TaskHandle_t *handle) {
+    host_task_t *task = malloc(sizeof(*task));
+    pthread_t thread;
+
+    (void)name;
+    (void)stack;
+    (void)prio;
+    if (!task) {
+        return pdFAIL;
+    }
+    task->fn = fn;
+    task->arg = arg;
+    if (pthread_create(&thread, NULL, task_entry, task) != 0) {
+        free(task);
+        return pdFAIL;
+    }
+    pthread_detach(thread);
+    if (handle) {
+        *handle = NULL;
+    }
+    return pdPASS;
+}
+
+/* Only ever called by a task on itself */
+void vTaskDelete(TaskHandle_t handle) {
+    (void)handle;
+    pthread_exit(NULL);
+}
+
+void vTaskDelay(TickType_t ticks) {
+    struct timespec ts = {
+        .tv_sec = ticks * portTICK_PERIOD_MS / 1000,
+        .tv_nsec = ticks * portTICK_PERIOD_MS % 1000 * 1000000,
+    };
+
+    nanosleep(&ts, NULL);
+}
@@ -0,0 +1,42 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+/* Includes */
+#include "host_sim.h"
+#include <time.h>
+
+/*
+ * Flash timing simulation
+ *      Delays spin instead of sleeping: a flash write stalls the CPU
+ *      that issued it on the target, and sleeping would let the host
+ *      scheduler round short delays up to its tick.
+ */
+
+/* Public variables */
+host_sim_t host_sim;
+
+/* Public functions */
+void host_sim_busy_wait(uint64_t us) {
+    struct timespec start, now;
+
+    if (us == 0) {
+        return;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    do {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+    } while ((uint64_t)(now.tv_sec - start.tv_sec) * 1000000 +
+                 (now.tv_nsec - start.tv_nsec) / 1000 <
+             us);
+}
+
+void host_sim_flash_write(size_t len) {
+    host_sim_busy_wait(host_sim.write_us +
+                       (uint64_t)host_sim.write_us_per_kb * len / 1024);
+}
+
+void host_sim_flash_erase(void) {
+    host_sim_busy_wait((uint64_t)host_sim.erase_ms * 1000);
+}
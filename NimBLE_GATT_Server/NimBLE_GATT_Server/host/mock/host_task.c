@@ -0,0 +1,31 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+/* Includes */
+#include "freertos/task.h"
+
+/*
+ * Run-to-completion tasks
+ *      Tasks run inside xTaskCreate, which is all the one-shot tasks used
+ *      by the transfer path (trace print) need when the upload writer is
+ *      the synchronous one from host_writer.c.
+ */
+
+/* Public functions */
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack,
+                       void *arg, UBaseType_t prio, TaskHandle_t *handle) {
+    (void)name;
+    (void)stack;
+    (void)prio;
+    if (handle) {
+        *handle = NULL;
+    }
+    fn(arg);
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t handle) { (void)handle; }
+
+void vTaskDelay(TickType_t ticks) { (void)ticks; }
@@ -0,0 +1,62 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+/* Includes */
+#include "upload_writer.h"
+#include "host_sim.h"
+#include "telemetry.h"
+
+/*
+ * Synchronous upload writer
+ *      Same interface as the writer task, but every chunk goes straight
+ *      to the backend inside upload_writer_submit, simulated flash time
+ *      included. Write errors surface on the chunk that caused them
+ *      rather than a later one.
+ */
+
+/* Private variables */
+static const storage_backend_t *active = NULL;
+static uint32_t next_seq = 0;
+
+/* Public functions */
+esp_err_t upload_writer_init(void) { return ESP_OK; }
+
+esp_err_t upload_writer_begin(const storage_backend_t *backend) {
+    active = backend;
+    next_seq = 0;
+    return ESP_OK;
+}
+
+esp_err_t upload_writer_submit(const uint8_t *data, size_t len, uint32_t rx,
+                               uint32_t *seq) {
+    (void)rx;
+    if (!active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    *seq = next_seq++;
+    telemetry_queue_depth(0);
+    host_sim_flash_write(len);
+    return active->write(data, len);
+}
+
+void upload_writer_ack(uint32_t seq) { (void)seq; }
+
+esp_err_t upload_writer_sync(void) { return ESP_OK; }
+
+esp_err_t upload_writer_end(void) {
+    const storage_backend_t *backend = active;
+
+    active = NULL;
+    return backend ? backend->write_end() : ESP_OK;
+}
+
+const storage_backend_t *upload_writer_backend(void) { return active; }
+
+size_t upload_writer_csv(char *buf, size_t size) {
+    if (size) {
+        buf[0] = '\0';
+    }
+    return 0;
+}
@@ -0,0 +1,13 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+#ifndef ESP_ATTR_H
+#define ESP_ATTR_H
+
+/* Host build: there is only one kind of memory */
+#define DRAM_ATTR
+#define IRAM_ATTR
+
+#endif // ESP_ATTR_H
@@ -0,0 +1,14 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+#ifndef ESP_SYSTEM_H
+#define ESP_SYSTEM_H
+
+/* Host build: counted instead of rebooting, see host_restart_count */
+extern int host_restart_count;
+
+void esp_restart(void);
+
+#endif // ESP_SYSTEM_H
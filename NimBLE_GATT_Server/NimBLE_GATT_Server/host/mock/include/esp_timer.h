@@ -0,0 +1,14 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+#ifndef ESP_TIMER_H
+#define ESP_TIMER_H
+
+#include <stdint.h>
+
+/* Host build: CLOCK_MONOTONIC since the first call, timers are not mocked */
+int64_t esp_timer_get_time(void);
+
+#endif // ESP_TIMER_H
@@ -0,0 +1,18 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+#ifndef SEMPHR_H
+#define SEMPHR_H
+
+#include "freertos/queue.h"
+
+/* Host build: a binary semaphore is a queue of one empty item, as on the target */
+typedef QueueHandle_t SemaphoreHandle_t;
+
+#define xSemaphoreCreateBinary() xQueueCreate(1, 0)
+#define xSemaphoreGive(sem) xQueueSend((sem), NULL, 0)
+#define xSemaphoreTake(sem, ticks) xQueueReceive((sem), NULL, (ticks))
+
+#endif // SEMPHR_H
@@ -0,0 +1,29 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+#ifndef BLE_HS_H
+#define BLE_HS_H
+
+#include <stdint.h>
+
+#include "os/os_mbuf.h"
+
+#define BLE_ATT_MTU_DFLT 23
+#define BLE_ATT_MTU_MAX 527
+#define BLE_ATT_ATTR_MAX_LEN 512
+#define BLE_HS_CONN_HANDLE_NONE 0xffff
+#define BLE_HS_EMSGSIZE 4
+
+#define BLE_ATT_ERR_INVALID_OFFSET 0x07
+#define BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN 0x0d
+#define BLE_ATT_ERR_UNLIKELY 0x0e
+#define BLE_ATT_ERR_INSUFFICIENT_RES 0x11
+#define BLE_ATT_ERR_VALUE_NOT_ALLOWED 0x13
+
+int ble_hs_mbuf_to_flat(const struct os_mbuf *om, void *flat, uint16_t max_len,
+                        uint16_t *out_copy_len);
+struct os_mbuf *ble_hs_mbuf_from_flat(const void *buf, uint16_t len);
+
+#endif // BLE_HS_H
@@ -0,0 +1,14 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+#ifndef HOST_COMPAT_H
+#define HOST_COMPAT_H
+
+#include <stddef.h>
+
+/* Force-included: newlib extras glibc does not have */
+size_t strlcpy(char *dst, const char *src, size_t size);
+
+#endif // HOST_COMPAT_H
@@ -0,0 +1,14 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+#ifndef HOST_FS_H
+#define HOST_FS_H
+
+#include "storage.h"
+
+/* Backend returned by storage_get(), the SPIFFS one unless a test swaps it */
+extern const storage_backend_t *host_storage;
+
+#endif // HOST_FS_H
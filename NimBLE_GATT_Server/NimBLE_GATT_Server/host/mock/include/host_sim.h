@@ -0,0 +1,31 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+#ifndef HOST_SIM_H
+#define HOST_SIM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Simulated flash timing
+ *      The host file system and fake partitions are far faster than SPI
+ *      flash. These delays are added by the mocks so benchmarks can model
+ *      a given part: write_us per write call plus write_us_per_kb for
+ *      every KiB written, erase_ms once per esp_ota_begin.
+ */
+typedef struct {
+    uint32_t write_us;
+    uint32_t write_us_per_kb;
+    uint32_t erase_ms;
+} host_sim_t;
+
+extern host_sim_t host_sim;
+
+void host_sim_busy_wait(uint64_t us);
+void host_sim_flash_write(size_t len);
+void host_sim_flash_erase(void);
+
+#endif // HOST_SIM_H
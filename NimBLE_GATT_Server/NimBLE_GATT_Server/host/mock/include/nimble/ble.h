@@ -0,0 +1,11 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+#ifndef HOST_BLE_H
+#define HOST_BLE_H
+
+/* Host build: nothing the transfer logic uses */
+
+#endif // HOST_BLE_H
@@ -0,0 +1,11 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+#ifndef NVS_FLASH_H
+#define NVS_FLASH_H
+
+/* Host build: nothing the transfer logic uses */
+
+#endif // NVS_FLASH_H
@@ -0,0 +1,42 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+#ifndef OS_MBUF_H
+#define OS_MBUF_H
+
+#include <stdint.h>
+
+/*
+ * Host build mbufs
+ *      Chains of fixed size blocks like the msys pool, so the number of
+ *      blocks a transfer touches can be counted on the host.
+ */
+struct os_mbuf {
+    uint8_t *om_data;
+    uint16_t om_len;
+    uint16_t om_size;
+    struct os_mbuf *om_next;
+};
+
+typedef struct {
+    uint32_t allocs;
+    uint32_t frees;
+    uint32_t live;
+    uint32_t peak;
+    uint32_t failed;
+} host_mbuf_stats_t;
+
+struct os_mbuf *os_msys_get_pkthdr(uint16_t dsize, uint16_t user_hdr_len);
+int os_mbuf_free_chain(struct os_mbuf *om);
+int os_mbuf_append(struct os_mbuf *om, const void *data, uint16_t len);
+uint16_t os_mbuf_pktlen(const struct os_mbuf *om);
+
+struct os_mbuf *host_mbuf_chain(const void *data, uint16_t len, uint16_t seg);
+void host_mbuf_set_limit(uint32_t blocks);
+void host_mbuf_get_stats(host_mbuf_stats_t *stats);
+
+#define OS_MBUF_PKTLEN(om) os_mbuf_pktlen(om)
+
+#endif // OS_MBUF_H
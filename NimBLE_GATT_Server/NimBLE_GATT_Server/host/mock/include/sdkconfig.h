@@ -0,0 +1,22 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+#ifndef SDKCONFIG_H
+#define SDKCONFIG_H
+
+/* Host build: the subset of the project configuration the sources read */
+#define CONFIG_FILE_STORAGE_BACKEND_FS 1
+#define CONFIG_FILE_STORAGE_RAWLOG_LABEL "rawlog"
+#define CONFIG_FILE_FS_SPIFFS 1
+#define CONFIG_FILE_FS_GC_RESERVE_KB 64
+#define CONFIG_FILE_FS_GC_SLICE_KB 8
+#define CONFIG_FILE_FS_GC_IDLE_MS 2000
+#define CONFIG_FILE_TRACE_ENTRIES 256
+#define CONFIG_FILE_LATENCY_CHUNKS 64
+#define CONFIG_FILE_STATS_PERIOD_MS 1000
+#define CONFIG_BT_NIMBLE_MSYS_1_BLOCK_SIZE 256
+#define CONFIG_FREERTOS_HZ 1000
+
+#endif // SDKCONFIG_H
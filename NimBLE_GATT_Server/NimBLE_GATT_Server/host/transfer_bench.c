@@ -0,0 +1,368 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+/* Includes */
+#include "common.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "host_sim.h"
+#include "transfer.h"
+#include <inttypes.h>
+#include <malloc.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * Transfer path benchmark
+ *      Calls transfer_write / transfer_read - the bodies of the file_rw
+ *      access callback - with synthetic mbuf chains, no radio involved.
+ *      Flash timing comes from host_sim so a given part can be modelled.
+ *      Each scenario reports callbacks per second, bytes per second,
+ *      p50/p99/max callback latency and peak heap; -j prints the same as
+ *      one JSON object for comparing runs between commits.
+ */
+
+/* Defines */
+#define BENCH_OTA_MAGIC 0xE9
+#define BENCH_OTA_MAX (0x100000 - 16) /* ota_x partition size, with margin */
+
+typedef enum {
+    BENCH_UPLOAD,
+    BENCH_OTA,
+    BENCH_READ,
+    BENCH_COUNT,
+} bench_id_t;
+
+typedef struct {
+    uint64_t callbacks;
+    uint64_t bytes;
+    uint64_t ns;
+    uint64_t *lat_ns;
+    size_t lat_len;
+    size_t lat_cap;
+    size_t heap_peak;
+    uint32_t mbuf_peak;
+    bool failed;
+} bench_result_t;
+
+/* Private variables */
+static const char *bench_names[BENCH_COUNT] = {"upload", "ota", "read"};
+
+static uint16_t mtu = 517;
+static uint16_t seg = CONFIG_BT_NIMBLE_MSYS_1_BLOCK_SIZE;
+static size_t total = 256 * 1024;
+static unsigned runs = 3;
+static bool json = false;
+
+static size_t heap_base;
+static uint8_t *payload;
+
+/* Private functions */
+static uint64_t now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static size_t heap_used(void) {
+    struct mallinfo2 mi = mallinfo2();
+    return mi.uordblks;
+}
+
+static void fill_payload(uint8_t *buf, size_t len, uint32_t seed) {
+    uint32_t x = seed ? seed : 1;
+
+    for (size_t i = 0; i < len; i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        buf[i] = x;
+    }
+}
+
+static void record(bench_result_t *res, uint64_t ns, size_t bytes) {
+    size_t heap = heap_used();
+
+    if (res->lat_len < res->lat_cap) {
+        res->lat_ns[res->lat_len++] = ns;
+    }
+    res->callbacks++;
+    res->bytes += bytes;
+    res->ns += ns;
+    if (heap > heap_base && heap - heap_base > res->heap_peak) {
+        res->heap_peak = heap - heap_base;
+    }
+}
+
+static int write_timed(bench_result_t *res, const uint8_t *data,
+                       uint16_t len) {
+    struct os_mbuf *om = host_mbuf_chain(data, len, seg);
+    uint64_t start;
+    int rc;
+
+    if (!om) {
+        return BLE_ATT_ERR_INSUFFICIENT_RES;
+    }
+    start = now_ns();
+    rc = transfer_write(om, (uint32_t)esp_timer_get_time());
+    if (res) {
+        record(res, now_ns() - start, len);
+    }
+    os_mbuf_free_chain(om);
+    return rc;
+}
+
+/* One session of MTU-sized writes, res NULL to leave it untimed */
+static int upload(bench_result_t *res, const uint8_t *data, size_t len) {
+    uint16_t chunk = mtu - 3;
+
+    transfer_reset();
+    for (size_t pos = 0; pos < len; pos += chunk) {
+        uint16_t n = len - pos < chunk ? len - pos : chunk;
+        int rc = write_timed(res, data + pos, n);
+
+        if (rc != 0) {
+            fprintf(stderr, "write at %zu failed: ATT 0x%02x\n", pos, rc);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void bench_upload(bench_result_t *res) {
+    uint64_t start;
+
+    res->failed |= upload(res, payload, total) != 0;
+    /* The commit on disconnect is not a callback, but costs flash time */
+    start = now_ns();
+    transfer_finish_upload();
+    res->ns += now_ns() - start;
+}
+
+static void bench_ota(bench_result_t *res) {
+    size_t len = total < BENCH_OTA_MAX ? total : BENCH_OTA_MAX;
+    int restarts = host_restart_count;
+
+    payload[0] = BENCH_OTA_MAGIC;
+    res->failed |= upload(res, payload, len) != 0;
+    res->failed |= write_timed(res, (const uint8_t *)"OTA_END", 7) != 0;
+    res->failed |= host_restart_count != restarts + 1;
+    payload[0] = 0;
+}
+
+/* Walk the upload window by window with long reads, like the client */
+static void bench_read(bench_result_t *res) {
+    static uint8_t back[BLE_ATT_ATTR_MAX_LEN];
+    host_sim_t sim = host_sim;
+    size_t pos = 0;
+
+    /* Prepare the file with flash timing off, it is not measured here */
+    host_sim = (host_sim_t){0};
+    res->failed |= upload(NULL, payload, total) != 0;
+    transfer_finish_upload();
+    host_sim = sim;
+    transfer_reset();
+
+    while (pos < total && !res->failed) {
+        uint16_t att_offset = 0;
+        size_t got = 0;
+
+        transfer_set_offset(pos);
+        while (got < sizeof(back)) {
+            struct os_mbuf *om = os_msys_get_pkthdr(0, 0);
+            uint64_t start = now_ns();
+            int rc = transfer_read(om, att_offset, mtu);
+            uint16_t n = OS_MBUF_PKTLEN(om);
+            uint16_t copy = n < sizeof(back) - got ? n : sizeof(back) - got;
+
+            record(res, now_ns() - start, copy);
+            ble_hs_mbuf_to_flat(om, back + got, copy, NULL);
+            os_mbuf_free_chain(om);
+            if (rc != 0) {
+                fprintf(stderr, "read at %zu failed: ATT 0x%02x\n", pos, rc);
+                res->failed = true;
+                break;
+            }
+            got += copy;
+            att_offset += n;
+            if (n < mtu - 1) {
+                break;
+            }
+        }
+        if (got == 0 || memcmp(back, payload + pos, got) != 0) {
+            fprintf(stderr, "read back differs at %zu\n", pos);
+            res->failed = true;
+        }
+        pos += got;
+    }
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static double pct_us(const bench_result_t *res, unsigned pct) {
+    size_t i;
+
+    if (res->lat_len == 0) {
+        return 0;
+    }
+    i = (res->lat_len * pct + 99) / 100;
+    return res->lat_ns[i ? i - 1 : 0] / 1000.0;
+}
+
+static void report(bench_id_t id, bench_result_t *res, bool first) {
+    double s = res->ns / 1e9;
+    host_mbuf_stats_t mbufs;
+
+    qsort(res->lat_ns, res->lat_len, sizeof(uint64_t), cmp_u64);
+    host_mbuf_get_stats(&mbufs);
+
+    if (json) {
+        printf("%s\n    {\"name\": \"%s\", \"ok\": %s, \"callbacks\": %" PRIu64
+               ", \"bytes\": %" PRIu64 ", \"seconds\": %.6f"
+               ", \"callbacks_per_s\": %.1f, \"bytes_per_s\": %.1f"
+               ", \"p50_us\": %.2f, \"p99_us\": %.2f, \"max_us\": %.2f"
+               ", \"peak_heap\": %zu, \"peak_mbufs\": %" PRIu32 "}",
+               first ? "" : ",", bench_names[id],
+               res->failed ? "false" : "true", res->callbacks, res->bytes, s,
+               s > 0 ? res->callbacks / s : 0, s > 0 ? res->bytes / s : 0,
+               pct_us(res, 50), pct_us(res, 99), pct_us(res, 100),
+               res->heap_peak, mbufs.peak);
+        return;
+    }
+
+    printf("%-7s %10.0f cb/s %10.1f KiB/s  p50 %8.2f us  p99 %8.2f us  "
+           "max %9.2f us  heap %6zu  %s\n",
+           bench_names[id], s > 0 ? res->callbacks / s : 0,
+           s > 0 ? res->bytes / 1024.0 / s : 0, pct_us(res, 50),
+           pct_us(res, 99), pct_us(res, 100), res->heap_peak,
+           res->failed ? "FAILED" : "ok");
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s [-m mtu] [-s seg] [-n bytes] [-r runs] [-w us] "
+            "[-k us_per_kb] [-e erase_ms] [-j] [upload|ota|read]...\n"
+            "  -m  ATT MTU, writes are mtu - 3 bytes (default 517)\n"
+            "  -s  bytes per mbuf in each write chain (default %d)\n"
+            "  -n  bytes per session (default 262144)\n"
+            "  -r  sessions per scenario (default 3)\n"
+            "  -w  simulated flash time per write call in us\n"
+            "  -k  simulated flash time per KiB written in us\n"
+            "  -e  simulated OTA partition erase time in ms\n"
+            "  -j  print results as JSON\n",
+            prog, CONFIG_BT_NIMBLE_MSYS_1_BLOCK_SIZE);
+}
+
+/* Public functions */
+int main(int argc, char **argv) {
+    bool selected[BENCH_COUNT] = {false};
+    bool any = false, failed = false, first = true;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "m:s:n:r:w:k:e:jh")) != -1) {
+        switch (opt) {
+        case 'm':
+            mtu = atoi(optarg);
+            break;
+        case 's':
+            seg = atoi(optarg);
+            break;
+        case 'n':
+            total = strtoul(optarg, NULL, 0);
+            break;
+        case 'r':
+            runs = atoi(optarg);
+            break;
+        case 'w':
+            host_sim.write_us = atoi(optarg);
+            break;
+        case 'k':
+            host_sim.write_us_per_kb = atoi(optarg);
+            break;
+        case 'e':
+            host_sim.erase_ms = atoi(optarg);
+            break;
+        case 'j':
+            json = true;
+            break;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (mtu < BLE_ATT_MTU_DFLT || mtu > TRANSFER_CHUNK_MAX + 3 || seg == 0 ||
+        total == 0 || runs == 0) {
+        usage(argv[0]);
+        return 2;
+    }
+    for (; optind < argc; optind++) {
+        for (int i = 0; i < BENCH_COUNT; i++) {
+            if (strcmp(argv[optind], bench_names[i]) == 0) {
+                selected[i] = any = true;
+            }
+        }
+    }
+
+    host_log_level = ESP_LOG_ERROR;
+    payload = malloc(total);
+    fill_payload(payload, total, 0x5eed);
+    payload[0] = 0;
+
+    /* Warm up: first-use allocations are not part of the steady state */
+    upload(NULL, payload, mtu);
+    transfer_finish_upload();
+
+    if (json) {
+        printf("{\"bench\": \"transfer\", \"mtu\": %u, \"seg\": %u"
+               ", \"bytes\": %zu, \"runs\": %u, \"write_us\": %" PRIu32
+               ", \"write_us_per_kb\": %" PRIu32 ", \"erase_ms\": %" PRIu32
+               ", \"results\": [",
+               mtu, seg, total, runs, host_sim.write_us,
+               host_sim.write_us_per_kb, host_sim.erase_ms);
+    }
+
+    for (int i = 0; i < BENCH_COUNT; i++) {
+        bench_result_t res = {0};
+
+        if (any && !selected[i]) {
+            continue;
+        }
+
+        /* Sized up front so the samples stay out of the heap figures */
+        res.lat_cap = runs * (total / (mtu - 3) + total / BLE_ATT_ATTR_MAX_LEN +
+                              8);
+        res.lat_ns = malloc(res.lat_cap * sizeof(uint64_t));
+        heap_base = heap_used();
+        for (unsigned r = 0; r < runs; r++) {
+            switch (i) {
+            case BENCH_UPLOAD:
+                bench_upload(&res);
+                break;
+            case BENCH_OTA:
+                bench_ota(&res);
+                break;
+            case BENCH_READ:
+                bench_read(&res);
+                break;
+            }
+        }
+        report(i, &res, first);
+        failed |= res.failed;
+        first = false;
+        free(res.lat_ns);
+    }
+
+    if (json) {
+        printf("\n]}\n");
+    }
+    transfer_reset();
+    free(payload);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,223 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+/* Includes */
+#include "common.h"
+#include "esp_ota_ops.h"
+#include "esp_rom_crc.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "storage.h"
+#include "telemetry.h"
+#include "transfer.h"
+#include <inttypes.h>
+#include <stdlib.h>
+
+/*
+ * Host transfer replay
+ *      Plays one session against the transfer logic the way the Python
+ *      client drives the file_rw / file_offset characteristics: upload
+ *      in MTU-sized writes, then read back window by window with long
+ *      reads. OTA images (0xE9 magic) are finished with OTA_END and read
+ *      back from the target partition instead. Prints throughput and
+ *      mbuf usage; exits non-zero if the data read back or the length
+ *      and CRC reported by END differ.
+ */
+
+/* Private functions */
+static uint8_t *load_file(const char *path, size_t *len) {
+    FILE *f = fopen(path, "rb");
+    uint8_t *buf;
+    long size;
+
+    if (!f) {
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    buf = malloc(size ? size : 1);
+    if (buf && fread(buf, 1, size, f) != (size_t)size) {
+        free(buf);
+        buf = NULL;
+    }
+    fclose(f);
+    *len = size;
+    return buf;
+}
+
+static int write_chunk(const uint8_t *data, size_t len) {
+    struct os_mbuf *om = ble_hs_mbuf_from_flat(data, len);
+    int rc;
+
+    if (!om) {
+        return BLE_ATT_ERR_INSUFFICIENT_RES;
+    }
+    rc = transfer_write(om, (uint32_t)esp_timer_get_time());
+    os_mbuf_free_chain(om);
+    return rc;
+}
+
+static int upload(const uint8_t *data, size_t len, uint16_t mtu) {
+    size_t chunk = mtu - 3;
+
+    for (size_t pos = 0; pos < len; pos += chunk) {
+        size_t n = len - pos < chunk ? len - pos : chunk;
+        int rc = write_chunk(data + pos, n);
+
+        if (rc != 0) {
+            fprintf(stderr, "write at %zu failed: ATT 0x%02x\n", pos, rc);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* One long read: Read, then Read Blob until a short response or the
+ * 512 byte attribute limit, where the client moves the offset instead */
+static int long_read(uint8_t *out, size_t max, uint16_t mtu, size_t *got) {
+    uint16_t att_offset = 0;
+
+    *got = 0;
+    for (;;) {
+        struct os_mbuf *om = os_msys_get_pkthdr(0, 0);
+        uint16_t n;
+        int rc;
+
+        if (!om) {
+            return BLE_ATT_ERR_INSUFFICIENT_RES;
+        }
+        rc = transfer_read(om, att_offset, mtu);
+        n = OS_MBUF_PKTLEN(om);
+        if (rc == 0) {
+            uint16_t copy = n < max - *got ? n : max - *got;
+            ble_hs_mbuf_to_flat(om, out + *got, copy, NULL);
+            *got += copy;
+        }
+        os_mbuf_free_chain(om);
+        if (rc != 0) {
+            return rc;
+        }
+        if (n < mtu - 1 || *got >= max) {
+            return 0;
+        }
+        att_offset += n;
+    }
+}
+
+static int download(uint8_t *out, size_t len, uint16_t mtu) {
+    size_t pos = 0;
+
+    while (pos < len) {
+        size_t want = len - pos < BLE_ATT_ATTR_MAX_LEN ? len - pos
+                                                       : BLE_ATT_ATTR_MAX_LEN;
+        size_t got;
+        int rc;
+
+        transfer_set_offset(pos);
+        rc = long_read(out + pos, want, mtu, &got);
+        if (rc != 0) {
+            fprintf(stderr, "read at %zu failed: ATT 0x%02x\n", pos, rc);
+            return -1;
+        }
+        if (got == 0) {
+            break;
+        }
+        pos += got;
+    }
+    return pos == len ? 0 : -1;
+}
+
+static double kbps(size_t len, int64_t us) {
+    return us > 0 ? (len / 1024.0) / (us / 1e6) : 0;
+}
+
+/* Public functions */
+int main(int argc, char **argv) {
+    const uint16_t mtu = argc > 2 ? atoi(argv[2]) : BLE_ATT_MTU_MAX - 10;
+    bool ota_image;
+    host_mbuf_stats_t mbufs;
+    telemetry_t tm;
+    uint8_t *data, *back;
+    uint32_t src_size, src_crc = 0;
+    size_t len;
+    int64_t t0, t1, t2;
+    int ret = 0;
+
+    if (argc < 2 || mtu < BLE_ATT_MTU_DFLT || mtu > BLE_ATT_MTU_MAX - 10) {
+        fprintf(stderr, "usage: %s <file> [mtu 23..517]\n", argv[0]);
+        return 2;
+    }
+    if (getenv("HOST_LOG_LEVEL")) {
+        host_log_level = atoi(getenv("HOST_LOG_LEVEL"));
+    }
+
+    data = load_file(argv[1], &len);
+    if (!data || len == 0) {
+        fprintf(stderr, "cannot read %s\n", argv[1]);
+        return 2;
+    }
+    back = malloc(len);
+    ota_image = data[0] == 0xE9;
+
+    /* Connect */
+    telemetry_session_begin();
+    telemetry_link(mtu, 6, 2, 2);
+    transfer_reset();
+
+    t0 = esp_timer_get_time();
+    if (upload(data, len, mtu) != 0) {
+        return 1;
+    }
+    if (ota_image) {
+        write_chunk((const uint8_t *)"OTA_END", 7);
+        if (host_restart_count != 1) {
+            fprintf(stderr, "OTA did not complete\n");
+            return 1;
+        }
+        /* Reboot into the new image, dump it like DUMP ota_x */
+        transfer_reset();
+        transfer_source_partition(esp_ota_get_boot_partition()->label);
+    } else {
+        /* What the END command reports once the upload is committed */
+        if (transfer_end_upload(&src_size, &src_crc) != ESP_OK ||
+            src_size != len || src_crc != esp_rom_crc32_le(0, data, len)) {
+            fprintf(stderr, "source info %" PRIu32 " bytes crc %08" PRIx32
+                    " does not match\n", src_size, src_crc);
+            ret = 1;
+        }
+    }
+    t1 = esp_timer_get_time();
+
+    if (download(back, len, mtu) != 0 || memcmp(data, back, len) != 0) {
+        fprintf(stderr, "read back differs\n");
+        ret = 1;
+    }
+    t2 = esp_timer_get_time();
+
+    /* Disconnect */
+    transfer_reset();
+    transfer_finish_upload();
+
+    host_mbuf_get_stats(&mbufs);
+    telemetry_snapshot(&tm);
+    printf("%s: %zu bytes, mtu %u, %s\n", argv[1], len, mtu,
+           ota_image ? "ota" : "file");
+    printf("upload   %8.1f KiB/s  %" PRIu32 " chunks\n", kbps(len, t1 - t0),
+           tm.chunks_in);
+    printf("download %8.1f KiB/s  %" PRIu32 " chunks\n", kbps(len, t2 - t1),
+           tm.chunks_out);
+    if (!ota_image) {
+        printf("crc      %08" PRIx32 "\n", src_crc);
+    }
+    printf("mbufs    %" PRIu32 " allocs, peak %" PRIu32 ", leaked %" PRIu32
+           "\n",
+           mbufs.allocs, mbufs.peak, mbufs.live);
+    printf("result   %s\n", ret ? "MISMATCH" : "OK");
+
+    free(back);
+    free(data);
+    return ret || mbufs.live ? 1 : 0;
+}
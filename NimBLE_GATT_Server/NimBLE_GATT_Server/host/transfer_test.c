@@ -0,0 +1,420 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+/* Includes */
+#include "common.h"
+#include "esp_ota_ops.h"
+#include "esp_rom_crc.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "host_fs.h"
+#include "storage.h"
+#include "transfer.h"
+#include "upload_writer.h"
+#include <stdlib.h>
+#include <time.h>
+
+/*
+ * Transfer unit tests
+ *      One test per run, selected by name, so ctest reports them apart:
+ *
+ *          transfer_test offsets|ota|read_windows|read_limit|writer_error|
+ *                        transfer_error
+ *
+ *      The upload writer is the one from main/src with its task on a
+ *      thread, so chunks reach storage asynchronously like on the target.
+ *      A failed CHECK prints its location and fails the test.
+ */
+
+/* Defines */
+#define TEST_MTU 247
+#define TEST_LEN 6000
+#define FAIL_AFTER 4000 /* bytes the failing backend accepts */
+
+/* Private variables */
+static int failures = 0;
+static uint8_t data[TEST_LEN];
+
+/* Failing backend: accepts FAIL_AFTER bytes, then every write fails */
+static uint32_t fail_written;
+static uint32_t fail_write_ends;
+static uint32_t fail_delay_us;
+static uint8_t fail_data[TEST_LEN];
+
+#define CHECK(cond)                                                            \
+    do {                                                                       \
+        if (!(cond)) {                                                         \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__,   \
+                    #cond);                                                    \
+            failures++;                                                        \
+        }                                                                      \
+    } while (0)
+
+/* Private functions */
+static esp_err_t fail_write_begin(const char *obj) {
+    (void)obj;
+    fail_written = 0;
+    return ESP_OK;
+}
+
+static esp_err_t fail_write(const uint8_t *buf, size_t len) {
+    if (fail_delay_us) {
+        struct timespec ts = {0, fail_delay_us * 1000};
+        nanosleep(&ts, NULL);
+    }
+    if (fail_written + len > FAIL_AFTER) {
+        return ESP_FAIL;
+    }
+    memcpy(fail_data + fail_written, buf, len);
+    fail_written += len;
+    return ESP_OK;
+}
+
+static esp_err_t fail_write_end(void) {
+    fail_write_ends++;
+    return ESP_OK;
+}
+
+static int fail_read(const char *obj, uint32_t offset, uint8_t *buf,
+                     size_t len) {
+    (void)obj;
+    if (offset >= fail_written) {
+        return 0;
+    }
+    len = len < fail_written - offset ? len : fail_written - offset;
+    memcpy(buf, fail_data + offset, len);
+    return len;
+}
+
+static int32_t fail_size(const char *obj) {
+    (void)obj;
+    return fail_written;
+}
+
+static esp_err_t fail_remove(const char *obj) {
+    (void)obj;
+    return ESP_OK;
+}
+
+static const storage_backend_t fail_backend = {
+    .name = "fail",
+    .write_begin = fail_write_begin,
+    .write = fail_write,
+    .write_end = fail_write_end,
+    .read = fail_read,
+    .size = fail_size,
+    .remove = fail_remove,
+};
+
+static void fill_data(uint8_t first) {
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = i * 7 + (i >> 8);
+    }
+    data[0] = first;
+}
+
+static int write_chunk(const uint8_t *buf, size_t len) {
+    struct os_mbuf *om = ble_hs_mbuf_from_flat(buf, len);
+    int rc;
+
+    if (!om) {
+        return BLE_ATT_ERR_INSUFFICIENT_RES;
+    }
+    rc = transfer_write(om, (uint32_t)esp_timer_get_time());
+    os_mbuf_free_chain(om);
+    return rc;
+}
+
+/* Returns the first ATT error, 0 if every chunk was accepted */
+static int upload(const uint8_t *buf, size_t len) {
+    const size_t chunk = TEST_MTU - 3;
+
+    for (size_t pos = 0; pos < len; pos += chunk) {
+        int rc = write_chunk(buf + pos, len - pos < chunk ? len - pos : chunk);
+
+        if (rc != 0) {
+            return rc;
+        }
+    }
+    return 0;
+}
+
+/* One Read / Read Blob response, returns its length or -1 on an ATT error */
+static int read_once(uint16_t att_offset, uint16_t mtu, uint8_t *out) {
+    struct os_mbuf *om = os_msys_get_pkthdr(0, 0);
+    int rc, n;
+
+    if (!om) {
+        return -1;
+    }
+    rc = transfer_read(om, att_offset, mtu);
+    n = OS_MBUF_PKTLEN(om);
+    ble_hs_mbuf_to_flat(om, out, n, NULL);
+    os_mbuf_free_chain(om);
+    return rc == 0 ? n : -1;
+}
+
+/* Upload data as a file and commit it with END */
+static void upload_file(void) {
+    uint32_t size = 0, crc = 0;
+
+    fill_data('F');
+    transfer_reset();
+    CHECK(upload(data, sizeof(data)) == 0);
+    CHECK(transfer_end_upload(&size, &crc) == ESP_OK);
+    CHECK(size == sizeof(data));
+    CHECK(crc == esp_rom_crc32_le(0, data, sizeof(data)));
+}
+
+/* The ATT offset of a read is relative to the file_offset window */
+static void test_offsets(void) {
+    static const uint32_t offsets[] = {0, 1, 511, 2047, 2048, 4000, 5999};
+    static const uint16_t att_offsets[] = {0, 1, 244, 490};
+    uint8_t out[TEST_MTU];
+
+    upload_file();
+    transfer_source_file();
+    for (size_t i = 0; i < sizeof(offsets) / sizeof(offsets[0]); i++) {
+        for (size_t j = 0; j < sizeof(att_offsets) / sizeof(att_offsets[0]);
+             j++) {
+            uint32_t pos = offsets[i] + att_offsets[j];
+            size_t want = pos < sizeof(data) ? sizeof(data) - pos : 0;
+            int n;
+
+            want = want < TEST_MTU - 1 ? want : TEST_MTU - 1;
+            want = want < BLE_ATT_ATTR_MAX_LEN - att_offsets[j]
+                       ? want
+                       : BLE_ATT_ATTR_MAX_LEN - att_offsets[j];
+            transfer_set_offset(offsets[i]);
+            n = read_once(att_offsets[j], TEST_MTU, out);
+            CHECK(n == (int)want);
+            CHECK(n <= 0 || memcmp(out, data + pos, n) == 0);
+        }
+    }
+
+    /* Past the end: an empty response, not an error */
+    transfer_set_offset(sizeof(data) + 100);
+    CHECK(read_once(0, TEST_MTU, out) == 0);
+}
+
+/* 0xE9 on the first chunk goes to the OTA partition, anything else to a file */
+static void test_ota(void) {
+    const esp_partition_t *target = esp_ota_get_next_update_partition(NULL);
+    uint32_t size = 0, crc = 0;
+    uint8_t out[TEST_MTU];
+
+    upload_file();
+
+    fill_data(0xE9);
+    transfer_reset();
+    CHECK(upload(data, sizeof(data)) == 0);
+    CHECK(upload_writer_backend() == NULL);
+    CHECK(transfer_end_upload(&size, &crc) == ESP_ERR_INVALID_STATE);
+    CHECK(write_chunk((const uint8_t *)"OTA_END", 7) == 0);
+    CHECK(host_restart_count == 1);
+    CHECK(esp_ota_get_boot_partition() == target);
+
+    /* The image landed in the partition, upload.txt is untouched */
+    transfer_reset();
+    CHECK(transfer_source_partition(target->label) == ESP_OK);
+    CHECK(read_once(0, TEST_MTU, out) == TEST_MTU - 1);
+    CHECK(memcmp(out, data, TEST_MTU - 1) == 0);
+
+    /* Bond keys and the boot selection are never served */
+    CHECK(transfer_source_partition("nvs") == ESP_ERR_NOT_ALLOWED);
+    CHECK(transfer_source_partition("otadata") == ESP_ERR_NOT_ALLOWED);
+    CHECK(read_once(0, TEST_MTU, out) == TEST_MTU - 1);
+    CHECK(memcmp(out, data, TEST_MTU - 1) == 0);
+    transfer_source_file();
+    CHECK(transfer_source_info(&size, NULL) == ESP_OK);
+    CHECK(size == sizeof(data));
+    CHECK(read_once(0, TEST_MTU, out) == TEST_MTU - 1);
+    CHECK(out[0] == 'F');
+
+    /* Not an image: OTA_END is just data */
+    fill_data('T');
+    transfer_reset();
+    CHECK(write_chunk(data, 100) == 0);
+    CHECK(write_chunk((const uint8_t *)"OTA_END", 7) == 0);
+    CHECK(host_restart_count == 1);
+    CHECK(transfer_end_upload(&size, &crc) == ESP_OK);
+    CHECK(size == 107);
+}
+
+/* Long reads walk 512 byte windows at any MTU, across read cache refills */
+static void test_read_windows(void) {
+    static const uint16_t mtus[] = {23, 185, 247, 517};
+    static uint8_t back[TEST_LEN];
+    uint8_t out[BLE_ATT_MTU_MAX];
+
+    upload_file();
+    transfer_source_file();
+    for (size_t i = 0; i < sizeof(mtus) / sizeof(mtus[0]); i++) {
+        uint16_t mtu = mtus[i];
+        size_t pos = 0;
+
+        memset(back, 0, sizeof(back));
+        while (pos < sizeof(back)) {
+            size_t window = 0;
+            int n;
+
+            transfer_set_offset(pos);
+            do {
+                n = read_once(window, mtu, out);
+                CHECK(n >= 0);
+                if (n <= 0) {
+                    break;
+                }
+                n = n < BLE_ATT_ATTR_MAX_LEN - (int)window
+                        ? n
+                        : BLE_ATT_ATTR_MAX_LEN - (int)window;
+                memcpy(back + pos + window, out, n);
+                window += n;
+            } while (n == mtu - 1 && window < BLE_ATT_ATTR_MAX_LEN);
+
+            if (window == 0) {
+                break;
+            }
+            pos += window;
+        }
+        CHECK(pos == sizeof(data));
+        CHECK(memcmp(back, data, sizeof(data)) == 0);
+    }
+}
+
+/* A long read that never stops on its own still ends at the attribute max */
+static void test_read_limit(void) {
+    static const uint16_t mtus[] = {23, 247, 517};
+    static const uint16_t past[] = {BLE_ATT_ATTR_MAX_LEN,
+                                    BLE_ATT_ATTR_MAX_LEN + 1, 600, 4000, 65535};
+    uint8_t back[BLE_ATT_ATTR_MAX_LEN];
+    uint8_t out[BLE_ATT_MTU_MAX];
+
+    upload_file();
+    transfer_source_file();
+    for (size_t i = 0; i < sizeof(mtus) / sizeof(mtus[0]); i++) {
+        uint16_t mtu = mtus[i];
+        size_t window = 0;
+        int n;
+
+        /* Read Blob until a short response, like BlueZ does */
+        transfer_set_offset(1000);
+        do {
+            n = read_once(window, mtu, out);
+            CHECK(n >= 0 && window + n <= sizeof(back));
+            if (n <= 0 || window + n > sizeof(back)) {
+                break;
+            }
+            memcpy(back + window, out, n);
+            window += n;
+        } while (n == mtu - 1);
+        CHECK(window == BLE_ATT_ATTR_MAX_LEN);
+        CHECK(memcmp(back, data + 1000, window) == 0);
+
+        for (size_t j = 0; j < sizeof(past) / sizeof(past[0]); j++) {
+            CHECK(read_once(past[j], mtu, out) == 0);
+        }
+    }
+}
+
+/* A backend error is kept and returned by later submits, sync and end */
+static void test_writer_error(void) {
+    const size_t chunk = TEST_MTU - 3;
+    esp_err_t err = ESP_OK;
+    uint32_t seq;
+    size_t pos;
+
+    fill_data('W');
+    CHECK(upload_writer_begin(&fail_backend) == ESP_OK);
+    CHECK(upload_writer_begin(&fail_backend) == ESP_ERR_INVALID_STATE);
+
+    /* Slow writes fill every slot, submit waits instead of failing */
+    fail_delay_us = 2000;
+    for (pos = 0; pos + chunk <= FAIL_AFTER; pos += chunk) {
+        CHECK(upload_writer_submit(data + pos, chunk, 0, &seq) == ESP_OK);
+    }
+    CHECK(upload_writer_sync() == ESP_OK);
+    CHECK(fail_written == pos);
+    CHECK(memcmp(fail_data, data, pos) == 0);
+    fail_delay_us = 0;
+
+    /* The chunk crossing FAIL_AFTER is accepted, its error shows up later */
+    CHECK(upload_writer_submit(data + pos, chunk, 0, &seq) == ESP_OK);
+    CHECK(upload_writer_sync() == ESP_FAIL);
+    for (int i = 0; i < UPLOAD_WRITER_SLOTS * 2 && err == ESP_OK; i++) {
+        err = upload_writer_submit(data, chunk, 0, &seq);
+    }
+    CHECK(err == ESP_FAIL);
+    CHECK(upload_writer_end() == ESP_FAIL);
+    CHECK(fail_write_ends == 1);
+    CHECK(upload_writer_backend() == NULL);
+
+    /* The next upload starts clean */
+    fail_written = 0;
+    CHECK(upload_writer_begin(&fail_backend) == ESP_OK);
+    CHECK(upload_writer_submit(data, chunk, 0, &seq) == ESP_OK);
+    CHECK(upload_writer_end() == ESP_OK);
+    CHECK(fail_written == chunk);
+    CHECK(fail_write_ends == 2);
+}
+
+/* END reports the write error the acknowledged chunks could not */
+static void test_transfer_error(void) {
+    uint32_t size = 0, crc = 0;
+    int rc;
+
+    fill_data('E');
+    host_storage = &fail_backend;
+    transfer_reset();
+    rc = upload(data, sizeof(data));
+    CHECK(rc == 0 || rc == BLE_ATT_ERR_UNLIKELY);
+    CHECK(transfer_end_upload(&size, &crc) == ESP_FAIL);
+    CHECK(fail_write_ends == 1);
+    CHECK(transfer_end_upload(&size, &crc) == ESP_ERR_INVALID_STATE);
+
+    /* A new upload on the same connection */
+    CHECK(upload(data, 1000) == 0);
+    CHECK(transfer_end_upload(&size, &crc) == ESP_OK);
+    CHECK(size == 1000);
+    CHECK(crc == esp_rom_crc32_le(0, data, 1000));
+    host_storage = &storage_spiffs_backend;
+}
+
+/* Public functions */
+int main(int argc, char **argv) {
+    static const struct {
+        const char *name;
+        void (*fn)(void);
+    } tests[] = {
+        {"offsets", test_offsets},
+        {"ota", test_ota},
+        {"read_windows", test_read_windows},
+        {"read_limit", test_read_limit},
+        {"writer_error", test_writer_error},
+        {"transfer_error", test_transfer_error},
+    };
+
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <test>\n", argv[0]);
+        return 2;
+    }
+    if (getenv("HOST_LOG_LEVEL")) {
+        host_log_level = atoi(getenv("HOST_LOG_LEVEL"));
+    }
+    if (upload_writer_init() != ESP_OK) {
+        fprintf(stderr, "upload_writer_init failed\n");
+        return 1;
+    }
+
+    for (size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); i++) {
+        if (strcmp(argv[1], tests[i].name) == 0) {
+            tests[i].fn();
+            printf("%s: %s\n", tests[i].name, failures ? "FAILED" : "OK");
+            return failures ? 1 : 0;
+        }
+    }
+    fprintf(stderr, "unknown test %s\n", argv[1]);
+    return 2;
+}
@@ -0,0 +1,37 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+#ifndef FS_MAINT_H
+#define FS_MAINT_H
+
+/* Includes */
+/* STD APIs */
+#include <stdbool.h>
+#include <stdint.h>
+
+/* ESP APIs */
+#include "esp_err.h"
+
+/* Defines */
+#define FS_MAINT_STALL_US (50 * 1000) /* a single write longer than this */
+
+typedef struct {
+    uint32_t gc_runs;        /* idle periods in which GC was run */
+    uint32_t gc_slices;      /* esp_spiffs_gc calls */
+    uint32_t gc_time_ms;     /* total time spent in GC slices */
+    uint32_t gc_max_us;      /* longest single GC slice */
+    uint32_t clean_kb;       /* pre-cleaned space reached in the last run */
+    uint32_t write_stalls;   /* writes longer than FS_MAINT_STALL_US */
+    uint32_t write_max_us;   /* longest single write */
+} fs_maint_stats_t;
+
+/* Public function declarations */
+esp_err_t fs_maint_init(void);
+void fs_maint_activity(void);
+void fs_maint_session(bool active);
+void fs_maint_note_write(uint32_t us);
+void fs_maint_get_stats(fs_maint_stats_t *stats);
+
+#endif // FS_MAINT_H
@@ -0,0 +1,39 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+#ifndef FS_MOUNT_H
+#define FS_MOUNT_H
+
+/* Includes */
+/* STD APIs */
+#include <stddef.h>
+#include <stdint.h>
+
+/* ESP APIs */
+#include "esp_err.h"
+
+/* Defines */
+/* Kept at /spiffs for LittleFS too; the host build overrides it */
+#ifndef FS_BASE_PATH
+#define FS_BASE_PATH "/spiffs"
+#endif
+#define FS_PARTITION_LABEL "spiffs"
+#define FS_MAX_FILES 5
+
+typedef enum {
+    FS_TYPE_SPIFFS,
+    FS_TYPE_LITTLEFS,
+    FS_TYPE_NONE,
+} fs_type_t;
+
+/* Public function declarations */
+esp_err_t fs_mount_init(void);
+esp_err_t fs_mount_request(fs_type_t type);
+fs_type_t fs_mount_type(void);
+const char *fs_type_name(fs_type_t type);
+uint32_t fs_mount_time_us(void);
+esp_err_t fs_mount_info(size_t *total, size_t *used);
+
+#endif // FS_MOUNT_H
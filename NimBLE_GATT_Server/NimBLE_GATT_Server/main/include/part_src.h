@@ -0,0 +1,33 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+#ifndef PART_SRC_H
+#define PART_SRC_H
+
+/* Includes */
+/* STD APIs */
+#include <stdbool.h>
+#include <stdint.h>
+
+/* ESP APIs */
+#include "esp_err.h"
+
+/* NimBLE APIs */
+#include "os/os_mbuf.h"
+
+/* Defines */
+/* Size of the flash window kept mapped at a time, one MMU page */
+#define PART_SRC_MAP_WINDOW (64 * 1024)
+
+/* Public function declarations */
+esp_err_t part_src_open(const char *label);
+void part_src_close(void);
+bool part_src_is_open(void);
+const char *part_src_label(void);
+uint32_t part_src_size(void);
+int part_src_append(struct os_mbuf *om, uint32_t offset, uint32_t len);
+esp_err_t part_src_crc32(uint32_t *crc);
+
+#endif // PART_SRC_H
@@ -0,0 +1,75 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+#ifndef STORAGE_H
+#define STORAGE_H
+
+/* Includes */
+/* STD APIs */
+#include <stddef.h>
+#include <stdint.h>
+
+/* ESP APIs */
+#include "esp_err.h"
+
+/* Defines */
+#define STORAGE_UPLOAD_OBJ "upload.txt"
+#define STORAGE_OBJ_NAME_LEN 16
+
+/*
+ * Storage backend interface
+ *      Uploaded files are stored as named objects in one of several
+ *      backends. Each backend supports a single open writer at a time;
+ *      reads of the object being written see the data appended so far.
+ */
+typedef struct {
+    const char *name;
+
+    /* Maximum number of objects kept, 0 if only limited by space */
+    uint16_t max_objects;
+
+    /* Probe/mount the backend, called once at boot */
+    esp_err_t (*init)(void);
+
+    /* Start a new object, replacing any previous object of that name */
+    esp_err_t (*write_begin)(const char *obj);
+
+    /* Append to the object opened by write_begin */
+    esp_err_t (*write)(const uint8_t *data, size_t len);
+
+    /* Commit the open object */
+    esp_err_t (*write_end)(void);
+
+    /* Read up to len bytes at offset, returns bytes read, 0 on EOF, <0 on error */
+    int (*read)(const char *obj, uint32_t offset, uint8_t *buf, size_t len);
+
+    /* Size of an object in bytes, <0 if it does not exist */
+    int32_t (*size)(const char *obj);
+
+    /* Delete an object */
+    esp_err_t (*remove)(const char *obj);
+
+    /*
+     * Bytes that can be written without evicting stored objects, NULL
+     * for backends that fail a write instead of making room
+     */
+    uint32_t (*free_space)(void);
+} storage_backend_t;
+
+/* Backends */
+extern const storage_backend_t storage_spiffs_backend;
+extern const storage_backend_t storage_littlefs_backend;
+extern const storage_backend_t storage_rawlog_backend;
+
+/* Public function declarations */
+esp_err_t storage_init(void);
+const storage_backend_t *storage_get(void);
+esp_err_t storage_select(const char *name);
+const storage_backend_t *storage_find(const char *name);
+size_t storage_count(void);
+const storage_backend_t *storage_at(size_t i);
+uint32_t storage_mount_time_us(const storage_backend_t *backend);
+
+#endif // STORAGE_H
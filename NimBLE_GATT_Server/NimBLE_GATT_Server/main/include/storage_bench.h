@@ -0,0 +1,29 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+#ifndef STORAGE_BENCH_H
+#define STORAGE_BENCH_H
+
+/* Includes */
+/* STD APIs */
+#include <stdbool.h>
+#include <stdint.h>
+
+/* ESP APIs */
+#include "esp_err.h"
+
+/* Defines */
+#define STORAGE_BENCH_OBJ "bench.bin"
+#define STORAGE_BENCH_DEFAULT_KB 64
+#define STORAGE_BENCH_CHUNK 244 /* ATT payload at the preferred MTU of 247 */
+#define STORAGE_BENCH_SMALL_FILES 16
+#define STORAGE_BENCH_SMALL_SIZE 128
+
+/* Public function declarations */
+esp_err_t storage_bench_start(uint32_t size_kb);
+bool storage_bench_running(void);
+const char *storage_bench_result(void);
+
+#endif // STORAGE_BENCH_H
@@ -0,0 +1,56 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+#ifndef SYS_STATS_H
+#define SYS_STATS_H
+
+/* Includes */
+/* STD APIs */
+#include <stddef.h>
+#include <stdint.h>
+
+/* ESP APIs */
+#include "esp_err.h"
+
+/* Defines */
+#define SYS_STATS_VERSION 1
+#define SYS_STATS_MAX_TASKS 16
+#define SYS_STATS_NAME_LEN 12
+
+typedef struct __attribute__((packed)) {
+    char name[SYS_STATS_NAME_LEN]; /* not terminated when 12 chars long */
+    uint8_t priority;
+    uint8_t state;        /* eTaskState */
+    uint16_t cpu_permille; /* share of all cores over the last period */
+    uint16_t stack_free;  /* stack high-water mark, bytes never used */
+} sys_stats_task_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t free;
+    uint32_t largest;
+    uint32_t min_free;
+} sys_stats_heap_t;
+
+/*
+ * Value of the stats characteristic, little endian. Only the first
+ * task_count entries of tasks are sent.
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t version;
+    uint8_t task_count;
+    uint8_t cores;
+    uint8_t reserved;
+    uint32_t uptime_ms;
+    uint32_t period_ms; /* time covered by cpu_permille */
+    sys_stats_heap_t internal;
+    sys_stats_heap_t dma;
+    sys_stats_task_t tasks[SYS_STATS_MAX_TASKS];
+} sys_stats_t;
+
+/* Public function declarations */
+esp_err_t sys_stats_init(void);
+size_t sys_stats_get(sys_stats_t *out);
+
+#endif // SYS_STATS_H
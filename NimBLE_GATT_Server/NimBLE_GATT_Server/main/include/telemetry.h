@@ -0,0 +1,59 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+/* Includes */
+/* STD APIs */
+#include <stdint.h>
+
+/* Defines */
+#define TELEMETRY_VERSION 1
+#define TELEMETRY_HIST_BUCKETS 16 /* [2^i, 2^(i+1)) us, last one open-ended */
+
+typedef enum {
+    TELEMETRY_HIST_FLASH_WRITE,
+    TELEMETRY_HIST_FLASH_ERASE,
+    TELEMETRY_HIST_COUNT,
+} telemetry_hist_t;
+
+/*
+ * Value of the telemetry characteristic, little endian. Byte counters are
+ * per connection; histograms and GC counters are since boot.
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t version;
+    uint8_t tx_phy;
+    uint8_t rx_phy;
+    uint8_t reserved;
+    uint16_t mtu;
+    uint16_t conn_itvl;       /* 1.25 ms units */
+    uint32_t session;         /* connection count since boot */
+    uint32_t bytes_in;
+    uint32_t bytes_out;
+    uint32_t chunks_in;
+    uint32_t chunks_out;
+    uint32_t retransmits;     /* reads repeated at the same position */
+    uint16_t queue_depth;     /* work queued behind the host task */
+    uint16_t queue_peak;
+    uint32_t gc_slices;
+    uint32_t gc_max_us;
+    uint32_t write_stalls;
+    uint32_t hist[TELEMETRY_HIST_COUNT][TELEMETRY_HIST_BUCKETS];
+} telemetry_t;
+
+/* Public function declarations */
+void telemetry_session_begin(void);
+void telemetry_link(uint16_t mtu, uint16_t conn_itvl, uint8_t tx_phy,
+                    uint8_t rx_phy);
+void telemetry_in(uint32_t len);
+void telemetry_out(uint32_t len);
+void telemetry_retransmit(void);
+void telemetry_queue_depth(uint16_t depth);
+void telemetry_latency(telemetry_hist_t hist, uint32_t us);
+void telemetry_snapshot(telemetry_t *out);
+
+#endif // TELEMETRY_H
@@ -0,0 +1,56 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+#ifndef TRACE_H
+#define TRACE_H
+
+/* Includes */
+/* STD APIs */
+#include <stddef.h>
+#include <stdint.h>
+
+/* ESP APIs */
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+/* Defines */
+#define TRACE_ENTRIES CONFIG_FILE_TRACE_ENTRIES
+
+typedef enum {
+    TRACE_NONE,
+    TRACE_CONNECT,      /* conn_handle, status */
+    TRACE_DISCONNECT,   /* reason */
+    TRACE_CONN_UPDATE,  /* conn_itvl, latency */
+    TRACE_MTU,          /* mtu */
+    TRACE_PHY,          /* tx_phy, rx_phy */
+    TRACE_UPLOAD_BEGIN, /* esp_err_t */
+    TRACE_UPLOAD_CHUNK, /* len, esp_err_t */
+    TRACE_UPLOAD_END,   /* esp_err_t */
+    TRACE_READ,         /* position, len */
+    TRACE_READ_OFFSET,  /* window offset */
+    TRACE_OTA_BEGIN,    /* partition address, esp_err_t */
+    TRACE_OTA_CHUNK,    /* len, esp_err_t */
+    TRACE_OTA_END,      /* esp_err_t */
+    TRACE_ID_COUNT,
+} trace_id_t;
+
+/* One ring entry, also the wire format of a dump (little endian) */
+typedef struct __attribute__((packed)) {
+    uint32_t ts_us;
+    uint16_t id;
+    uint16_t seq;
+    uint32_t arg0;
+    uint32_t arg1;
+} trace_entry_t;
+
+/* Public function declarations */
+void trace_record(trace_id_t id, uint32_t arg0, uint32_t arg1);
+size_t trace_snapshot(trace_entry_t *out, size_t max);
+const char *trace_id_name(uint16_t id);
+esp_err_t trace_print_async(void);
+
+#define TRACE(id, a0, a1) trace_record((id), (uint32_t)(a0), (uint32_t)(a1))
+
+#endif // TRACE_H
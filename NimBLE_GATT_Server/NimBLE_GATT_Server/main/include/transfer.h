@@ -0,0 +1,39 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+#ifndef TRANSFER_H
+#define TRANSFER_H
+
+/* Includes */
+/* STD APIs */
+#include <stddef.h>
+#include <stdint.h>
+
+/* ESP APIs */
+#include "esp_err.h"
+
+/* NimBLE APIs */
+#include "os/os_mbuf.h"
+
+/* Defines */
+#define TRANSFER_CHUNK_MAX 517 /* largest ATT write at the max MTU */
+#define TRANSFER_READ_CACHE_SIZE 2048
+
+/* Public function declarations */
+void transfer_reset(void);
+esp_err_t transfer_finish_upload(void);
+esp_err_t transfer_end_upload(uint32_t *size, uint32_t *crc);
+void transfer_complete_ota(void);
+int transfer_write(struct os_mbuf *om, uint32_t rx);
+int transfer_read(struct os_mbuf *om, uint16_t att_offset, uint16_t mtu);
+int transfer_read_at(struct os_mbuf *om, uint32_t pos, size_t len);
+esp_err_t transfer_source_info(uint32_t *size, uint32_t *crc);
+void transfer_set_offset(uint32_t offset);
+esp_err_t transfer_source_partition(const char *label);
+void transfer_source_memory(void *buf, size_t len);
+void transfer_source_file(void);
+void transfer_invalidate(void);
+
+#endif // TRANSFER_H
@@ -0,0 +1,54 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+#ifndef UPLOAD_WRITER_H
+#define UPLOAD_WRITER_H
+
+/* Includes */
+/* STD APIs */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* ESP APIs */
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+/* Module headers */
+#include "storage.h"
+
+/* Defines */
+#define UPLOAD_WRITER_SLOTS 8
+#define UPLOAD_WRITER_CHUNK_MAX 517 /* largest ATT write at the max MTU */
+#define UPLOAD_LAT_CHUNKS CONFIG_FILE_LATENCY_CHUNKS
+
+/*
+ * Stage timestamps of one upload chunk, esp_timer microseconds truncated
+ * to 32 bits. Zero means the stage has not been reached (yet).
+ */
+typedef struct {
+    uint32_t seq;
+    uint16_t len;
+    uint16_t depth;    /* queue depth after enqueue */
+    uint32_t rx;       /* GATT access callback entry */
+    uint32_t enq;      /* handed to the writer task */
+    uint32_t ack;      /* access callback returns, write response queued */
+    uint32_t deq;      /* picked up by the writer task */
+    uint32_t wr_start; /* backend write start */
+    uint32_t wr_end;   /* backend write end */
+} upload_lat_t;
+
+/* Public function declarations */
+esp_err_t upload_writer_init(void);
+esp_err_t upload_writer_begin(const storage_backend_t *backend);
+esp_err_t upload_writer_submit(const uint8_t *data, size_t len, uint32_t rx,
+                               uint32_t *seq);
+void upload_writer_ack(uint32_t seq);
+esp_err_t upload_writer_sync(void);
+esp_err_t upload_writer_end(void);
+const storage_backend_t *upload_writer_backend(void);
+size_t upload_writer_csv(char *buf, size_t size);
+
+#endif // UPLOAD_WRITER_H
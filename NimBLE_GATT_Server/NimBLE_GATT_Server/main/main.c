@@ -8,7 +8,11 @@
 #include "gap.h"
 #include "gatt_svc.h"
 #include "led.h"
-#include "esp_spiffs.h"
+#include "fs_maint.h"
+#include "fs_mount.h"
+#include "storage.h"
+#include "sys_stats.h"
+#include "upload_writer.h"
 #include "esp_vfs.h"
 #include "esp_log.h"
 #include "esp_ota_ops.h"
@@ -108,27 +112,36 @@ void app_main(void) {
     /* LED initialization */
     led_init();
 
-    /* Mount SPIFFS */
-    esp_vfs_spiffs_conf_t conf = {
-        .base_path = "/spiffs",
-        .partition_label = NULL,
-        .max_files = 5,
-        .format_if_mount_failed = true
-    };
+    /*
+     * NVS flash initialization
+     * Dependency of BLE stack to store configurations, and of the file
+     * system mount layer to remember the selected file system
+     */
+    ret = nvs_flash_init();
+    if (ret == ESP_ERR_NVS_NO_FREE_PAGES ||
+        ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        ret = nvs_flash_init();
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "failed to initialize nvs flash, error code: %d ", ret);
+        return;
+    }
 
-    ret = esp_vfs_spiffs_register(&conf);
+    /* Mount SPIFFS or LittleFS */
+    ret = fs_mount_init();
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to mount or format SPIFFS (%s)",
+        ESP_LOGE(TAG, "Failed to mount or format %s (%s)", FS_PARTITION_LABEL,
                  esp_err_to_name(ret));
         return;
     } else {
         size_t total = 0, used = 0;
-        esp_spiffs_info(NULL, &total, &used);
-        ESP_LOGI(TAG, "SPIFFS mounted. Total: %d bytes, Used: %d bytes",
-                 total, used);
+        fs_mount_info(&total, &used);
+        ESP_LOGI(TAG, "%s mounted. Total: %d bytes, Used: %d bytes",
+                 fs_type_name(fs_mount_type()), total, used);
     }
 
-    FILE *fp = fopen("/spiffs/upload.txt", "a+");
+    FILE *fp = fopen(FS_BASE_PATH "/" STORAGE_UPLOAD_OBJ, "a+");
     if (fp) {
         fclose(fp);
         ESP_LOGI(TAG, "Ensured upload.txt exists");
@@ -136,18 +149,31 @@ void app_main(void) {
         ESP_LOGE(TAG, "Could not create initial file");
     }
 
-    /*
-     * NVS flash initialization
-     * Dependency of BLE stack to store configurations
-     */
-    ret = nvs_flash_init();
-    if (ret == ESP_ERR_NVS_NO_FREE_PAGES ||
-        ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
-        ESP_ERROR_CHECK(nvs_flash_erase());
-        ret = nvs_flash_init();
+    /* Storage backends for uploads */
+    ret = storage_init();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "failed to initialize storage, error code: %d", ret);
+        return;
     }
+
+    /* Writer task that takes uploads off the NimBLE host task */
+    ret = upload_writer_init();
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "failed to initialize nvs flash, error code: %d ", ret);
+        ESP_LOGE(TAG, "failed to start upload writer, error code: %d", ret);
+        return;
+    }
+
+    /* Task CPU, stack and heap sampling for the stats characteristic */
+    ret = sys_stats_init();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "failed to start stats sampling, error code: %d", ret);
+        return;
+    }
+
+    /* Background SPIFFS garbage collection while the link is idle */
+    ret = fs_maint_init();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "failed to start fs maintenance, error code: %d", ret);
         return;
     }
 
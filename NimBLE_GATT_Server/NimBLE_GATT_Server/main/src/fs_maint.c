@@ -0,0 +1,155 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+/* Includes */
+#include "fs_maint.h"
+#include "common.h"
+#include "fs_mount.h"
+#include "esp_spiffs.h"
+#include "esp_timer.h"
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <sys/param.h>
+
+/*
+ * File system maintenance
+ *      SPIFFS collects garbage lazily, inside the write that runs out of
+ *      clean pages, which can stall an upload for hundreds of ms. This
+ *      task does that work ahead of time: once no upload is open and the
+ *      link has been quiet for a while, it grows the amount of clean space
+ *      one slice at a time with esp_spiffs_gc until the reserve is met.
+ *      LittleFS does not need it, so the task idles when it is mounted.
+ */
+
+/* Defines */
+#define FS_MAINT_TASK_STACK (3 * 1024)
+#define FS_MAINT_POLL_MS 250
+
+/* Private variables */
+/*
+ * Written from the host task, read here: a 32 bit ms timestamp is a single
+ * load/store on the target, the difference stays right across wraparound
+ */
+static atomic_uint_fast32_t last_activity_ms;
+static volatile bool session_active = false;
+static fs_maint_stats_t maint_stats;
+static uint32_t gc_target;
+
+/* Private functions */
+static uint32_t fs_maint_now_ms(void) {
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+static void fs_maint_touch(void) {
+    atomic_store_explicit(&last_activity_ms, fs_maint_now_ms(),
+                          memory_order_relaxed);
+}
+
+static bool fs_maint_idle(void) {
+    uint32_t last =
+        atomic_load_explicit(&last_activity_ms, memory_order_relaxed);
+
+    return !session_active &&
+           fs_maint_now_ms() - last >= CONFIG_FILE_FS_GC_IDLE_MS;
+}
+
+/* Runs one GC slice, returns false once there is nothing left to do */
+static bool fs_maint_gc_slice(void) {
+    const uint32_t reserve = CONFIG_FILE_FS_GC_RESERVE_KB * 1024;
+    const uint32_t slice = CONFIG_FILE_FS_GC_SLICE_KB * 1024;
+    size_t total = 0, used = 0;
+    int64_t start;
+    uint32_t us;
+    esp_err_t err;
+
+    if (esp_spiffs_info(FS_PARTITION_LABEL, &total, &used) != ESP_OK ||
+        total <= used + slice) {
+        return false;
+    }
+
+    /* Never ask for more than the free space, GC could not deliver it */
+    gc_target = MIN(gc_target + slice, MIN(reserve, total - used - slice));
+    if (gc_target == 0) {
+        return false;
+    }
+
+    start = esp_timer_get_time();
+    err = esp_spiffs_gc(FS_PARTITION_LABEL, gc_target);
+    us = esp_timer_get_time() - start;
+
+    maint_stats.gc_slices++;
+    maint_stats.gc_time_ms += us / 1000;
+    maint_stats.gc_max_us = MAX(maint_stats.gc_max_us, us);
+    if (err != ESP_OK) {
+        ESP_LOGD(TAG, "spiffs gc stopped at %" PRIu32 " bytes: %s", gc_target,
+                 esp_err_to_name(err));
+        return false;
+    }
+
+    maint_stats.clean_kb = gc_target / 1024;
+    return gc_target < MIN(reserve, total - used - slice);
+}
+
+static void fs_maint_task(void *param) {
+    /* Dirty pages may be left over from before the reboot */
+    bool pending = true;
+
+    for (;;) {
+        vTaskDelay(pdMS_TO_TICKS(FS_MAINT_POLL_MS));
+
+        if (fs_mount_type() != FS_TYPE_SPIFFS) {
+            continue;
+        }
+
+        /* Activity restarts the ramp, writes may have dirtied pages */
+        if (!fs_maint_idle()) {
+            gc_target = 0;
+            pending = true;
+            continue;
+        }
+        if (!pending) {
+            continue;
+        }
+
+        /* One bounded slice per poll so a new request waits at most one */
+        if (gc_target == 0) {
+            maint_stats.gc_runs++;
+        }
+        pending = fs_maint_gc_slice();
+        if (!pending) {
+            ESP_LOGI(TAG, "spiffs gc: %" PRIu32 " KB clean, slowest slice "
+                     "%" PRIu32 " us", maint_stats.clean_kb,
+                     maint_stats.gc_max_us);
+        }
+    }
+}
+
+/* Public functions */
+esp_err_t fs_maint_init(void) {
+    fs_maint_touch();
+    if (xTaskCreate(fs_maint_task, "FS Maint", FS_MAINT_TASK_STACK, NULL, 1,
+                    NULL) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+/* Called on every file transfer access */
+void fs_maint_activity(void) { fs_maint_touch(); }
+
+/* Upload open on the file system; GC is held off until it is committed */
+void fs_maint_session(bool active) {
+    session_active = active;
+    fs_maint_touch();
+}
+
+void fs_maint_note_write(uint32_t us) {
+    if (us > FS_MAINT_STALL_US) {
+        maint_stats.write_stalls++;
+    }
+    maint_stats.write_max_us = MAX(maint_stats.write_max_us, us);
+}
+
+void fs_maint_get_stats(fs_maint_stats_t *stats) { *stats = maint_stats; }
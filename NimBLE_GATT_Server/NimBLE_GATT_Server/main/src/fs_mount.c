@@ -0,0 +1,309 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+/* Includes */
+#include "fs_mount.h"
+#include "common.h"
+#include "storage.h"
+#include "esp_littlefs.h"
+#include "esp_spiffs.h"
+#include "esp_timer.h"
+#include "nvs.h"
+#include <dirent.h>
+#include <inttypes.h>
+#include <sys/stat.h>
+
+/*
+ * File system mount layer
+ *      The "spiffs" data partition can hold either SPIFFS or LittleFS,
+ *      mounted at FS_BASE_PATH. The type comes from Kconfig unless it
+ *      was changed at runtime with fs_mount_request, which is stored in
+ *      NVS and applied on the next boot.
+ *
+ *      If the partition still holds the other file system, its files are
+ *      migrated: they are packed into a single object on the raw log
+ *      partition, the partition is reformatted and the files restored.
+ */
+
+/* Defines */
+#define FS_NVS_NAMESPACE "fs_mount"
+#define FS_NVS_KEY_TYPE "type"
+#define FS_MIGRATE_OBJ "migrate.pak"
+#define FS_MIGRATE_BUF_SIZE 512
+#define FS_PATH_MAX 64
+
+#if CONFIG_FILE_FS_LITTLEFS
+#define FS_DEFAULT_TYPE FS_TYPE_LITTLEFS
+#else
+#define FS_DEFAULT_TYPE FS_TYPE_SPIFFS
+#endif
+
+/* Private variables */
+static fs_type_t mounted_type = FS_TYPE_NONE;
+static uint32_t mount_time_us = 0;
+
+/* Private functions */
+static esp_err_t fs_mount(fs_type_t type, bool format) {
+    int64_t start = esp_timer_get_time();
+    esp_err_t err;
+
+    if (type == FS_TYPE_LITTLEFS) {
+        esp_vfs_littlefs_conf_t conf = {
+            .base_path = FS_BASE_PATH,
+            .partition_label = FS_PARTITION_LABEL,
+            .format_if_mount_failed = format,
+        };
+        err = esp_vfs_littlefs_register(&conf);
+    } else {
+        esp_vfs_spiffs_conf_t conf = {
+            .base_path = FS_BASE_PATH,
+            .partition_label = FS_PARTITION_LABEL,
+            .max_files = FS_MAX_FILES,
+            .format_if_mount_failed = format,
+        };
+        err = esp_vfs_spiffs_register(&conf);
+    }
+
+    if (err == ESP_OK) {
+        mounted_type = type;
+        mount_time_us = esp_timer_get_time() - start;
+        ESP_LOGI(TAG, "%s mounted in %" PRIu32 " us", fs_type_name(type),
+                 mount_time_us);
+    }
+    return err;
+}
+
+static void fs_unmount(void) {
+    if (mounted_type == FS_TYPE_LITTLEFS) {
+        esp_vfs_littlefs_unregister(FS_PARTITION_LABEL);
+    } else if (mounted_type == FS_TYPE_SPIFFS) {
+        esp_vfs_spiffs_unregister(FS_PARTITION_LABEL);
+    }
+    mounted_type = FS_TYPE_NONE;
+}
+
+static fs_type_t fs_load_type(void) {
+    nvs_handle_t handle;
+    uint8_t type = FS_DEFAULT_TYPE;
+
+    if (nvs_open(FS_NVS_NAMESPACE, NVS_READONLY, &handle) == ESP_OK) {
+        nvs_get_u8(handle, FS_NVS_KEY_TYPE, &type);
+        nvs_close(handle);
+    }
+    return type < FS_TYPE_NONE ? type : FS_DEFAULT_TYPE;
+}
+
+/*
+ * Pack every regular file of the mounted file system into one raw log
+ * object: [name_len:u8][name][size:u32][data] per file
+ */
+static esp_err_t fs_pack(const storage_backend_t *stage, uint8_t *buf) {
+    char path[FS_PATH_MAX];
+    struct dirent *ent;
+    struct stat st;
+    esp_err_t err;
+    DIR *dir;
+
+    dir = opendir(FS_BASE_PATH);
+    if (!dir) {
+        return ESP_FAIL;
+    }
+    err = stage->write_begin(FS_MIGRATE_OBJ);
+
+    while (err == ESP_OK && (ent = readdir(dir)) != NULL) {
+        uint8_t name_len = strlen(ent->d_name);
+        uint32_t size;
+        FILE *f;
+
+        snprintf(path, sizeof(path), FS_BASE_PATH "/%s", ent->d_name);
+        if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) {
+            continue;
+        }
+        if (strchr(ent->d_name, '/') || name_len >= FS_PATH_MAX - sizeof(FS_BASE_PATH)) {
+            ESP_LOGW(TAG, "migration: skipping %s", ent->d_name);
+            continue;
+        }
+
+        f = fopen(path, "rb");
+        if (!f) {
+            err = ESP_FAIL;
+            break;
+        }
+        size = st.st_size;
+        err = stage->write(&name_len, 1);
+        if (err == ESP_OK) {
+            err = stage->write((const uint8_t *)ent->d_name, name_len);
+        }
+        if (err == ESP_OK) {
+            err = stage->write((const uint8_t *)&size, sizeof(size));
+        }
+        while (err == ESP_OK && size > 0) {
+            size_t n = fread(buf, 1, FS_MIGRATE_BUF_SIZE, f);
+            if (n == 0) {
+                err = ESP_FAIL;
+                break;
+            }
+            err = stage->write(buf, n);
+            size -= n;
+        }
+        fclose(f);
+        ESP_LOGI(TAG, "migration: packed %s, %ld bytes", ent->d_name, (long)st.st_size);
+    }
+
+    closedir(dir);
+    if (stage->write_end() != ESP_OK && err == ESP_OK) {
+        err = ESP_FAIL;
+    }
+    return err;
+}
+
+/* Recreate the files packed by fs_pack on the freshly mounted file system */
+static esp_err_t fs_unpack(const storage_backend_t *stage, uint8_t *buf) {
+    char path[FS_PATH_MAX];
+    uint32_t pos = 0;
+    int32_t total = stage->size(FS_MIGRATE_OBJ);
+
+    while (pos < total) {
+        uint8_t name_len;
+        char name[FS_PATH_MAX];
+        uint32_t size;
+        FILE *f;
+
+        if (stage->read(FS_MIGRATE_OBJ, pos, &name_len, 1) != 1 ||
+            stage->read(FS_MIGRATE_OBJ, pos + 1, (uint8_t *)name, name_len) != name_len ||
+            stage->read(FS_MIGRATE_OBJ, pos + 1 + name_len, (uint8_t *)&size,
+                        sizeof(size)) != sizeof(size)) {
+            return ESP_FAIL;
+        }
+        name[name_len] = '\0';
+        pos += 1 + name_len + sizeof(size);
+
+        snprintf(path, sizeof(path), FS_BASE_PATH "/%s", name);
+        f = fopen(path, "wb");
+        if (!f) {
+            return ESP_FAIL;
+        }
+        for (uint32_t left = size; left > 0;) {
+            int n = stage->read(FS_MIGRATE_OBJ, pos, buf,
+                                left < FS_MIGRATE_BUF_SIZE ? left : FS_MIGRATE_BUF_SIZE);
+            if (n <= 0 || fwrite(buf, 1, n, f) != (size_t)n) {
+                fclose(f);
+                return ESP_FAIL;
+            }
+            pos += n;
+            left -= n;
+        }
+        fclose(f);
+        ESP_LOGI(TAG, "migration: restored %s, %" PRIu32 " bytes", name, size);
+    }
+    return ESP_OK;
+}
+
+/* Move the contents of the mounted file system over to type */
+static esp_err_t fs_migrate(fs_type_t type) {
+    const storage_backend_t *stage = &storage_rawlog_backend;
+    uint8_t *buf;
+    esp_err_t err;
+
+    /* The raw log is not registered yet, initialize it for staging */
+    err = stage->init();
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "migration needs the raw log partition: %s",
+                 esp_err_to_name(err));
+        return err;
+    }
+    buf = malloc(FS_MIGRATE_BUF_SIZE);
+    if (!buf) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGW(TAG, "migrating %s to %s", fs_type_name(mounted_type),
+             fs_type_name(type));
+    err = fs_pack(stage, buf);
+    if (err == ESP_OK) {
+        fs_unmount();
+        err = fs_mount(type, true);
+    }
+    if (err == ESP_OK) {
+        err = fs_unpack(stage, buf);
+    }
+    if (err == ESP_OK) {
+        stage->remove(FS_MIGRATE_OBJ);
+    } else {
+        ESP_LOGE(TAG, "migration failed, staged files kept in %s on %s",
+                 FS_MIGRATE_OBJ, stage->name);
+    }
+
+    free(buf);
+    return err;
+}
+
+/* Public functions */
+esp_err_t fs_mount_init(void) {
+    fs_type_t type = fs_load_type();
+    fs_type_t other = type == FS_TYPE_SPIFFS ? FS_TYPE_LITTLEFS : FS_TYPE_SPIFFS;
+    esp_err_t err;
+
+    /* Expected file system already on the partition */
+    if (fs_mount(type, false) == ESP_OK) {
+        return ESP_OK;
+    }
+
+    /* Partition still holds the other one, migrate its files */
+    if (fs_mount(other, false) == ESP_OK) {
+        err = fs_migrate(type);
+        if (err == ESP_OK || mounted_type != FS_TYPE_NONE) {
+            return ESP_OK;
+        }
+    }
+
+    /* Blank or corrupted partition */
+    ESP_LOGW(TAG, "formatting %s as %s", FS_PARTITION_LABEL, fs_type_name(type));
+    return fs_mount(type, true);
+}
+
+/* Select the file system for the next boot */
+esp_err_t fs_mount_request(fs_type_t type) {
+    nvs_handle_t handle;
+    esp_err_t err;
+
+    if (type >= FS_TYPE_NONE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    err = nvs_open(FS_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = nvs_set_u8(handle, FS_NVS_KEY_TYPE, type);
+    if (err == ESP_OK) {
+        err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+    return err;
+}
+
+fs_type_t fs_mount_type(void) { return mounted_type; }
+
+const char *fs_type_name(fs_type_t type) {
+    switch (type) {
+    case FS_TYPE_SPIFFS:
+        return "spiffs";
+    case FS_TYPE_LITTLEFS:
+        return "littlefs";
+    default:
+        return "none";
+    }
+}
+
+uint32_t fs_mount_time_us(void) { return mount_time_us; }
+
+esp_err_t fs_mount_info(size_t *total, size_t *used) {
+    if (mounted_type == FS_TYPE_LITTLEFS) {
+        return esp_littlefs_info(FS_PARTITION_LABEL, total, used);
+    } else if (mounted_type == FS_TYPE_SPIFFS) {
+        return esp_spiffs_info(FS_PARTITION_LABEL, total, used);
+    }
+    return ESP_ERR_INVALID_STATE;
+}
@@ -7,8 +7,9 @@
 #include "gap.h"
 #include "common.h"
 #include "gatt_svc.h"
-
-extern void gatt_reset_file_buffer(void);
+#include "telemetry.h"
+#include "trace.h"
+#include "transfer.h"
 
 /* Private function declarations */
 inline static void format_addr(char *addr_str, uint8_t addr[]);
@@ -143,6 +144,7 @@ static int gap_event_handler(struct ble_gap_event *event, void *arg) {
     /* Connect event */
     case BLE_GAP_EVENT_CONNECT:
         /* A new connection was established or a connection attempt failed. */
+        TRACE(TRACE_CONNECT, event->connect.conn_handle, event->connect.status);
         ESP_LOGI(TAG, "connection %s; status=%d",
                  event->connect.status == 0 ? "established" : "failed",
                  event->connect.status);
@@ -150,7 +152,7 @@ static int gap_event_handler(struct ble_gap_event *event, void *arg) {
         /* Connection succeeded */
         if (event->connect.status == 0) {
             ESP_LOGI(TAG, "Connected, resetting file buffer");
-            gatt_reset_file_buffer(); // Clear on new connection
+            transfer_reset(); // Clear on new connection
 
             /* Check connection handle */
             rc = ble_gap_conn_find(event->connect.conn_handle, &desc);
@@ -164,6 +166,12 @@ static int gap_event_handler(struct ble_gap_event *event, void *arg) {
             /* Print connection descriptor */
             print_conn_desc(&desc);
 
+            /* Start a new telemetry session for this link */
+            uint8_t tx_phy = 0, rx_phy = 0;
+            ble_gap_read_le_phy(event->connect.conn_handle, &tx_phy, &rx_phy);
+            telemetry_session_begin();
+            telemetry_link(BLE_ATT_MTU_DFLT, desc.conn_itvl, tx_phy, rx_phy);
+
             /* Try to update connection parameters */
             struct ble_gap_upd_params params = {.itvl_min = desc.conn_itvl,
                                                 .itvl_max = desc.conn_itvl,
@@ -187,10 +195,14 @@ static int gap_event_handler(struct ble_gap_event *event, void *arg) {
 
     /* Disconnect event */
     case BLE_GAP_EVENT_DISCONNECT:
+        TRACE(TRACE_DISCONNECT, event->disconnect.reason, 0);
         /* A connection was terminated, print connection descriptor */
         ESP_LOGI(TAG, "disconnected from peer; reason=%d",
                  event->disconnect.reason);
 
+        /* Commit any upload left open by the peer */
+        transfer_finish_upload();
+
         /* Restart advertising */
         start_advertising();
         return rc;
@@ -209,6 +221,8 @@ static int gap_event_handler(struct ble_gap_event *event, void *arg) {
             return rc;
         }
         print_conn_desc(&desc);
+        telemetry_link(0, desc.conn_itvl, 0, 0);
+        TRACE(TRACE_CONN_UPDATE, desc.conn_itvl, desc.conn_latency);
         return rc;
 
     /* Advertising complete event */
@@ -230,6 +244,9 @@ static int gap_event_handler(struct ble_gap_event *event, void *arg) {
                      event->notify_tx.conn_handle, event->notify_tx.attr_handle,
                      event->notify_tx.status, event->notify_tx.indication);
         }
+
+        /* Keep the download stream going */
+        gatt_svr_notify_tx_cb(event);
         return rc;
 
     /* Subscribe event */
@@ -253,6 +270,20 @@ static int gap_event_handler(struct ble_gap_event *event, void *arg) {
         ESP_LOGI(TAG, "mtu update event; conn_handle=%d cid=%d mtu=%d",
                  event->mtu.conn_handle, event->mtu.channel_id,
                  event->mtu.value);
+        telemetry_link(event->mtu.value, 0, 0, 0);
+        TRACE(TRACE_MTU, event->mtu.value, 0);
+        return rc;
+
+    /* PHY update event */
+    case BLE_GAP_EVENT_PHY_UPDATE_COMPLETE:
+        ESP_LOGI(TAG, "phy update event; status=%d tx_phy=%d rx_phy=%d",
+                 event->phy_updated.status, event->phy_updated.tx_phy,
+                 event->phy_updated.rx_phy);
+        TRACE(TRACE_PHY, event->phy_updated.tx_phy, event->phy_updated.rx_phy);
+        if (event->phy_updated.status == 0) {
+            telemetry_link(0, 0, event->phy_updated.tx_phy,
+                           event->phy_updated.rx_phy);
+        }
         return rc;
     }
 
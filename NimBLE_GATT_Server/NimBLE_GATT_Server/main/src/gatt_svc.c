@@ -7,27 +7,123 @@
 #include "gatt_svc.h"
 #include "common.h"
 #include "led.h"
+#include "fs_maint.h"
+#include "fs_mount.h"
+#include "part_src.h"
+#include "storage.h"
+#include "storage_bench.h"
+#include "sys_stats.h"
+#include "telemetry.h"
+#include "trace.h"
+#include "transfer.h"
+#include "upload_writer.h"
 #include <inttypes.h>
+#include <stdlib.h>
+#include <sys/param.h>
+#include "esp_app_desc.h"
 #include "esp_ota_ops.h"
 #include "esp_system.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 
-#define FILE_BUF_SIZE (200 * 1024)
-#define SEND_BUFFER 517
-static uint32_t file_read_offset = 0;
-static uint16_t file_offset_chr_val_handle;
-static esp_ota_handle_t ota_handle = 0;
-static const esp_partition_t *ota_partition = NULL;
-static bool is_ota_active = false;
-static bool first_chunk = true;
+#define CTRL_CMD_MAX_LEN 64
+#define CTRL_RSP_MAX_LEN 256
+#define TELEMETRY_NOTIFY_PERIOD_US (1000 * 1000)
+#define STREAM_WINDOW 4
+#define STREAM_RETRY_MS 5
+
+/* Control characteristic */
+typedef int (*ctrl_cmd_fn_t)(const char *args);
+
+typedef struct {
+    const char *name;
+    ctrl_cmd_fn_t fn;
+} ctrl_cmd_t;
+
+static char ctrl_rsp[CTRL_RSP_MAX_LEN] = "OK";
 
 /* Private function declarations */
 static int led_chr_access(uint16_t conn_handle, uint16_t attr_handle,
                           struct ble_gatt_access_ctxt *ctxt, void *arg);
+static int ctrl_cmd_dump(const char *args);
+static int ctrl_cmd_file(const char *args);
+static int ctrl_cmd_end(const char *args);
+static int ctrl_cmd_store(const char *args);
+static int ctrl_cmd_bench(const char *args);
+static int ctrl_cmd_fs(const char *args);
+static int ctrl_cmd_gc(const char *args);
+static int ctrl_cmd_trace(const char *args);
+static int ctrl_cmd_lat(const char *args);
+static int ctrl_cmd_info(const char *args);
+static int ctrl_cmd_stream(const char *args);
 
 /* Private variables */
 static uint16_t led_chr_val_handle;
 static uint16_t file_rw_chr_val_handle;
+static uint16_t file_offset_chr_val_handle;
+static uint16_t ctrl_chr_val_handle;
+static uint16_t telemetry_chr_val_handle;
+static uint16_t stats_chr_val_handle;
+
+/* Stats sample being read, taken on the first (offset 0) read */
+static sys_stats_t stats_read;
+static size_t stats_read_len = 0;
+
+/* Telemetry is notified periodically while a peer is subscribed */
+static uint16_t telemetry_conn_handle = BLE_HS_CONN_HANDLE_NONE;
+static esp_timer_handle_t telemetry_timer = NULL;
+
+/*
+ * file_rw notification stream, driven from the host task. NimBLE raises
+ * NOTIFY_TX from inside ble_gatts_notify_custom, so the event only posts
+ * stream_ev; each run of it queues up to STREAM_WINDOW notifications, and
+ * stream_retry polls again when the stack is out of buffers.
+ */
+static uint16_t stream_conn_handle = BLE_HS_CONN_HANDLE_NONE;
+static uint32_t stream_pos = 0;
+static uint32_t stream_end = 0;
+static int stream_inflight = 0;
+static bool stream_pumping = false;
+static struct ble_npl_event stream_ev;
+static struct ble_npl_callout stream_retry;
+
+/*
+ * Control commands, written to ctrl_chr as "<NAME> [args]"
+ *      - DUMP <label>  serve file_rw_chr reads from an app, spiffs or rawlog
+ *                      partition, replies with its size and CRC-32
+ *      - FILE          serve file_rw_chr reads from upload.txt again,
+ *                      replies with its size and CRC-32
+ *      - END           commit the upload once every chunk is in storage,
+ *                      replies with the stored size and CRC-32 or the
+ *                      first write error
+ *      - STORE [name]  select the storage backend for the next upload
+ *      - BENCH [kb]    start a storage benchmark, or poll its result
+ *      - FS [type]     report the file system, or switch to spiffs or
+ *                      littlefs, migrating files on the reboot that follows
+ *      - GC            report background SPIFFS GC and write stall stats
+ *      - TRACE [PRINT] serve a snapshot of the binary trace ring from
+ *                      file_rw_chr, or decode it to the console
+ *      - LAT           serve per-chunk upload stage timestamps as CSV
+ *                      from file_rw_chr
+ *      - INFO          report the running partition, app version and
+ *                      image SHA-256, used to group devices for OTA
+ *      - STREAM [off]  notify the selected source from off to the end on
+ *                      file_rw_chr, which the peer must subscribe to first
+ * The result of the last command can be read back from ctrl_chr.
+ */
+static const ctrl_cmd_t ctrl_cmds[] = {
+    {"DUMP", ctrl_cmd_dump},
+    {"FILE", ctrl_cmd_file},
+    {"END", ctrl_cmd_end},
+    {"STORE", ctrl_cmd_store},
+    {"BENCH", ctrl_cmd_bench},
+    {"FS", ctrl_cmd_fs},
+    {"GC", ctrl_cmd_gc},
+    {"TRACE", ctrl_cmd_trace},
+    {"LAT", ctrl_cmd_lat},
+    {"INFO", ctrl_cmd_info},
+    {"STREAM", ctrl_cmd_stream},
+};
 
 static const ble_uuid16_t auto_io_svc_uuid = BLE_UUID16_INIT(0x1815);
 static const ble_uuid128_t led_chr_uuid =
@@ -39,75 +135,15 @@ static const ble_uuid128_t file_rw_chr_uuid =
 static const ble_uuid128_t file_offset_chr_uuid =
     BLE_UUID128_INIT(0x23, 0xd1, 0xbc, 0xea, 0x5f, 0x78, 0x23, 0x15,
                      0xde, 0xef, 0x12, 0x12, 0x27, 0x15, 0x00, 0x00);
-
-/* Helper functions */
-void gatt_complete_ota(void)
-{
-    if (is_ota_active)
-    {
-        esp_err_t err = esp_ota_end(ota_handle);
-        if (err != ESP_OK)
-        {
-            ESP_LOGE(TAG, "esp_ota_end failed: %s", esp_err_to_name(err));
-            return;
-        }
-
-        err = esp_ota_set_boot_partition(ota_partition);
-        if (err != ESP_OK)
-        {
-            ESP_LOGE(TAG, "esp_ota_set_boot_partition failed: %s", esp_err_to_name(err));
-            return;
-        }
-
-        ESP_LOGI(TAG, "OTA complete. Rebooting...");
-        vTaskDelay(1000 / portTICK_PERIOD_MS);
-        esp_restart();
-    }
-}
-
-
-void gatt_reset_file_buffer(void)
-{
-    // Reset state
-    is_ota_active = false;
-    first_chunk = true; 
-    if (ota_handle) {
-        esp_ota_end(ota_handle);
-        ota_handle = 0;
-    }
-    // Check extension
-    const char *ota_path = "/spiffs/upload.bin";
-    const char *ext = strrchr(ota_path, '.');
-
-    if (ext && strcmp(ext, ".bin") == 0)
-    {
-        ota_partition = esp_ota_get_next_update_partition(NULL);
-        if (!ota_partition)
-        {
-            ESP_LOGE(TAG, "Failed to get OTA partition");
-            return;
-        }
-
-        esp_err_t err = esp_ota_begin(ota_partition, OTA_SIZE_UNKNOWN, &ota_handle);
-        if (err != ESP_OK)
-        {
-            ESP_LOGE(TAG, "esp_ota_begin failed: %s", esp_err_to_name(err));
-            return;
-        }
-
-        is_ota_active = true;
-        ESP_LOGI(TAG, "OTA upload started to partition: %s", ota_partition->label);
-    }
-    else
-    {
-        FILE *f = fopen("/spiffs/upload.txt", "w");
-        if (f)
-        {
-            fclose(f);
-            ESP_LOGI(TAG, "File reset (truncated)");
-        }
-    }
-}
+static const ble_uuid128_t ctrl_chr_uuid =
+    BLE_UUID128_INIT(0x23, 0xd1, 0xbc, 0xea, 0x5f, 0x78, 0x23, 0x15,
+                     0xde, 0xef, 0x12, 0x12, 0x28, 0x15, 0x00, 0x00);
+static const ble_uuid128_t telemetry_chr_uuid =
+    BLE_UUID128_INIT(0x23, 0xd1, 0xbc, 0xea, 0x5f, 0x78, 0x23, 0x15,
+                     0xde, 0xef, 0x12, 0x12, 0x29, 0x15, 0x00, 0x00);
+static const ble_uuid128_t stats_chr_uuid =
+    BLE_UUID128_INIT(0x23, 0xd1, 0xbc, 0xea, 0x5f, 0x78, 0x23, 0x15,
+                     0xde, 0xef, 0x12, 0x12, 0x2a, 0x15, 0x00, 0x00);
 
 /* Private functions */
 static int led_chr_access(uint16_t conn_handle, uint16_t attr_handle,
@@ -176,125 +212,446 @@ error:
 static int file_rw_chr_access(uint16_t conn_handle, uint16_t attr_handle,
                               struct ble_gatt_access_ctxt *ctxt, void *arg)
 {
+    fs_maint_activity();
+
     switch (ctxt->op)
     {
     case BLE_GATT_ACCESS_OP_WRITE_CHR:
+        return transfer_write(ctxt->om, (uint32_t)esp_timer_get_time());
+
+    case BLE_GATT_ACCESS_OP_READ_CHR:
     {
-        size_t len = OS_MBUF_PKTLEN(ctxt->om);
+        uint16_t mtu = ble_att_mtu(conn_handle);
+        if (mtu == 0)
+        {
+            mtu = BLE_ATT_MTU_DFLT;
+        }
+        return transfer_read(ctxt->om, ctxt->offset, mtu);
+    }
 
-        // Convert incoming BLE data to a flat buffer
-        uint8_t temp_buf[SEND_BUFFER]; // enough for each BLE chunk
-        if (len > sizeof(temp_buf)) {
-            return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+    default:
+        return BLE_ATT_ERR_UNLIKELY;
+    }
+}
+static int file_offset_chr_access(uint16_t conn_handle, uint16_t attr_handle,
+                                  struct ble_gatt_access_ctxt *ctxt, void *arg)
+{
+    fs_maint_activity();
+
+    if (ctxt->op != BLE_GATT_ACCESS_OP_WRITE_CHR)
+        return BLE_ATT_ERR_UNLIKELY;
+
+    if (ctxt->om->om_len < 4)
+        return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+
+    uint32_t offset;
+    int rc = ble_hs_mbuf_to_flat(ctxt->om, &offset, sizeof(offset), NULL);
+    if (rc != 0)
+        return BLE_ATT_ERR_UNLIKELY;
+
+    transfer_set_offset(offset);
+    return 0;
+}
+
+static void stream_stop(void)
+{
+    if (stream_pos < stream_end)
+    {
+        ESP_LOGI(TAG, "stream stopped at %" PRIu32 " of %" PRIu32, stream_pos,
+                 stream_end);
+    }
+    stream_pos = stream_end = 0;
+}
+
+static void stream_pump(void)
+{
+    uint16_t mtu = ble_att_mtu(stream_conn_handle);
+    if (mtu == 0)
+    {
+        mtu = BLE_ATT_MTU_DFLT;
+    }
+
+    /* A NOTIFY_TX raised by our own notify must not send again */
+    if (stream_pumping)
+    {
+        return;
+    }
+    stream_pumping = true;
+
+    while (stream_inflight < STREAM_WINDOW && stream_pos < stream_end)
+    {
+        struct os_mbuf *om = ble_hs_mbuf_att_pkt();
+        if (!om)
+        {
+            ble_npl_callout_reset(&stream_retry,
+                                  ble_npl_time_ms_to_ticks32(STREAM_RETRY_MS));
+            break;
         }
 
-        int rc = ble_hs_mbuf_to_flat(ctxt->om, temp_buf, len, NULL);
-        if (rc != 0) {
-            return BLE_ATT_ERR_UNLIKELY;
+        int n = transfer_read_at(om, stream_pos,
+                                 MIN(mtu - 3, stream_end - stream_pos));
+        if (n <= 0)
+        {
+            os_mbuf_free_chain(om);
+            stream_stop();
+            break;
         }
 
-        // Only check for OTA on the first chunk
-        if (first_chunk) {
-            first_chunk = false;
+        /* Accounted before the notify, whose NOTIFY_TX arrives inside it */
+        stream_pos += n;
+        stream_inflight++;
 
-            if (temp_buf[0] == 0xE9) {
-                ESP_LOGI(TAG, "Detected OTA image by magic byte");
+        /* The stack owns om from here on, even when the notify fails */
+        if (ble_gatts_notify_custom(stream_conn_handle, file_rw_chr_val_handle,
+                                    om) != 0)
+        {
+            stream_stop();
+            break;
+        }
+    }
 
-                ota_partition = esp_ota_get_next_update_partition(NULL);
-                if (!ota_partition) {
-                    ESP_LOGE(TAG, "Failed to get OTA partition");
-                    return BLE_ATT_ERR_UNLIKELY;
-                }
+    stream_pumping = false;
+}
 
-                esp_err_t err = esp_ota_begin(ota_partition, OTA_SIZE_UNKNOWN, &ota_handle);
-                if (err != ESP_OK) {
-                    ESP_LOGE(TAG, "esp_ota_begin failed: %s", esp_err_to_name(err));
-                    return BLE_ATT_ERR_UNLIKELY;
-                }
+/* Runs on the host task once the current event has returned */
+static void stream_resume(struct ble_npl_event *ev)
+{
+    stream_inflight = 0;
+    stream_pump();
+}
 
-                is_ota_active = true;
-                ESP_LOGI(TAG, "OTA upload started to partition: %s", ota_partition->label);
-            } else {
-                ESP_LOGI(TAG, "Not OTA image, defaulting to file write mode");
-        
-                FILE *f = fopen("/spiffs/upload.txt", "w");
-                if (f) {
-                    fclose(f);
-                    ESP_LOGI(TAG, "Created upload.txt for writing");
-                } else {
-                    ESP_LOGE(TAG, "Failed to create upload.txt");
-                    return BLE_ATT_ERR_UNLIKELY;
-                }
-                is_ota_active = false;
-            }
-        }
+static int ctrl_cmd_dump(const char *args)
+{
+    uint32_t size, crc;
 
-        if (is_ota_active && ota_handle != 0) {
-            if (len == 7 && memcmp(temp_buf, "OTA_END", 7) == 0) {
-                ESP_LOGI(TAG, "Received OTA_END signal from client");
-                gatt_complete_ota();  // reboot and finish
-                return 0;
-            }
-        
-            rc = esp_ota_write(ota_handle, temp_buf, len);
-            if (rc != ESP_OK) {
-                ESP_LOGE(TAG, "esp_ota_write failed: %s", esp_err_to_name(rc));
-                return BLE_ATT_ERR_UNLIKELY;
-            }
-        
-            ESP_LOGI(TAG, "OTA chunk written: %zu bytes", len);
-        } else {
-            FILE *f = fopen("/spiffs/upload.txt", "ab");
-            if (!f) {
-                ESP_LOGE(TAG, "Failed to open file for writing");
-                return BLE_ATT_ERR_UNLIKELY;
-            }
+    esp_err_t err = transfer_source_partition(args);
+    if (err == ESP_ERR_NOT_ALLOWED)
+    {
+        snprintf(ctrl_rsp, sizeof(ctrl_rsp), "ERR not allowed %s", args);
+        return BLE_ATT_ERR_VALUE_NOT_ALLOWED;
+    }
+    if (err != ESP_OK)
+    {
+        snprintf(ctrl_rsp, sizeof(ctrl_rsp), "ERR no partition %s", args);
+        return BLE_ATT_ERR_VALUE_NOT_ALLOWED;
+    }
+    if (transfer_source_info(&size, &crc) != ESP_OK)
+    {
+        snprintf(ctrl_rsp, sizeof(ctrl_rsp), "ERR reading %s", args);
+        return BLE_ATT_ERR_UNLIKELY;
+    }
 
-            size_t written = fwrite(temp_buf, 1, len, f);
-            fclose(f);
+    stream_stop();
+    snprintf(ctrl_rsp, sizeof(ctrl_rsp), "OK %s %" PRIu32 " %08" PRIx32,
+             part_src_label(), size, crc);
+    return 0;
+}
 
-            if (written != len) {
-                ESP_LOGE(TAG, "Failed to write all data to file");
-                return BLE_ATT_ERR_UNLIKELY;
-            }
+static int ctrl_cmd_file(const char *args)
+{
+    uint32_t size, crc;
 
-            ESP_LOGI(TAG, "Wrote %zu bytes to file", len);
-        }
+    transfer_source_file();
+    if (transfer_source_info(&size, &crc) != ESP_OK)
+    {
+        snprintf(ctrl_rsp, sizeof(ctrl_rsp), "ERR reading %s",
+                 STORAGE_UPLOAD_OBJ);
+        return BLE_ATT_ERR_UNLIKELY;
+    }
+
+    stream_stop();
+    snprintf(ctrl_rsp, sizeof(ctrl_rsp), "OK %s %" PRIu32 " %08" PRIx32,
+             STORAGE_UPLOAD_OBJ, size, crc);
+    return 0;
+}
 
+static int ctrl_cmd_end(const char *args)
+{
+    uint32_t size, crc;
+    esp_err_t err = transfer_end_upload(&size, &crc);
+
+    if (err == ESP_ERR_INVALID_STATE)
+    {
+        snprintf(ctrl_rsp, sizeof(ctrl_rsp), "ERR no upload");
+        return BLE_ATT_ERR_VALUE_NOT_ALLOWED;
+    }
+    if (err != ESP_OK)
+    {
+        snprintf(ctrl_rsp, sizeof(ctrl_rsp), "ERR writing %s: %s",
+                 STORAGE_UPLOAD_OBJ, esp_err_to_name(err));
+        return BLE_ATT_ERR_UNLIKELY;
+    }
+
+    snprintf(ctrl_rsp, sizeof(ctrl_rsp), "OK %s %" PRIu32 " %08" PRIx32,
+             STORAGE_UPLOAD_OBJ, size, crc);
+    return 0;
+}
+
+static int ctrl_cmd_store(const char *args)
+{
+    if (*args != '\0' && storage_select(args) != ESP_OK)
+    {
+        snprintf(ctrl_rsp, sizeof(ctrl_rsp), "ERR no backend %s", args);
+        return BLE_ATT_ERR_VALUE_NOT_ALLOWED;
+    }
+
+    transfer_invalidate();
+    snprintf(ctrl_rsp, sizeof(ctrl_rsp), "OK %s", storage_get()->name);
+    return 0;
+}
+
+static int ctrl_cmd_bench(const char *args)
+{
+    /* Without arguments, report the state of the last run */
+    if (*args == '\0' && (storage_bench_running() ||
+                          strcmp(storage_bench_result(), "IDLE") != 0))
+    {
+        snprintf(ctrl_rsp, sizeof(ctrl_rsp), "%s", storage_bench_result());
         return 0;
     }
 
-    case BLE_GATT_ACCESS_OP_READ_CHR:
+    if (upload_writer_backend())
+    {
+        snprintf(ctrl_rsp, sizeof(ctrl_rsp), "ERR upload open");
+        return BLE_ATT_ERR_VALUE_NOT_ALLOWED;
+    }
+
+    if (storage_bench_start(strtoul(args, NULL, 10)) != ESP_OK)
+    {
+        snprintf(ctrl_rsp, sizeof(ctrl_rsp), "ERR bench busy");
+        return BLE_ATT_ERR_VALUE_NOT_ALLOWED;
+    }
+
+    snprintf(ctrl_rsp, sizeof(ctrl_rsp), "OK RUNNING");
+    return 0;
+}
+
+static void ctrl_restart_cb(void *arg)
+{
+    esp_restart();
+}
+
+static int ctrl_cmd_fs(const char *args)
+{
+    static esp_timer_handle_t restart_timer;
+    fs_type_t type;
+
+    if (strcmp(args, fs_type_name(FS_TYPE_SPIFFS)) == 0)
     {
-        FILE *f = fopen("/spiffs/upload.txt", "rb");
-        if (!f)
+        type = FS_TYPE_SPIFFS;
+    }
+    else if (strcmp(args, fs_type_name(FS_TYPE_LITTLEFS)) == 0)
+    {
+        type = FS_TYPE_LITTLEFS;
+    }
+    else if (*args == '\0')
+    {
+        snprintf(ctrl_rsp, sizeof(ctrl_rsp), "OK %s",
+                 fs_type_name(fs_mount_type()));
+        return 0;
+    }
+    else
+    {
+        snprintf(ctrl_rsp, sizeof(ctrl_rsp), "ERR unknown fs %s", args);
+        return BLE_ATT_ERR_VALUE_NOT_ALLOWED;
+    }
+
+    if (type == fs_mount_type())
+    {
+        snprintf(ctrl_rsp, sizeof(ctrl_rsp), "OK %s", args);
+        return 0;
+    }
+
+    if (fs_mount_request(type) != ESP_OK)
+    {
+        snprintf(ctrl_rsp, sizeof(ctrl_rsp), "ERR saving file system type");
+        return BLE_ATT_ERR_UNLIKELY;
+    }
+
+    /* Let the write response go out before rebooting into the migration */
+    transfer_finish_upload();
+    if (!restart_timer)
+    {
+        const esp_timer_create_args_t timer_args = {
+            .callback = ctrl_restart_cb,
+            .name = "fs_restart",
+        };
+        esp_timer_create(&timer_args, &restart_timer);
+    }
+    esp_timer_start_once(restart_timer, 500 * 1000);
+
+    snprintf(ctrl_rsp, sizeof(ctrl_rsp), "OK rebooting to %s", args);
+    return 0;
+}
+
+static int ctrl_cmd_gc(const char *args)
+{
+    fs_maint_stats_t stats;
+
+    fs_maint_get_stats(&stats);
+    snprintf(ctrl_rsp, sizeof(ctrl_rsp),
+             "runs=%" PRIu32 " slices=%" PRIu32 " gc_ms=%" PRIu32
+             " gc_max_us=%" PRIu32 " clean_kb=%" PRIu32 " stalls=%" PRIu32
+             " write_max_us=%" PRIu32,
+             stats.gc_runs, stats.gc_slices, stats.gc_time_ms, stats.gc_max_us,
+             stats.clean_kb, stats.write_stalls, stats.write_max_us);
+    return 0;
+}
+
+static int ctrl_cmd_trace(const char *args)
+{
+    if (strcmp(args, "PRINT") == 0)
+    {
+        if (trace_print_async() != ESP_OK)
         {
-            ESP_LOGE(TAG, "Failed to open file for reading");
+            snprintf(ctrl_rsp, sizeof(ctrl_rsp), "ERR busy");
             return BLE_ATT_ERR_UNLIKELY;
         }
+        snprintf(ctrl_rsp, sizeof(ctrl_rsp), "OK");
+        return 0;
+    }
+
+    /* Freeze the ring so the dump is not overwritten while it is read */
+    trace_entry_t *dump = malloc(TRACE_ENTRIES * sizeof(trace_entry_t));
+    if (!dump)
+    {
+        snprintf(ctrl_rsp, sizeof(ctrl_rsp), "ERR no memory");
+        return BLE_ATT_ERR_INSUFFICIENT_RES;
+    }
+    size_t count = trace_snapshot(dump, TRACE_ENTRIES);
+
+    transfer_source_memory(dump, count * sizeof(trace_entry_t));
+    snprintf(ctrl_rsp, sizeof(ctrl_rsp), "OK %u %u", (unsigned)count,
+             (unsigned)sizeof(trace_entry_t));
+    return 0;
+}
+
+static int ctrl_cmd_lat(const char *args)
+{
+    /* Header plus one line of at most 9 numbers per chunk */
+    size_t size = 64 + UPLOAD_LAT_CHUNKS * 96;
+    char *csv = malloc(size);
+    if (!csv)
+    {
+        snprintf(ctrl_rsp, sizeof(ctrl_rsp), "ERR no memory");
+        return BLE_ATT_ERR_INSUFFICIENT_RES;
+    }
 
-        if (fseek(f, file_read_offset, SEEK_SET) != 0)
+    size_t len = upload_writer_csv(csv, size);
+    transfer_source_memory(csv, len);
+    snprintf(ctrl_rsp, sizeof(ctrl_rsp), "OK %u", (unsigned)len);
+    return 0;
+}
+
+static int ctrl_cmd_info(const char *args)
+{
+    const esp_partition_t *running = esp_ota_get_running_partition();
+    uint8_t sha[32];
+    char hex[sizeof(sha) * 2 + 1];
+
+    /*
+     * The SHA-256 esptool appends to the image: it covers the .bin without
+     * its last 32 bytes, which are the digest itself
+     */
+    if (esp_partition_get_sha256(running, sha) != ESP_OK)
+    {
+        snprintf(ctrl_rsp, sizeof(ctrl_rsp), "ERR no image hash");
+        return BLE_ATT_ERR_UNLIKELY;
+    }
+    for (size_t i = 0; i < sizeof(sha); i++)
+    {
+        snprintf(hex + i * 2, 3, "%02x", sha[i]);
+    }
+
+    snprintf(ctrl_rsp, sizeof(ctrl_rsp), "OK %s %s %s", running->label,
+             esp_app_get_description()->version, hex);
+    return 0;
+}
+
+static int ctrl_cmd_stream(const char *args)
+{
+    uint32_t size;
+
+    if (stream_conn_handle == BLE_HS_CONN_HANDLE_NONE)
+    {
+        snprintf(ctrl_rsp, sizeof(ctrl_rsp), "ERR not subscribed");
+        return BLE_ATT_ERR_VALUE_NOT_ALLOWED;
+    }
+
+    if (transfer_source_info(&size, NULL) != ESP_OK)
+    {
+        snprintf(ctrl_rsp, sizeof(ctrl_rsp), "ERR reading source");
+        return BLE_ATT_ERR_UNLIKELY;
+    }
+
+    stream_pos = MIN(strtoul(args, NULL, 10), size);
+    stream_end = size;
+    snprintf(ctrl_rsp, sizeof(ctrl_rsp), "OK %" PRIu32 " %" PRIu32, stream_pos,
+             stream_end);
+
+    /* The first packets can reach the peer before this write response */
+    stream_inflight = 0;
+    stream_pump();
+    return 0;
+}
+
+static int ctrl_chr_access(uint16_t conn_handle, uint16_t attr_handle,
+                           struct ble_gatt_access_ctxt *ctxt, void *arg)
+{
+    switch (ctxt->op)
+    {
+    case BLE_GATT_ACCESS_OP_WRITE_CHR:
+    {
+        char cmd[CTRL_CMD_MAX_LEN + 1];
+        uint16_t len;
+
+        if (OS_MBUF_PKTLEN(ctxt->om) > CTRL_CMD_MAX_LEN)
+        {
+            return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+        }
+        if (ble_hs_mbuf_to_flat(ctxt->om, cmd, CTRL_CMD_MAX_LEN, &len) != 0)
         {
-            ESP_LOGE(TAG, "Failed to seek to offset %" PRIu32, file_read_offset);
-            fclose(f);
             return BLE_ATT_ERR_UNLIKELY;
         }
+        cmd[len] = '\0';
 
-        uint8_t read_buf[500];
-        size_t len = fread(read_buf, 1, sizeof(read_buf), f);
-        fclose(f);
+        /* Split "<NAME> [args]" */
+        char *args = strchr(cmd, ' ');
+        if (args)
+        {
+            *args++ = '\0';
+        }
+        else
+        {
+            args = cmd + len;
+        }
 
-        if (len == 0)
+        for (size_t i = 0; i < sizeof(ctrl_cmds) / sizeof(ctrl_cmds[0]); i++)
         {
-            ESP_LOGI(TAG, "EOF reached");
-            return 0;
-        }        
+            if (strcmp(cmd, ctrl_cmds[i].name) == 0)
+            {
+                ESP_LOGI(TAG, "control command: %s %s", cmd, args);
+                return ctrl_cmds[i].fn(args);
+            }
+        }
+
+        snprintf(ctrl_rsp, sizeof(ctrl_rsp), "ERR unknown command %s", cmd);
+        return BLE_ATT_ERR_VALUE_NOT_ALLOWED;
+    }
 
-        if (os_mbuf_append(ctxt->om, read_buf, len) != 0)
+    case BLE_GATT_ACCESS_OP_READ_CHR:
+    {
+        /* Long responses are fetched with Read Blob */
+        size_t len = strlen(ctrl_rsp);
+        if (ctxt->offset > len)
+        {
+            return BLE_ATT_ERR_INVALID_OFFSET;
+        }
+        if (os_mbuf_append(ctxt->om, ctrl_rsp + ctxt->offset,
+                           len - ctxt->offset) != 0)
         {
             return BLE_ATT_ERR_INSUFFICIENT_RES;
         }
-
         return 0;
     }
 
@@ -302,22 +659,95 @@ static int file_rw_chr_access(uint16_t conn_handle, uint16_t attr_handle,
         return BLE_ATT_ERR_UNLIKELY;
     }
 }
-static int file_offset_chr_access(uint16_t conn_handle, uint16_t attr_handle,
-                                  struct ble_gatt_access_ctxt *ctxt, void *arg)
+
+static int telemetry_chr_access(uint16_t conn_handle, uint16_t attr_handle,
+                                struct ble_gatt_access_ctxt *ctxt, void *arg)
 {
-    if (ctxt->op != BLE_GATT_ACCESS_OP_WRITE_CHR)
+    telemetry_t snap;
+
+    if (ctxt->op != BLE_GATT_ACCESS_OP_READ_CHR)
+    {
         return BLE_ATT_ERR_UNLIKELY;
+    }
 
-    if (ctxt->om->om_len < 4)
-        return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+    telemetry_snapshot(&snap);
+    if (ctxt->offset > sizeof(snap))
+    {
+        return BLE_ATT_ERR_INVALID_OFFSET;
+    }
+    if (os_mbuf_append(ctxt->om, (uint8_t *)&snap + ctxt->offset,
+                       sizeof(snap) - ctxt->offset) != 0)
+    {
+        return BLE_ATT_ERR_INSUFFICIENT_RES;
+    }
+    return 0;
+}
 
-    uint32_t offset;
-    int rc = ble_hs_mbuf_to_flat(ctxt->om, &offset, sizeof(offset), NULL);
-    if (rc != 0)
+static void telemetry_notify_cb(void *arg)
+{
+    telemetry_t snap;
+    struct os_mbuf *om;
+
+    if (telemetry_conn_handle == BLE_HS_CONN_HANDLE_NONE)
+    {
+        return;
+    }
+
+    /* Notifications are cut to MTU - 3, read the rest with Read Blob */
+    telemetry_snapshot(&snap);
+    om = ble_hs_mbuf_from_flat(&snap, sizeof(snap));
+    if (om && ble_gatts_notify_custom(telemetry_conn_handle,
+                                      telemetry_chr_val_handle, om) != 0)
+    {
+        ESP_LOGD(TAG, "telemetry notify failed");
+    }
+}
+
+static void telemetry_subscribe(uint16_t conn_handle, bool notify)
+{
+    if (!telemetry_timer)
+    {
+        const esp_timer_create_args_t timer_args = {
+            .callback = telemetry_notify_cb,
+            .name = "telemetry",
+        };
+        if (esp_timer_create(&timer_args, &telemetry_timer) != ESP_OK)
+        {
+            ESP_LOGE(TAG, "failed to create telemetry timer");
+            return;
+        }
+    }
+
+    esp_timer_stop(telemetry_timer);
+    telemetry_conn_handle = notify ? conn_handle : BLE_HS_CONN_HANDLE_NONE;
+    if (notify)
+    {
+        esp_timer_start_periodic(telemetry_timer, TELEMETRY_NOTIFY_PERIOD_US);
+    }
+}
+
+static int stats_chr_access(uint16_t conn_handle, uint16_t attr_handle,
+                            struct ble_gatt_access_ctxt *ctxt, void *arg)
+{
+    if (ctxt->op != BLE_GATT_ACCESS_OP_READ_CHR)
+    {
         return BLE_ATT_ERR_UNLIKELY;
+    }
 
-    file_read_offset = offset;
-    ESP_LOGI(TAG, "Set read offset to %" PRIu32, file_read_offset);
+    /* Read Blob continues from the same sample so the value is not torn */
+    if (ctxt->offset == 0)
+    {
+        stats_read_len = sys_stats_get(&stats_read);
+    }
+    if (ctxt->offset > stats_read_len)
+    {
+        return BLE_ATT_ERR_INVALID_OFFSET;
+    }
+    if (os_mbuf_append(ctxt->om, (uint8_t *)&stats_read + ctxt->offset,
+                       stats_read_len - ctxt->offset) != 0)
+    {
+        return BLE_ATT_ERR_INSUFFICIENT_RES;
+    }
     return 0;
 }
 
@@ -336,7 +766,8 @@ static const struct ble_gatt_svc_def gatt_svr_svcs[] = {
              .uuid = &file_rw_chr_uuid.u,
              .access_cb = file_rw_chr_access,
              .val_handle = &file_rw_chr_val_handle,
-             .flags = BLE_GATT_CHR_F_WRITE | BLE_GATT_CHR_F_READ,
+             .flags = BLE_GATT_CHR_F_WRITE | BLE_GATT_CHR_F_WRITE_NO_RSP |
+                      BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_NOTIFY,
          },
          {
              .uuid = &file_offset_chr_uuid.u,
@@ -344,6 +775,24 @@ static const struct ble_gatt_svc_def gatt_svr_svcs[] = {
              .val_handle = &file_offset_chr_val_handle,
              .flags = BLE_GATT_CHR_F_WRITE,
          },
+         {
+             .uuid = &ctrl_chr_uuid.u,
+             .access_cb = ctrl_chr_access,
+             .val_handle = &ctrl_chr_val_handle,
+             .flags = BLE_GATT_CHR_F_WRITE | BLE_GATT_CHR_F_READ,
+         },
+         {
+             .uuid = &telemetry_chr_uuid.u,
+             .access_cb = telemetry_chr_access,
+             .val_handle = &telemetry_chr_val_handle,
+             .flags = BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_NOTIFY,
+         },
+         {
+             .uuid = &stats_chr_uuid.u,
+             .access_cb = stats_chr_access,
+             .val_handle = &stats_chr_val_handle,
+             .flags = BLE_GATT_CHR_F_READ,
+         },
          {0}, // Null terminator
      }},
     {0} // End of service list
@@ -412,6 +861,45 @@ void gatt_svr_subscribe_cb(struct ble_gap_event *event)
         ESP_LOGI(TAG, "subscribe by nimble stack; attr_handle=%d",
                  event->subscribe.attr_handle);
     }
+
+    /* Periodic telemetry notifications */
+    if (event->subscribe.attr_handle == telemetry_chr_val_handle)
+    {
+        telemetry_subscribe(event->subscribe.conn_handle,
+                            event->subscribe.cur_notify);
+    }
+
+    /* Download stream, also ends here when the peer disconnects */
+    if (event->subscribe.attr_handle == file_rw_chr_val_handle)
+    {
+        stream_stop();
+        stream_inflight = 0;
+        stream_conn_handle = event->subscribe.cur_notify
+                                 ? event->subscribe.conn_handle
+                                 : BLE_HS_CONN_HANDLE_NONE;
+    }
+}
+
+/*
+ *  GATT server notification sent event callback
+ */
+void gatt_svr_notify_tx_cb(struct ble_gap_event *event)
+{
+    if (event->notify_tx.attr_handle != file_rw_chr_val_handle ||
+        event->notify_tx.conn_handle != stream_conn_handle)
+    {
+        return;
+    }
+
+    if (event->notify_tx.status != 0)
+    {
+        stream_stop();
+        return;
+    }
+    if (stream_pos < stream_end)
+    {
+        ble_npl_eventq_put(nimble_port_get_dflt_eventq(), &stream_ev);
+    }
 }
 
 /*
@@ -427,6 +915,9 @@ int gatt_svc_init(void)
 
     /* 1. GATT service initialization */
     ble_svc_gatt_init();
+    ble_npl_event_init(&stream_ev, stream_resume, NULL);
+    ble_npl_callout_init(&stream_retry, nimble_port_get_dflt_eventq(),
+                         stream_resume, NULL);
 
     /* 2. Update GATT services counter */
     rc = ble_gatts_count_cfg(gatt_svr_svcs);
@@ -59,6 +59,24 @@ void led_init(void) {
     };
     ESP_ERROR_CHECK(
         led_strip_new_spi_device(&strip_config, &spi_config, &led_strip));
+#elif CONFIG_BLINK_LED_STRIP_BACKEND_I80
+    led_strip_i80_config_t i80_config = {
+        .num_strips = 0, // single strip on strip_config.strip_gpio_num
+        .clk_gpio_num = CONFIG_BLINK_I80_CLK_GPIO,
+        .dc_gpio_num = CONFIG_BLINK_I80_DC_GPIO,
+    };
+    ESP_ERROR_CHECK(
+        led_strip_new_i80_device(&strip_config, &i80_config, &led_strip));
+#elif CONFIG_BLINK_LED_STRIP_BACKEND_APA102
+    strip_config.led_model = LED_MODEL_APA102;
+    led_strip_apa102_config_t apa102_config = {
+        .spi_bus = SPI2_HOST,
+        .clk_gpio_num = CONFIG_BLINK_APA102_CLK_GPIO,
+        .clock_speed_hz = 0, // LED_STRIP_APA102_DEFAULT_CLOCK_HZ
+        .flags.with_dma = true,
+    };
+    ESP_ERROR_CHECK(
+        led_strip_new_apa102_device(&strip_config, &apa102_config, &led_strip));
 #else
 #error "unsupported LED strip backend"
 #endif
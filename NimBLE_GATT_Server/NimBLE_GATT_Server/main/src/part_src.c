@@ -0,0 +1,166 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+/* Includes */
+#include "part_src.h"
+#include "common.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "fs_mount.h"
+#include <inttypes.h>
+
+/*
+ * Raw partition read source
+ *      Maps a window of a flash partition into the data cache with
+ *      esp_partition_mmap and appends the mapped bytes straight into
+ *      outgoing mbufs, so partition dumps skip the fread/stack buffer
+ *      round trip. Only one window is mapped at a time to keep MMU
+ *      usage bounded regardless of the partition size.
+ *
+ *      The ctrl characteristic needs no pairing, so only app images and
+ *      the upload storage partitions can be opened; nvs holds bond keys
+ *      and is never served.
+ */
+
+/* Private variables */
+static const esp_partition_t *src_part = NULL;
+static const uint8_t *src_map = NULL;
+static esp_partition_mmap_handle_t src_map_handle;
+static uint32_t src_map_base = 0;
+static uint32_t src_map_len = 0;
+
+/* Private functions */
+static bool part_src_allowed(const esp_partition_t *part) {
+    if (part->type == ESP_PARTITION_TYPE_APP) {
+        return true;
+    }
+    return part->type == ESP_PARTITION_TYPE_DATA &&
+           (strcmp(part->label, FS_PARTITION_LABEL) == 0 ||
+            strcmp(part->label, CONFIG_FILE_STORAGE_RAWLOG_LABEL) == 0);
+}
+
+static void part_src_unmap(void) {
+    if (src_map) {
+        esp_partition_munmap(src_map_handle);
+        src_map = NULL;
+        src_map_len = 0;
+    }
+}
+
+static int part_src_map(uint32_t offset) {
+    const void *ptr;
+    uint32_t base = offset & ~(PART_SRC_MAP_WINDOW - 1);
+    uint32_t len = src_part->size - base;
+    esp_err_t err;
+
+    if (len > PART_SRC_MAP_WINDOW) {
+        len = PART_SRC_MAP_WINDOW;
+    }
+
+    part_src_unmap();
+    err = esp_partition_mmap(src_part, base, len, ESP_PARTITION_MMAP_DATA, &ptr,
+                             &src_map_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "failed to map %s at 0x%" PRIx32 ": %s", src_part->label,
+                 base, esp_err_to_name(err));
+        return -1;
+    }
+
+    src_map = ptr;
+    src_map_base = base;
+    src_map_len = len;
+    return 0;
+}
+
+/* Public functions */
+esp_err_t part_src_open(const char *label) {
+    const esp_partition_t *part;
+
+    part = esp_partition_find_first(ESP_PARTITION_TYPE_ANY,
+                                    ESP_PARTITION_SUBTYPE_ANY, label);
+    if (!part) {
+        ESP_LOGE(TAG, "partition %s not found", label);
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (!part_src_allowed(part)) {
+        ESP_LOGW(TAG, "partition %s may not be dumped", label);
+        return ESP_ERR_NOT_ALLOWED;
+    }
+
+    part_src_close();
+    src_part = part;
+    ESP_LOGI(TAG, "partition dump source: %s, %" PRIu32 " bytes", part->label,
+             part->size);
+    return ESP_OK;
+}
+
+void part_src_close(void) {
+    part_src_unmap();
+    src_part = NULL;
+}
+
+bool part_src_is_open(void) { return src_part != NULL; }
+
+const char *part_src_label(void) { return src_part ? src_part->label : ""; }
+
+uint32_t part_src_size(void) { return src_part ? src_part->size : 0; }
+
+/*
+ * Append up to len bytes of the partition starting at offset to om
+ * Returns the number of bytes appended, 0 at the end of the partition
+ * or a negative value on mapping/mbuf failure.
+ */
+int part_src_append(struct os_mbuf *om, uint32_t offset, uint32_t len) {
+    uint32_t done = 0;
+
+    if (!src_part || offset >= src_part->size) {
+        return 0;
+    }
+    if (len > src_part->size - offset) {
+        len = src_part->size - offset;
+    }
+
+    while (done < len) {
+        uint32_t pos = offset + done;
+        uint32_t chunk;
+
+        if (!src_map || pos < src_map_base ||
+            pos >= src_map_base + src_map_len) {
+            if (part_src_map(pos) != 0) {
+                return -1;
+            }
+        }
+
+        chunk = src_map_base + src_map_len - pos;
+        if (chunk > len - done) {
+            chunk = len - done;
+        }
+        if (os_mbuf_append(om, src_map + (pos - src_map_base), chunk) != 0) {
+            return -1;
+        }
+        done += chunk;
+    }
+
+    return done;
+}
+
+/* CRC-32 of the whole partition, one mapped window at a time */
+esp_err_t part_src_crc32(uint32_t *crc) {
+    uint32_t sum = 0;
+
+    if (!src_part) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    for (uint32_t pos = 0; pos < src_part->size; pos += src_map_len) {
+        if (part_src_map(pos) != 0) {
+            return ESP_FAIL;
+        }
+        sum = esp_rom_crc32_le(sum, src_map, src_map_len);
+    }
+
+    *crc = sum;
+    return ESP_OK;
+}
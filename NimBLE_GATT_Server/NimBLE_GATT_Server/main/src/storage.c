@@ -0,0 +1,107 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+/* Includes */
+#include "storage.h"
+#include "common.h"
+#include "fs_mount.h"
+#include "esp_timer.h"
+
+/* Private variables */
+static const storage_backend_t *const storage_backends[] = {
+    &storage_spiffs_backend,
+    &storage_littlefs_backend,
+    &storage_rawlog_backend,
+};
+
+/* Backends whose init succeeded, and how long init took */
+static bool storage_ready[sizeof(storage_backends) / sizeof(storage_backends[0])];
+static uint32_t storage_init_us[sizeof(storage_backends) / sizeof(storage_backends[0])];
+
+static const storage_backend_t *storage_active = NULL;
+
+/* Public functions */
+esp_err_t storage_init(void) {
+    const char *fs_name = fs_type_name(fs_mount_type());
+    esp_err_t ret;
+
+    for (size_t i = 0; i < storage_count(); i++) {
+        int64_t start = esp_timer_get_time();
+
+        ret = storage_backends[i]->init();
+        storage_init_us[i] = esp_timer_get_time() - start;
+        storage_ready[i] = ret == ESP_OK;
+        if (ret != ESP_OK) {
+            ESP_LOGI(TAG, "storage backend %s unavailable: %s",
+                     storage_backends[i]->name, esp_err_to_name(ret));
+        }
+    }
+
+    /* Fall back to the mounted file system if the raw log is missing */
+#if CONFIG_FILE_STORAGE_BACKEND_RAWLOG
+    storage_active = storage_find(storage_rawlog_backend.name);
+#endif
+    if (storage_active == NULL) {
+        storage_active = storage_find(fs_name);
+    }
+    if (storage_active == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    ESP_LOGI(TAG, "storage backend: %s", storage_active->name);
+    return ESP_OK;
+}
+
+const storage_backend_t *storage_get(void) { return storage_active; }
+
+esp_err_t storage_select(const char *name) {
+    const storage_backend_t *backend = storage_find(name);
+
+    if (backend == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    storage_active = backend;
+    ESP_LOGI(TAG, "storage backend: %s", backend->name);
+    return ESP_OK;
+}
+
+/* Look up a backend that initialized successfully */
+const storage_backend_t *storage_find(const char *name) {
+    for (size_t i = 0; i < storage_count(); i++) {
+        if (storage_ready[i] && strcmp(storage_backends[i]->name, name) == 0) {
+            return storage_backends[i];
+        }
+    }
+    return NULL;
+}
+
+size_t storage_count(void) {
+    return sizeof(storage_backends) / sizeof(storage_backends[0]);
+}
+
+/* Backend by position, NULL if it is not available */
+const storage_backend_t *storage_at(size_t i) {
+    if (i >= storage_count() || !storage_ready[i]) {
+        return NULL;
+    }
+    return storage_backends[i];
+}
+
+/*
+ * Time needed to bring a backend up: the mount time for file systems,
+ * the index scan for the raw log
+ */
+uint32_t storage_mount_time_us(const storage_backend_t *backend) {
+    if (strcmp(backend->name, fs_type_name(fs_mount_type())) == 0) {
+        return fs_mount_time_us();
+    }
+    for (size_t i = 0; i < storage_count(); i++) {
+        if (storage_backends[i] == backend) {
+            return storage_init_us[i];
+        }
+    }
+    return 0;
+}
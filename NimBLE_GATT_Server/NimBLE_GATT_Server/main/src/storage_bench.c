@@ -0,0 +1,203 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+/* Includes */
+#include "storage_bench.h"
+#include "common.h"
+#include "storage.h"
+#include "upload_writer.h"
+#include "esp_timer.h"
+#include <inttypes.h>
+
+/*
+ * Storage benchmark
+ *      For every available backend, reports the mount time, sequential
+ *      write/read throughput of a test object in upload-sized chunks and
+ *      small-file operations per second (create, stat, read, delete).
+ *      Runs in its own task so the NimBLE host keeps serving requests.
+ *
+ *      Backends take a single writer, so the bench does not start while
+ *      an upload is open and transfer.c refuses uploads while it runs.
+ *      Backends that make room by evicting objects are only benched when
+ *      the test object fits in their free space.
+ */
+
+/* Defines */
+#define STORAGE_BENCH_TASK_STACK (4 * 1024)
+#define STORAGE_BENCH_RESULT_LEN 256
+
+/* Private variables */
+static volatile bool bench_running = false;
+static uint32_t bench_size_kb;
+static char bench_result[STORAGE_BENCH_RESULT_LEN] = "IDLE";
+
+/* Private functions */
+static uint32_t kb_per_s(uint32_t bytes, int64_t us) {
+    return us > 0 ? (uint64_t)bytes * 1000000 / 1024 / us : 0;
+}
+
+/* Returns operations per second, 0 if the backend failed */
+static uint32_t bench_small_files(const storage_backend_t *backend,
+                                  uint8_t *buf) {
+    char name[STORAGE_OBJ_NAME_LEN];
+    int64_t start = esp_timer_get_time();
+    uint32_t ops = 0;
+
+    memset(buf, 0x5a, STORAGE_BENCH_SMALL_SIZE);
+    for (int i = 0; i < STORAGE_BENCH_SMALL_FILES; i++) {
+        snprintf(name, sizeof(name), "sf%02d.bin", i);
+        if (backend->write_begin(name) != ESP_OK) {
+            return 0;
+        }
+        backend->write(buf, STORAGE_BENCH_SMALL_SIZE);
+        if (backend->write_end() != ESP_OK) {
+            return 0;
+        }
+        ops++;
+    }
+    for (int i = 0; i < STORAGE_BENCH_SMALL_FILES; i++) {
+        snprintf(name, sizeof(name), "sf%02d.bin", i);
+        if (backend->size(name) != STORAGE_BENCH_SMALL_SIZE ||
+            backend->read(name, 0, buf, STORAGE_BENCH_SMALL_SIZE) !=
+                STORAGE_BENCH_SMALL_SIZE) {
+            return 0;
+        }
+        ops += 2;
+    }
+    for (int i = 0; i < STORAGE_BENCH_SMALL_FILES; i++) {
+        snprintf(name, sizeof(name), "sf%02d.bin", i);
+        backend->remove(name);
+        ops++;
+    }
+
+    return (uint64_t)ops * 1000000 / (esp_timer_get_time() - start);
+}
+
+static esp_err_t bench_backend(const storage_backend_t *backend, uint8_t *buf,
+                               uint32_t total, uint32_t *write_kbs,
+                               uint32_t *read_kbs) {
+    int64_t start;
+    uint32_t done;
+    esp_err_t err;
+
+    /* Sequential write */
+    start = esp_timer_get_time();
+    err = backend->write_begin(STORAGE_BENCH_OBJ);
+    for (done = 0; err == ESP_OK && done < total; done += STORAGE_BENCH_CHUNK) {
+        memset(buf, done & 0xff, STORAGE_BENCH_CHUNK);
+        err = backend->write(buf, STORAGE_BENCH_CHUNK);
+    }
+    if (backend->write_end() != ESP_OK && err == ESP_OK) {
+        err = ESP_FAIL;
+    }
+    if (err != ESP_OK) {
+        backend->remove(STORAGE_BENCH_OBJ);
+        return err;
+    }
+    *write_kbs = kb_per_s(done, esp_timer_get_time() - start);
+
+    /* Sequential read */
+    start = esp_timer_get_time();
+    for (done = 0; done < total;) {
+        int n = backend->read(STORAGE_BENCH_OBJ, done, buf, STORAGE_BENCH_CHUNK);
+        if (n <= 0) {
+            break;
+        }
+        done += n;
+    }
+    *read_kbs = kb_per_s(done, esp_timer_get_time() - start);
+
+    backend->remove(STORAGE_BENCH_OBJ);
+    return done >= total ? ESP_OK : ESP_FAIL;
+}
+
+static void storage_bench_task(void *param) {
+    uint32_t total = bench_size_kb * 1024;
+    uint8_t *buf = malloc(STORAGE_BENCH_CHUNK);
+    size_t pos = 0;
+
+    if (!buf) {
+        snprintf(bench_result, sizeof(bench_result), "ERR no mem");
+        goto out;
+    }
+
+    pos = snprintf(bench_result, sizeof(bench_result), "%" PRIu32 "KB", bench_size_kb);
+    for (size_t i = 0; i < storage_count(); i++) {
+        const storage_backend_t *backend = storage_at(i);
+        uint32_t mount_ms, write_kbs = 0, read_kbs = 0, small_ops = 0;
+        esp_err_t err;
+
+        if (!backend) {
+            continue;
+        }
+        mount_ms = storage_mount_time_us(backend) / 1000;
+        if (backend->free_space && backend->free_space() < total) {
+            pos += snprintf(bench_result + pos, sizeof(bench_result) - pos,
+                            " %s mnt=%" PRIu32 " full", backend->name,
+                            mount_ms);
+            ESP_LOGW(TAG, "storage bench %s: skipped, would evict objects",
+                     backend->name);
+            if (pos >= sizeof(bench_result)) {
+                break;
+            }
+            continue;
+        }
+        err = bench_backend(backend, buf, total, &write_kbs, &read_kbs);
+
+        /* Don't evict real objects from stores with a tiny index */
+        if (backend->max_objects == 0 ||
+            backend->max_objects > STORAGE_BENCH_SMALL_FILES * 2) {
+            small_ops = bench_small_files(backend, buf);
+        }
+
+        if (err != ESP_OK) {
+            pos += snprintf(bench_result + pos, sizeof(bench_result) - pos,
+                            " %s=ERR", backend->name);
+        } else {
+            pos += snprintf(bench_result + pos, sizeof(bench_result) - pos,
+                            " %s mnt=%" PRIu32 " w=%" PRIu32 " r=%" PRIu32
+                            " ops=%" PRIu32,
+                            backend->name, mount_ms, write_kbs, read_kbs,
+                            small_ops);
+        }
+        ESP_LOGI(TAG, "storage bench %s: mount %" PRIu32 " ms, write %" PRIu32
+                 " KB/s, read %" PRIu32 " KB/s, small files %" PRIu32 " ops/s",
+                 backend->name, mount_ms, write_kbs, read_kbs, small_ops);
+        if (pos >= sizeof(bench_result)) {
+            break;
+        }
+    }
+
+out:
+    free(buf);
+    bench_running = false;
+    vTaskDelete(NULL);
+}
+
+/* Public functions */
+esp_err_t storage_bench_start(uint32_t size_kb) {
+    if (bench_running || upload_writer_backend()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    bench_size_kb = size_kb ? size_kb : STORAGE_BENCH_DEFAULT_KB;
+    bench_running = true;
+    snprintf(bench_result, sizeof(bench_result), "RUNNING");
+    if (xTaskCreate(storage_bench_task, "Storage Bench",
+                    STORAGE_BENCH_TASK_STACK, NULL, 3, NULL) != pdPASS) {
+        bench_running = false;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+bool storage_bench_running(void) { return bench_running; }
+
+/*
+ * Last result, e.g. "64KB spiffs mnt=210 w=40 r=350 ops=90 rawlog mnt=1 ..."
+ * with the mount time in ms, throughput in KB/s and small-file ops/s
+ * (0 when skipped), or "rawlog mnt=1 full" if the test object did not fit
+ */
+const char *storage_bench_result(void) { return bench_result; }
@@ -0,0 +1,158 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+/* Includes */
+#include "storage.h"
+#include "common.h"
+#include "fs_maint.h"
+#include "fs_mount.h"
+#include "telemetry.h"
+#include "esp_timer.h"
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ * File system backends
+ *      Objects are plain files under FS_BASE_PATH. The same code serves
+ *      SPIFFS and LittleFS; only the backend matching the file system
+ *      that fs_mount brought up reports itself as available.
+ */
+
+/* Defines */
+#define FS_OBJ_PATH_MAX (sizeof(FS_BASE_PATH) + STORAGE_OBJ_NAME_LEN + 1)
+
+/* Private variables */
+static FILE *wr_file = NULL;
+static char wr_obj[STORAGE_OBJ_NAME_LEN];
+
+/* Private functions */
+static void fs_obj_path(char *path, const char *obj) {
+    snprintf(path, FS_OBJ_PATH_MAX, FS_BASE_PATH "/%s", obj);
+}
+
+static esp_err_t fs_spiffs_init(void) {
+    return fs_mount_type() == FS_TYPE_SPIFFS ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+static esp_err_t fs_littlefs_init(void) {
+    return fs_mount_type() == FS_TYPE_LITTLEFS ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+static esp_err_t fs_write_begin(const char *obj) {
+    char path[FS_OBJ_PATH_MAX];
+
+    if (wr_file) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    fs_obj_path(path, obj);
+    wr_file = fopen(path, "wb");
+    if (!wr_file) {
+        ESP_LOGE(TAG, "failed to create %s", path);
+        return ESP_FAIL;
+    }
+
+    strlcpy(wr_obj, obj, sizeof(wr_obj));
+    return ESP_OK;
+}
+
+static esp_err_t fs_write(const uint8_t *data, size_t len) {
+    int64_t start;
+    uint32_t us;
+    size_t n;
+
+    if (!wr_file) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    /* Time each write so GC stalls inside SPIFFS show up in telemetry */
+    start = esp_timer_get_time();
+    n = fwrite(data, 1, len, wr_file);
+    us = esp_timer_get_time() - start;
+    fs_maint_note_write(us);
+    telemetry_latency(TELEMETRY_HIST_FLASH_WRITE, us);
+    return n == len ? ESP_OK : ESP_FAIL;
+}
+
+static esp_err_t fs_write_end(void) {
+    int rc;
+
+    if (!wr_file) {
+        return ESP_OK;
+    }
+    rc = fclose(wr_file);
+    wr_file = NULL;
+    return rc == 0 ? ESP_OK : ESP_FAIL;
+}
+
+static int fs_read(const char *obj, uint32_t offset, uint8_t *buf,
+                   size_t len) {
+    char path[FS_OBJ_PATH_MAX];
+    FILE *f;
+    size_t n;
+
+    /* Make data appended by the open writer visible */
+    if (wr_file && strcmp(obj, wr_obj) == 0) {
+        fflush(wr_file);
+    }
+
+    fs_obj_path(path, obj);
+    f = fopen(path, "rb");
+    if (!f) {
+        return -1;
+    }
+    if (fseek(f, offset, SEEK_SET) != 0) {
+        fclose(f);
+        return -1;
+    }
+    n = fread(buf, 1, len, f);
+    fclose(f);
+    return n;
+}
+
+static int32_t fs_size(const char *obj) {
+    char path[FS_OBJ_PATH_MAX];
+    struct stat st;
+
+    if (wr_file && strcmp(obj, wr_obj) == 0) {
+        fflush(wr_file);
+    }
+
+    fs_obj_path(path, obj);
+    if (stat(path, &st) != 0) {
+        return -1;
+    }
+    return st.st_size;
+}
+
+static esp_err_t fs_remove(const char *obj) {
+    char path[FS_OBJ_PATH_MAX];
+
+    fs_obj_path(path, obj);
+    return unlink(path) == 0 ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+/* Public variables */
+const storage_backend_t storage_spiffs_backend = {
+    .name = "spiffs",
+    .init = fs_spiffs_init,
+    .write_begin = fs_write_begin,
+    .write = fs_write,
+    .write_end = fs_write_end,
+    .read = fs_read,
+    .size = fs_size,
+    .remove = fs_remove,
+};
+
+const storage_backend_t storage_littlefs_backend = {
+    .name = "littlefs",
+    .init = fs_littlefs_init,
+    .write_begin = fs_write_begin,
+    .write = fs_write,
+    .write_end = fs_write_end,
+    .read = fs_read,
+    .size = fs_size,
+    .remove = fs_remove,
+};
@@ -0,0 +1,484 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+/* Includes */
+#include "storage.h"
+#include "common.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+#include "telemetry.h"
+#include "freertos/semphr.h"
+#include <stddef.h>
+#include <inttypes.h>
+
+/*
+ * Raw partition append log
+ *      A log-structured object store on a dedicated data partition,
+ *      bypassing the file system for large sequential uploads.
+ *
+ *      sector 0..1     index, written ping-pong with a generation counter
+ *      sector 2..N-1   data ring
+ *
+ *      Objects are written sector by sector at the ring head, so every
+ *      flash write is a whole erased sector and erases rotate over the
+ *      entire partition. Committing an object appends it to the index;
+ *      objects whose sectors get overwritten by the head are dropped, and
+ *      the index is saved before their first sector is erased. The CRC of
+ *      an object is checked the first time it is read after boot.
+ */
+
+/* Defines */
+#define RAWLOG_SECTOR_SIZE 4096
+#define RAWLOG_INDEX_SECTORS 2
+#define RAWLOG_MAX_ENTRIES 8
+#define RAWLOG_MAGIC 0x474f4c52 /* "RLOG" */
+
+/* Private types */
+typedef struct {
+    char name[STORAGE_OBJ_NAME_LEN];
+    uint32_t seq;
+    uint16_t start;   /* first data sector, ring relative */
+    uint16_t sectors; /* data sectors in use */
+    uint32_t len;
+    uint32_t crc;
+} rawlog_entry_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t gen;
+    uint32_t next_seq;
+    uint16_t head; /* next data sector to write, ring relative */
+    uint16_t count;
+    rawlog_entry_t entries[RAWLOG_MAX_ENTRIES];
+    uint32_t crc;
+} rawlog_index_t;
+
+/* Private variables */
+static const esp_partition_t *log_part = NULL;
+static SemaphoreHandle_t log_lock = NULL;
+static uint16_t data_sectors = 0;
+static rawlog_index_t idx;
+static bool idx_checked[RAWLOG_MAX_ENTRIES]; /* data CRC verified, per entry */
+static uint8_t chk_buf[256];
+
+/* Open writer */
+static bool wr_open = false;
+static rawlog_entry_t wr_entry;
+static uint32_t wr_buf_len = 0;
+static uint8_t wr_buf[RAWLOG_SECTOR_SIZE];
+
+/* Private functions */
+static uint32_t index_crc(const rawlog_index_t *index) {
+    return esp_rom_crc32_le(0, (const uint8_t *)index,
+                            offsetof(rawlog_index_t, crc));
+}
+
+static uint32_t data_addr(uint16_t ring_sector) {
+    return (RAWLOG_INDEX_SECTORS + ring_sector % data_sectors) *
+           RAWLOG_SECTOR_SIZE;
+}
+
+static esp_err_t index_save(void) {
+    esp_err_t err;
+    uint32_t addr;
+
+    idx.gen++;
+    idx.crc = index_crc(&idx);
+
+    /* Alternate between the two index sectors */
+    addr = (idx.gen % RAWLOG_INDEX_SECTORS) * RAWLOG_SECTOR_SIZE;
+    err = esp_partition_erase_range(log_part, addr, RAWLOG_SECTOR_SIZE);
+    if (err == ESP_OK) {
+        err = esp_partition_write(log_part, addr, &idx, sizeof(idx));
+    }
+    return err;
+}
+
+static void index_load(void) {
+    rawlog_index_t tmp;
+
+    memset(&idx, 0, sizeof(idx));
+    memset(idx_checked, 0, sizeof(idx_checked));
+    idx.magic = RAWLOG_MAGIC;
+
+    for (int i = 0; i < RAWLOG_INDEX_SECTORS; i++) {
+        if (esp_partition_read(log_part, i * RAWLOG_SECTOR_SIZE, &tmp,
+                               sizeof(tmp)) != ESP_OK) {
+            continue;
+        }
+        if (tmp.magic != RAWLOG_MAGIC || tmp.crc != index_crc(&tmp) ||
+            tmp.count > RAWLOG_MAX_ENTRIES || tmp.head >= data_sectors) {
+            continue;
+        }
+        if (tmp.gen >= idx.gen) {
+            idx = tmp;
+        }
+    }
+}
+
+static void index_drop(int i) {
+    memmove(&idx.entries[i], &idx.entries[i + 1],
+            (idx.count - i - 1) * sizeof(rawlog_entry_t));
+    memmove(&idx_checked[i], &idx_checked[i + 1],
+            (idx.count - i - 1) * sizeof(bool));
+    idx.count--;
+}
+
+/* Drop committed objects that occupy a data sector about to be erased */
+static bool index_evict_sector(uint16_t sector) {
+    bool evicted = false;
+
+    for (int i = idx.count - 1; i >= 0; i--) {
+        rawlog_entry_t *e = &idx.entries[i];
+        uint16_t dist = (sector + data_sectors - e->start) % data_sectors;
+
+        if (dist < e->sectors) {
+            ESP_LOGD(TAG, "rawlog: evicting %s", e->name);
+            index_drop(i);
+            evicted = true;
+        }
+    }
+    return evicted;
+}
+
+static int index_find(const char *obj) {
+    int found = -1;
+
+    for (int i = 0; i < idx.count; i++) {
+        if (strncmp(idx.entries[i].name, obj, STORAGE_OBJ_NAME_LEN) == 0 &&
+            (found < 0 || idx.entries[i].seq > idx.entries[found].seq)) {
+            found = i;
+        }
+    }
+    return found;
+}
+
+static esp_err_t flush_sector(void) {
+    uint16_t sector;
+    int64_t start;
+    esp_err_t err;
+
+    if (wr_entry.sectors >= data_sectors) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    sector = (wr_entry.start + wr_entry.sectors) % data_sectors;
+    /* The saved index must not point at the sector once it is erased */
+    if (index_evict_sector(sector)) {
+        err = index_save();
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "rawlog: index save failed: %s",
+                     esp_err_to_name(err));
+            return err;
+        }
+    }
+
+    start = esp_timer_get_time();
+    err = esp_partition_erase_range(log_part, data_addr(sector),
+                                    RAWLOG_SECTOR_SIZE);
+    telemetry_latency(TELEMETRY_HIST_FLASH_ERASE, esp_timer_get_time() - start);
+    if (err == ESP_OK) {
+        start = esp_timer_get_time();
+        err = esp_partition_write(log_part, data_addr(sector), wr_buf,
+                                  wr_buf_len);
+        telemetry_latency(TELEMETRY_HIST_FLASH_WRITE,
+                          esp_timer_get_time() - start);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "rawlog: sector %u write failed: %s", sector,
+                 esp_err_to_name(err));
+        return err;
+    }
+
+    wr_entry.sectors++;
+    wr_buf_len = 0;
+    return ESP_OK;
+}
+
+/* Read from flash for an object laid out from ring sector start */
+static esp_err_t read_ring(uint16_t start, uint32_t offset, uint8_t *buf,
+                           size_t len) {
+    while (len > 0) {
+        uint16_t sector = start + offset / RAWLOG_SECTOR_SIZE;
+        uint32_t in_sector = offset % RAWLOG_SECTOR_SIZE;
+        size_t n = RAWLOG_SECTOR_SIZE - in_sector;
+        esp_err_t err;
+
+        if (n > len) {
+            n = len;
+        }
+        err = esp_partition_read(log_part, data_addr(sector) + in_sector, buf,
+                                 n);
+        if (err != ESP_OK) {
+            return err;
+        }
+        offset += n;
+        buf += n;
+        len -= n;
+    }
+    return ESP_OK;
+}
+
+/* Committed object by name, its data CRC checked on first use */
+static const rawlog_entry_t *index_find_checked(const char *obj) {
+    const rawlog_entry_t *e;
+    uint32_t crc = 0;
+    int i = index_find(obj);
+
+    if (i < 0 || idx_checked[i]) {
+        return i < 0 ? NULL : &idx.entries[i];
+    }
+    e = &idx.entries[i];
+    for (uint32_t off = 0; off < e->len; off += sizeof(chk_buf)) {
+        size_t n = e->len - off < sizeof(chk_buf) ? e->len - off
+                                                   : sizeof(chk_buf);
+
+        if (read_ring(e->start, off, chk_buf, n) != ESP_OK) {
+            return NULL;
+        }
+        crc = esp_rom_crc32_le(crc, chk_buf, n);
+    }
+    if (crc != e->crc) {
+        ESP_LOGE(TAG, "rawlog: %s fails its CRC, dropping it", e->name);
+        index_drop(i);
+        index_save();
+        return NULL;
+    }
+    idx_checked[i] = true;
+    return e;
+}
+
+static esp_err_t rawlog_init(void) {
+    /* Already brought up early, e.g. for a file system migration */
+    if (log_lock) {
+        return ESP_OK;
+    }
+
+    log_part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                        ESP_PARTITION_SUBTYPE_ANY,
+                                        CONFIG_FILE_STORAGE_RAWLOG_LABEL);
+    if (!log_part) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (log_part->size < (RAWLOG_INDEX_SECTORS + 1) * RAWLOG_SECTOR_SIZE) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    log_lock = xSemaphoreCreateMutex();
+    if (!log_lock) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    data_sectors = log_part->size / RAWLOG_SECTOR_SIZE - RAWLOG_INDEX_SECTORS;
+    index_load();
+    ESP_LOGI(TAG, "rawlog: %u data sectors, %u objects, head %u, gen %" PRIu32,
+             data_sectors, idx.count, idx.head, idx.gen);
+    return ESP_OK;
+}
+
+static esp_err_t rawlog_write_begin(const char *obj) {
+    esp_err_t ret = ESP_OK;
+
+    xSemaphoreTake(log_lock, portMAX_DELAY);
+    if (wr_open) {
+        ret = ESP_ERR_INVALID_STATE;
+    } else {
+        memset(&wr_entry, 0, sizeof(wr_entry));
+        strlcpy(wr_entry.name, obj, sizeof(wr_entry.name));
+        wr_entry.seq = idx.next_seq++;
+        wr_entry.start = idx.head;
+        wr_buf_len = 0;
+        wr_open = true;
+    }
+    xSemaphoreGive(log_lock);
+    return ret;
+}
+
+static esp_err_t rawlog_write(const uint8_t *data, size_t len) {
+    esp_err_t ret = ESP_OK;
+
+    xSemaphoreTake(log_lock, portMAX_DELAY);
+    if (!wr_open) {
+        ret = ESP_ERR_INVALID_STATE;
+        goto out;
+    }
+
+    wr_entry.crc = esp_rom_crc32_le(wr_entry.crc, data, len);
+    wr_entry.len += len;
+    while (len > 0) {
+        size_t n = RAWLOG_SECTOR_SIZE - wr_buf_len;
+
+        if (n > len) {
+            n = len;
+        }
+        memcpy(wr_buf + wr_buf_len, data, n);
+        wr_buf_len += n;
+        data += n;
+        len -= n;
+
+        if (wr_buf_len == RAWLOG_SECTOR_SIZE) {
+            ret = flush_sector();
+            if (ret != ESP_OK) {
+                goto out;
+            }
+        }
+    }
+
+out:
+    xSemaphoreGive(log_lock);
+    return ret;
+}
+
+static esp_err_t rawlog_write_end(void) {
+    esp_err_t ret = ESP_OK;
+
+    xSemaphoreTake(log_lock, portMAX_DELAY);
+    if (!wr_open) {
+        goto out;
+    }
+    wr_open = false;
+
+    if (wr_buf_len > 0) {
+        ret = flush_sector();
+        if (ret != ESP_OK) {
+            goto out;
+        }
+    }
+
+    /* Replace older versions, make room for the new entry */
+    for (int i = idx.count - 1; i >= 0; i--) {
+        if (strncmp(idx.entries[i].name, wr_entry.name,
+                    STORAGE_OBJ_NAME_LEN) == 0) {
+            index_drop(i);
+        }
+    }
+    if (idx.count == RAWLOG_MAX_ENTRIES) {
+        index_drop(0);
+    }
+
+    idx_checked[idx.count] = true;
+    idx.entries[idx.count++] = wr_entry;
+    idx.head = (wr_entry.start + wr_entry.sectors) % data_sectors;
+    ret = index_save();
+    ESP_LOGI(TAG, "rawlog: committed %s, %" PRIu32 " bytes in %u sectors",
+             wr_entry.name, wr_entry.len, wr_entry.sectors);
+
+out:
+    xSemaphoreGive(log_lock);
+    return ret;
+}
+
+static int rawlog_read(const char *obj, uint32_t offset, uint8_t *buf,
+                       size_t len) {
+    const rawlog_entry_t *e;
+    int ret = -1;
+
+    xSemaphoreTake(log_lock, portMAX_DELAY);
+    if (wr_open && strncmp(obj, wr_entry.name, STORAGE_OBJ_NAME_LEN) == 0) {
+        /* Object still being written: flushed sectors plus RAM tail */
+        uint32_t flushed = wr_entry.sectors * RAWLOG_SECTOR_SIZE;
+
+        if (offset >= wr_entry.len) {
+            ret = 0;
+            goto out;
+        }
+        if (len > wr_entry.len - offset) {
+            len = wr_entry.len - offset;
+        }
+        if (offset < flushed) {
+            size_t n = flushed - offset < len ? flushed - offset : len;
+
+            if (read_ring(wr_entry.start, offset, buf, n) != ESP_OK) {
+                goto out;
+            }
+            memcpy(buf + n, wr_buf, len - n);
+        } else {
+            memcpy(buf, wr_buf + (offset - flushed), len);
+        }
+        ret = len;
+        goto out;
+    }
+
+    e = index_find_checked(obj);
+    if (!e) {
+        goto out;
+    }
+    if (offset >= e->len) {
+        ret = 0;
+        goto out;
+    }
+    if (len > e->len - offset) {
+        len = e->len - offset;
+    }
+    if (read_ring(e->start, offset, buf, len) == ESP_OK) {
+        ret = len;
+    }
+
+out:
+    xSemaphoreGive(log_lock);
+    return ret;
+}
+
+static int32_t rawlog_size(const char *obj) {
+    const rawlog_entry_t *e;
+    int32_t ret = -1;
+
+    xSemaphoreTake(log_lock, portMAX_DELAY);
+    if (wr_open && strncmp(obj, wr_entry.name, STORAGE_OBJ_NAME_LEN) == 0) {
+        ret = wr_entry.len;
+    } else if ((e = index_find_checked(obj)) != NULL) {
+        ret = e->len;
+    }
+    xSemaphoreGive(log_lock);
+    return ret;
+}
+
+static esp_err_t rawlog_remove(const char *obj) {
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+
+    xSemaphoreTake(log_lock, portMAX_DELAY);
+    for (int i = idx.count - 1; i >= 0; i--) {
+        if (strncmp(idx.entries[i].name, obj, STORAGE_OBJ_NAME_LEN) == 0) {
+            index_drop(i);
+            ret = ESP_OK;
+        }
+    }
+    if (ret == ESP_OK) {
+        ret = index_save();
+    }
+    xSemaphoreGive(log_lock);
+    return ret;
+}
+
+/* Sectors up to the oldest object, none if committing would drop an entry */
+static uint32_t rawlog_free_space(void) {
+    uint32_t sectors;
+
+    xSemaphoreTake(log_lock, portMAX_DELAY);
+    if (idx.count >= RAWLOG_MAX_ENTRIES) {
+        sectors = 0;
+    } else if (idx.count == 0) {
+        sectors = data_sectors;
+    } else {
+        sectors = (idx.entries[0].start + data_sectors - idx.head) % data_sectors;
+    }
+    xSemaphoreGive(log_lock);
+    return sectors * RAWLOG_SECTOR_SIZE;
+}
+
+/* Public variables */
+const storage_backend_t storage_rawlog_backend = {
+    .name = "rawlog",
+    .max_objects = RAWLOG_MAX_ENTRIES,
+    .init = rawlog_init,
+    .write_begin = rawlog_write_begin,
+    .write = rawlog_write,
+    .write_end = rawlog_write_end,
+    .read = rawlog_read,
+    .size = rawlog_size,
+    .remove = rawlog_remove,
+    .free_space = rawlog_free_space,
+};
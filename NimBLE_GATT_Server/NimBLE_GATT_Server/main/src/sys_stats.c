@@ -0,0 +1,147 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+/* Includes */
+#include "sys_stats.h"
+#include "common.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include <stdlib.h>
+#include <sys/param.h>
+
+/*
+ * System stats
+ *      A low-priority task samples the FreeRTOS run-time counters, stack
+ *      high-water marks and heap state every CONFIG_FILE_STATS_PERIOD_MS.
+ *      CPU share is the run time each task gained since the previous
+ *      sample. Tasks are sent in the order uxTaskGetSystemState returns
+ *      them; the busiest ones are kept when there are more than fit.
+ */
+
+/* Defines */
+#define SYS_STATS_TASK_STACK (3 * 1024)
+#define SYS_STATS_SLACK 4 /* room for tasks created between calls */
+
+typedef struct {
+    TaskHandle_t handle;
+    uint32_t run_time;
+} prev_run_t;
+
+/* Private variables */
+static sys_stats_t latest;
+static portMUX_TYPE latest_lock = portMUX_INITIALIZER_UNLOCKED;
+static prev_run_t *prev = NULL;
+static size_t prev_count = 0;
+static uint32_t prev_total = 0;
+
+/* Private functions */
+static uint32_t prev_run_time(TaskHandle_t handle) {
+    for (size_t i = 0; i < prev_count; i++) {
+        if (prev[i].handle == handle) {
+            return prev[i].run_time;
+        }
+    }
+    return 0;
+}
+
+static int by_cpu_desc(const void *a, const void *b) {
+    const sys_stats_task_t *ta = a, *tb = b;
+    return (int)tb->cpu_permille - (int)ta->cpu_permille;
+}
+
+static void sample_heap(sys_stats_heap_t *heap, uint32_t caps) {
+    heap->free = heap_caps_get_free_size(caps);
+    heap->largest = heap_caps_get_largest_free_block(caps);
+    heap->min_free = heap_caps_get_minimum_free_size(caps);
+}
+
+static void sys_stats_sample(void) {
+    static sys_stats_task_t tasks[SYS_STATS_MAX_TASKS * 2];
+    sys_stats_t sample = {
+        .version = SYS_STATS_VERSION,
+        .cores = portNUM_PROCESSORS,
+    };
+    UBaseType_t max = uxTaskGetNumberOfTasks() + SYS_STATS_SLACK;
+    TaskStatus_t *status = malloc(max * sizeof(*status));
+    prev_run_t *next = malloc(max * sizeof(*next));
+    configRUN_TIME_COUNTER_TYPE total = 0;
+    UBaseType_t n;
+    size_t kept = 0;
+    uint32_t elapsed;
+
+    if (!status || !next) {
+        free(status);
+        free(next);
+        return;
+    }
+
+    n = uxTaskGetSystemState(status, max, &total);
+    elapsed = (uint32_t)total - prev_total;
+
+    for (UBaseType_t i = 0; i < n; i++) {
+        uint32_t ran = (uint32_t)status[i].ulRunTimeCounter -
+                       prev_run_time(status[i].xHandle);
+
+        next[i].handle = status[i].xHandle;
+        next[i].run_time = status[i].ulRunTimeCounter;
+        if (kept == sizeof(tasks) / sizeof(tasks[0])) {
+            continue;
+        }
+
+        sys_stats_task_t *t = &tasks[kept++];
+        strncpy(t->name, status[i].pcTaskName, SYS_STATS_NAME_LEN);
+        t->priority = status[i].uxCurrentPriority;
+        t->state = status[i].eCurrentState;
+        t->cpu_permille =
+            elapsed ? (uint64_t)ran * 1000 / elapsed / portNUM_PROCESSORS : 0;
+        t->stack_free = MIN(status[i].usStackHighWaterMark, UINT16_MAX);
+    }
+
+    if (kept > SYS_STATS_MAX_TASKS) {
+        qsort(tasks, kept, sizeof(tasks[0]), by_cpu_desc);
+        kept = SYS_STATS_MAX_TASKS;
+    }
+    memcpy(sample.tasks, tasks, kept * sizeof(tasks[0]));
+    sample.task_count = kept;
+    sample.uptime_ms = esp_timer_get_time() / 1000;
+    sample.period_ms = elapsed / 1000; /* run-time counter ticks in us */
+    sample_heap(&sample.internal, MALLOC_CAP_INTERNAL);
+    sample_heap(&sample.dma, MALLOC_CAP_DMA);
+
+    free(prev);
+    free(status);
+    prev = next;
+    prev_count = n;
+    prev_total = total;
+
+    taskENTER_CRITICAL(&latest_lock);
+    latest = sample;
+    taskEXIT_CRITICAL(&latest_lock);
+}
+
+static void sys_stats_task(void *param) {
+    for (;;) {
+        sys_stats_sample();
+        vTaskDelay(pdMS_TO_TICKS(CONFIG_FILE_STATS_PERIOD_MS));
+    }
+}
+
+/* Public functions */
+esp_err_t sys_stats_init(void) {
+    if (xTaskCreate(sys_stats_task, "Sys Stats", SYS_STATS_TASK_STACK, NULL, 1,
+                    NULL) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+/* Copies the latest sample, returns its size on the wire */
+size_t sys_stats_get(sys_stats_t *out) {
+    taskENTER_CRITICAL(&latest_lock);
+    *out = latest;
+    taskEXIT_CRITICAL(&latest_lock);
+    return offsetof(sys_stats_t, tasks) +
+           out->task_count * sizeof(sys_stats_task_t);
+}
@@ -0,0 +1,134 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+/* Includes */
+#include "telemetry.h"
+#include "common.h"
+#include "fs_maint.h"
+#include <stdatomic.h>
+
+/*
+ * Transfer telemetry
+ *      The hot path only bumps relaxed atomic counters; nothing is
+ *      formatted or locked until a peer reads the characteristic, at
+ *      which point telemetry_snapshot copies them into the fixed layout.
+ *      A snapshot taken during a transfer may mix counters from two
+ *      neighbouring chunks, which is fine for monitoring.
+ */
+
+/* Private variables */
+static atomic_uint_fast32_t session;
+static atomic_uint_fast32_t bytes_in;
+static atomic_uint_fast32_t bytes_out;
+static atomic_uint_fast32_t chunks_in;
+static atomic_uint_fast32_t chunks_out;
+static atomic_uint_fast32_t retransmits;
+static atomic_uint_fast32_t hist[TELEMETRY_HIST_COUNT][TELEMETRY_HIST_BUCKETS];
+static atomic_uint_fast16_t queue_depth;
+static atomic_uint_fast16_t queue_peak;
+
+/* Link parameters, only written from the NimBLE host task */
+static volatile uint16_t link_mtu;
+static volatile uint16_t link_itvl;
+static volatile uint8_t link_tx_phy;
+static volatile uint8_t link_rx_phy;
+
+/* Private functions */
+static inline void counter_add(atomic_uint_fast32_t *c, uint32_t v) {
+    atomic_fetch_add_explicit(c, v, memory_order_relaxed);
+}
+
+static inline uint32_t counter_get(atomic_uint_fast32_t *c) {
+    return atomic_load_explicit(c, memory_order_relaxed);
+}
+
+/* Public functions */
+void telemetry_session_begin(void) {
+    counter_add(&session, 1);
+    atomic_store_explicit(&bytes_in, 0, memory_order_relaxed);
+    atomic_store_explicit(&bytes_out, 0, memory_order_relaxed);
+    atomic_store_explicit(&chunks_in, 0, memory_order_relaxed);
+    atomic_store_explicit(&chunks_out, 0, memory_order_relaxed);
+    atomic_store_explicit(&retransmits, 0, memory_order_relaxed);
+    atomic_store_explicit(&queue_peak, 0, memory_order_relaxed);
+}
+
+/* Pass 0 for anything that did not change */
+void telemetry_link(uint16_t mtu, uint16_t conn_itvl, uint8_t tx_phy,
+                    uint8_t rx_phy) {
+    if (mtu) {
+        link_mtu = mtu;
+    }
+    if (conn_itvl) {
+        link_itvl = conn_itvl;
+    }
+    if (tx_phy) {
+        link_tx_phy = tx_phy;
+        link_rx_phy = rx_phy;
+    }
+}
+
+void telemetry_in(uint32_t len) {
+    counter_add(&bytes_in, len);
+    counter_add(&chunks_in, 1);
+}
+
+void telemetry_out(uint32_t len) {
+    counter_add(&bytes_out, len);
+    counter_add(&chunks_out, 1);
+}
+
+void telemetry_retransmit(void) { counter_add(&retransmits, 1); }
+
+void telemetry_queue_depth(uint16_t depth) {
+    uint_fast16_t peak =
+        atomic_load_explicit(&queue_peak, memory_order_relaxed);
+
+    atomic_store_explicit(&queue_depth, depth, memory_order_relaxed);
+    while (depth > peak &&
+           !atomic_compare_exchange_weak_explicit(&queue_peak, &peak, depth,
+                                                  memory_order_relaxed,
+                                                  memory_order_relaxed)) {
+    }
+}
+
+void telemetry_latency(telemetry_hist_t which, uint32_t us) {
+    int bucket = us ? 31 - __builtin_clz(us) : 0;
+
+    if (bucket >= TELEMETRY_HIST_BUCKETS) {
+        bucket = TELEMETRY_HIST_BUCKETS - 1;
+    }
+    counter_add(&hist[which][bucket], 1);
+}
+
+void telemetry_snapshot(telemetry_t *out) {
+    fs_maint_stats_t gc;
+
+    memset(out, 0, sizeof(*out));
+    out->version = TELEMETRY_VERSION;
+    out->tx_phy = link_tx_phy;
+    out->rx_phy = link_rx_phy;
+    out->mtu = link_mtu;
+    out->conn_itvl = link_itvl;
+    out->session = counter_get(&session);
+    out->bytes_in = counter_get(&bytes_in);
+    out->bytes_out = counter_get(&bytes_out);
+    out->chunks_in = counter_get(&chunks_in);
+    out->chunks_out = counter_get(&chunks_out);
+    out->retransmits = counter_get(&retransmits);
+    out->queue_depth = atomic_load_explicit(&queue_depth, memory_order_relaxed);
+    out->queue_peak = atomic_load_explicit(&queue_peak, memory_order_relaxed);
+
+    fs_maint_get_stats(&gc);
+    out->gc_slices = gc.gc_slices;
+    out->gc_max_us = gc.gc_max_us;
+    out->write_stalls = gc.write_stalls;
+
+    for (int h = 0; h < TELEMETRY_HIST_COUNT; h++) {
+        for (int b = 0; b < TELEMETRY_HIST_BUCKETS; b++) {
+            out->hist[h][b] = counter_get(&hist[h][b]);
+        }
+    }
+}
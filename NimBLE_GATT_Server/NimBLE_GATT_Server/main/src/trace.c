@@ -0,0 +1,116 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+/* Includes */
+#include "trace.h"
+#include "common.h"
+#include "esp_timer.h"
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+/*
+ * Binary trace
+ *      Hot paths record an event ID, a timestamp and two integer args into
+ *      a RAM ring; nothing is formatted until the ring is dumped over GATT
+ *      or printed by a low-priority task. Writers claim a slot with one
+ *      atomic increment, so a dump taken while events are being recorded
+ *      may contain an entry that is still being filled in. The sequence
+ *      number lets the decoder spot gaps and wrap-around.
+ */
+
+/* Defines */
+#define TRACE_PRINT_TASK_STACK (3 * 1024)
+
+_Static_assert((TRACE_ENTRIES & (TRACE_ENTRIES - 1)) == 0,
+               "trace ring size must be a power of two");
+
+/* Private variables */
+static trace_entry_t trace_ring[TRACE_ENTRIES];
+static atomic_uint_fast32_t trace_head;
+static volatile bool trace_printing = false;
+
+static const char *const trace_names[TRACE_ID_COUNT] = {
+    [TRACE_NONE] = "none",
+    [TRACE_CONNECT] = "connect",
+    [TRACE_DISCONNECT] = "disconnect",
+    [TRACE_CONN_UPDATE] = "conn_update",
+    [TRACE_MTU] = "mtu",
+    [TRACE_PHY] = "phy",
+    [TRACE_UPLOAD_BEGIN] = "upload_begin",
+    [TRACE_UPLOAD_CHUNK] = "upload_chunk",
+    [TRACE_UPLOAD_END] = "upload_end",
+    [TRACE_READ] = "read",
+    [TRACE_READ_OFFSET] = "read_offset",
+    [TRACE_OTA_BEGIN] = "ota_begin",
+    [TRACE_OTA_CHUNK] = "ota_chunk",
+    [TRACE_OTA_END] = "ota_end",
+};
+
+/* Private functions */
+static void trace_print_task(void *param) {
+    trace_entry_t *entries = malloc(sizeof(trace_ring));
+    size_t count;
+
+    if (entries) {
+        count = trace_snapshot(entries, TRACE_ENTRIES);
+        for (size_t i = 0; i < count; i++) {
+            ESP_LOGI(TAG, "trace %5u %10" PRIu32 " us %-12s %" PRIu32
+                     " %" PRIu32, entries[i].seq, entries[i].ts_us,
+                     trace_id_name(entries[i].id), entries[i].arg0,
+                     entries[i].arg1);
+        }
+        free(entries);
+    }
+
+    trace_printing = false;
+    vTaskDelete(NULL);
+}
+
+/* Public functions */
+void trace_record(trace_id_t id, uint32_t arg0, uint32_t arg1) {
+    uint32_t seq = atomic_fetch_add_explicit(&trace_head, 1,
+                                             memory_order_relaxed);
+    trace_entry_t *e = &trace_ring[seq & (TRACE_ENTRIES - 1)];
+
+    e->ts_us = (uint32_t)esp_timer_get_time();
+    e->seq = (uint16_t)seq;
+    e->arg0 = arg0;
+    e->arg1 = arg1;
+    e->id = id;
+}
+
+/* Copies up to max entries, oldest first, and returns how many */
+size_t trace_snapshot(trace_entry_t *out, size_t max) {
+    uint32_t head = atomic_load_explicit(&trace_head, memory_order_relaxed);
+    uint32_t count = head < TRACE_ENTRIES ? head : TRACE_ENTRIES;
+
+    if (count > max) {
+        count = max;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        out[i] = trace_ring[(head - count + i) & (TRACE_ENTRIES - 1)];
+    }
+    return count;
+}
+
+const char *trace_id_name(uint16_t id) {
+    return id < TRACE_ID_COUNT ? trace_names[id] : "?";
+}
+
+/* Decode the ring to the console from a low-priority task */
+esp_err_t trace_print_async(void) {
+    if (trace_printing) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    trace_printing = true;
+    if (xTaskCreate(trace_print_task, "Trace Print", TRACE_PRINT_TASK_STACK,
+                    NULL, 1, NULL) != pdPASS) {
+        trace_printing = false;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,491 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+/* Includes */
+#include "transfer.h"
+#include "common.h"
+#include "fs_maint.h"
+#include "part_src.h"
+#include "storage.h"
+#include "storage_bench.h"
+#include "telemetry.h"
+#include "trace.h"
+#include "upload_writer.h"
+#include "esp_ota_ops.h"
+#include "esp_rom_crc.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include <inttypes.h>
+#include <stdlib.h>
+#include <sys/param.h>
+
+/*
+ * File transfer state machine
+ *      Everything behind the file_rw and file_offset characteristics:
+ *      OTA detection on the first chunk, queuing uploads to storage and
+ *      serving offset / Read Blob reads from the upload, a partition or
+ *      a memory buffer. It only sees os_mbufs and ATT error codes, never
+ *      GATT access contexts, so the host build can drive it directly.
+ */
+
+/* Where reads are served from */
+typedef enum {
+    READ_SRC_FILE,
+    READ_SRC_PARTITION,
+    READ_SRC_MEMORY,
+} read_src_t;
+
+/* Private variables */
+static uint32_t file_read_offset = 0;
+static esp_ota_handle_t ota_handle = 0;
+static const esp_partition_t *ota_partition = NULL;
+static bool is_ota_active = false;
+static bool first_chunk = true;
+static uint32_t last_read_pos = UINT32_MAX;
+static read_src_t read_src = READ_SRC_FILE;
+
+/* Heap buffer served by READ_SRC_MEMORY (trace dump, latency CSV) */
+static uint8_t *mem_src = NULL;
+static size_t mem_src_len = 0;
+
+/*
+ * Read cache
+ *      Holds a window of upload.txt so that consecutive Read / Read Blob
+ *      requests are served from RAM instead of reopening the file for
+ *      every MTU-sized response.
+ */
+static uint8_t read_cache[TRANSFER_READ_CACHE_SIZE];
+static uint32_t read_cache_base = 0;
+static size_t read_cache_len = 0;
+static bool read_cache_valid = false;
+
+/* Private functions */
+static void mem_src_free(void) {
+    free(mem_src);
+    mem_src = NULL;
+    mem_src_len = 0;
+}
+
+static void read_cache_invalidate(void) {
+    read_cache_valid = false;
+    read_cache_len = 0;
+}
+
+/*
+ * Make sure the byte at pos is in the read cache.
+ * Returns the number of cached bytes available from pos, 0 on EOF
+ * or a negative value if the file could not be read.
+ */
+static int read_cache_fill(uint32_t pos) {
+    if (read_cache_valid && pos >= read_cache_base &&
+        pos < read_cache_base + read_cache_len) {
+        return read_cache_base + read_cache_len - pos;
+    }
+
+    /* Chunks still queued for the writer are not in storage yet */
+    upload_writer_sync();
+
+    int len = storage_get()->read(STORAGE_UPLOAD_OBJ, pos, read_cache,
+                                  sizeof(read_cache));
+    if (len < 0) {
+        ESP_LOGE(TAG, "Failed to read %s at offset %" PRIu32,
+                 STORAGE_UPLOAD_OBJ, pos);
+        return -1;
+    }
+
+    read_cache_len = len;
+    read_cache_base = pos;
+    read_cache_valid = true;
+    return read_cache_len;
+}
+
+static int transfer_begin(const uint8_t *data) {
+    if (data[0] == 0xE9) {
+        ESP_LOGI(TAG, "Detected OTA image by magic byte");
+
+        ota_partition = esp_ota_get_next_update_partition(NULL);
+        if (!ota_partition) {
+            ESP_LOGE(TAG, "Failed to get OTA partition");
+            return BLE_ATT_ERR_UNLIKELY;
+        }
+
+        /* Erases the whole target partition up front */
+        int64_t start = esp_timer_get_time();
+        esp_err_t err =
+            esp_ota_begin(ota_partition, OTA_SIZE_UNKNOWN, &ota_handle);
+        telemetry_latency(TELEMETRY_HIST_FLASH_ERASE,
+                          esp_timer_get_time() - start);
+        TRACE(TRACE_OTA_BEGIN, ota_partition->address, err);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "esp_ota_begin failed: %s", esp_err_to_name(err));
+            return BLE_ATT_ERR_UNLIKELY;
+        }
+
+        is_ota_active = true;
+        ESP_LOGI(TAG, "OTA upload started to partition: %s",
+                 ota_partition->label);
+        return 0;
+    }
+
+    ESP_LOGI(TAG, "Not OTA image, defaulting to file write mode");
+
+    /* The bench task owns the backend's single writer until it is done */
+    if (storage_bench_running()) {
+        ESP_LOGE(TAG, "Storage bench running, upload refused");
+        first_chunk = true;
+        return BLE_ATT_ERR_UNLIKELY;
+    }
+
+    transfer_finish_upload();
+    esp_err_t err = storage_get()->write_begin(STORAGE_UPLOAD_OBJ);
+    TRACE(TRACE_UPLOAD_BEGIN, err, 0);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create upload.txt");
+        return BLE_ATT_ERR_UNLIKELY;
+    }
+    upload_writer_begin(storage_get());
+    fs_maint_session(true);
+    ESP_LOGI(TAG, "Created upload.txt for writing on %s", storage_get()->name);
+    is_ota_active = false;
+    return 0;
+}
+
+/* Length and CRC-32 of the stored upload, walked through the read cache */
+static esp_err_t upload_info(uint32_t *size, uint32_t *crc) {
+    upload_writer_sync();
+    int32_t len = storage_get()->size(STORAGE_UPLOAD_OBJ);
+    *size = len < 0 ? 0 : len;
+    if (!crc) {
+        return ESP_OK;
+    }
+
+    /* The cache is refilled on demand */
+    uint32_t sum = 0;
+    for (uint32_t pos = 0; pos < *size;) {
+        int avail = read_cache_fill(pos);
+        if (avail <= 0) {
+            return ESP_FAIL;
+        }
+        sum = esp_rom_crc32_le(sum, read_cache + (pos - read_cache_base), avail);
+        pos += avail;
+    }
+    *crc = sum;
+    return ESP_OK;
+}
+
+/* Public functions */
+/* Commit the upload in progress, if any; returns the first write error */
+esp_err_t transfer_finish_upload(void) {
+    const storage_backend_t *backend = upload_writer_backend();
+    esp_err_t err = ESP_OK;
+
+    if (backend) {
+        err = upload_writer_end();
+        TRACE(TRACE_UPLOAD_END, err, 0);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to commit %s to %s", STORAGE_UPLOAD_OBJ,
+                     backend->name);
+        }
+        fs_maint_session(false);
+    }
+    return err;
+}
+
+/*
+ * END command: drain the queued chunks, commit the upload and report
+ * what reached storage. Chunks are acknowledged before they are written,
+ * so this is where the client learns about flash errors. The next chunk
+ * written to file_rw starts a new upload.
+ */
+esp_err_t transfer_end_upload(uint32_t *size, uint32_t *crc) {
+    if (!upload_writer_backend()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t err = transfer_finish_upload();
+    first_chunk = true;
+    read_cache_invalidate();
+    if (err != ESP_OK) {
+        return err;
+    }
+    return upload_info(size, crc);
+}
+
+void transfer_complete_ota(void) {
+    if (is_ota_active) {
+        esp_err_t err = esp_ota_end(ota_handle);
+        TRACE(TRACE_OTA_END, err, 0);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "esp_ota_end failed: %s", esp_err_to_name(err));
+            return;
+        }
+
+        err = esp_ota_set_boot_partition(ota_partition);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "esp_ota_set_boot_partition failed: %s",
+                     esp_err_to_name(err));
+            return;
+        }
+
+        ESP_LOGI(TAG, "OTA complete. Rebooting...");
+        vTaskDelay(1000 / portTICK_PERIOD_MS);
+        esp_restart();
+    }
+}
+
+/* Called on every new connection */
+void transfer_reset(void) {
+    // Reset state
+    is_ota_active = false;
+    last_read_pos = UINT32_MAX;
+    first_chunk = true;
+    read_cache_invalidate();
+    part_src_close();
+    mem_src_free();
+    read_src = READ_SRC_FILE;
+    transfer_finish_upload();
+    if (ota_handle) {
+        esp_ota_end(ota_handle);
+        ota_handle = 0;
+    }
+    // Check extension
+    const char *ota_path = "/spiffs/upload.bin";
+    const char *ext = strrchr(ota_path, '.');
+
+    if (ext && strcmp(ext, ".bin") == 0) {
+        ota_partition = esp_ota_get_next_update_partition(NULL);
+        if (!ota_partition) {
+            ESP_LOGE(TAG, "Failed to get OTA partition");
+            return;
+        }
+
+        esp_err_t err =
+            esp_ota_begin(ota_partition, OTA_SIZE_UNKNOWN, &ota_handle);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "esp_ota_begin failed: %s", esp_err_to_name(err));
+            return;
+        }
+
+        is_ota_active = true;
+        ESP_LOGI(TAG, "OTA upload started to partition: %s",
+                 ota_partition->label);
+    } else if (!storage_bench_running()) {
+        const storage_backend_t *backend = storage_get();
+        if (backend->write_begin(STORAGE_UPLOAD_OBJ) == ESP_OK) {
+            backend->write_end();
+            ESP_LOGI(TAG, "File reset (truncated)");
+        }
+    }
+}
+
+/*
+ * One chunk written to file_rw_chr, rx is the time the access callback
+ * was entered. Returns 0 or an ATT error code.
+ */
+int transfer_write(struct os_mbuf *om, uint32_t rx) {
+    size_t len = OS_MBUF_PKTLEN(om);
+    read_cache_invalidate();
+
+    // Convert incoming BLE data to a flat buffer
+    uint8_t temp_buf[TRANSFER_CHUNK_MAX]; // enough for each BLE chunk
+    if (len > sizeof(temp_buf)) {
+        return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+    }
+
+    int rc = ble_hs_mbuf_to_flat(om, temp_buf, len, NULL);
+    if (rc != 0) {
+        return BLE_ATT_ERR_UNLIKELY;
+    }
+    telemetry_in(len);
+
+    // Only check for OTA on the first chunk
+    if (first_chunk) {
+        first_chunk = false;
+        rc = transfer_begin(temp_buf);
+        if (rc != 0) {
+            return rc;
+        }
+    }
+
+    if (is_ota_active && ota_handle != 0) {
+        if (len == 7 && memcmp(temp_buf, "OTA_END", 7) == 0) {
+            ESP_LOGI(TAG, "Received OTA_END signal from client");
+            transfer_complete_ota(); // reboot and finish
+            return 0;
+        }
+
+        int64_t start = esp_timer_get_time();
+        rc = esp_ota_write(ota_handle, temp_buf, len);
+        telemetry_latency(TELEMETRY_HIST_FLASH_WRITE,
+                          esp_timer_get_time() - start);
+        TRACE(TRACE_OTA_CHUNK, len, rc);
+        if (rc != ESP_OK) {
+            ESP_LOGE(TAG, "esp_ota_write failed: %s", esp_err_to_name(rc));
+            return BLE_ATT_ERR_UNLIKELY;
+        }
+
+        ESP_LOGD(TAG, "OTA chunk written: %zu bytes", len);
+        return 0;
+    }
+
+    if (!upload_writer_backend()) {
+        ESP_LOGE(TAG, "Failed to open file for writing");
+        return BLE_ATT_ERR_UNLIKELY;
+    }
+
+    /* Queued for the writer task, flash errors surface on a later chunk */
+    uint32_t seq;
+    esp_err_t err = upload_writer_submit(temp_buf, len, rx, &seq);
+    TRACE(TRACE_UPLOAD_CHUNK, len, err);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to write all data to file: %s",
+                 esp_err_to_name(err));
+        return BLE_ATT_ERR_UNLIKELY;
+    }
+
+    ESP_LOGD(TAG, "Queued %zu bytes for file", len);
+    upload_writer_ack(seq);
+    return 0;
+}
+
+/*
+ * Append up to len bytes of the current read source at pos to om.
+ * Returns the number of bytes appended, 0 at the end of the source or
+ * a negative ATT error code. Used for reads and notification streams.
+ */
+int transfer_read_at(struct os_mbuf *om, uint32_t pos, size_t len) {
+    size_t remaining = len;
+
+    if (read_src == READ_SRC_MEMORY) {
+        size_t n = pos < mem_src_len ? MIN(remaining, mem_src_len - pos) : 0;
+        if (n && os_mbuf_append(om, mem_src + pos, n) != 0) {
+            return -BLE_ATT_ERR_INSUFFICIENT_RES;
+        }
+        telemetry_out(n);
+        return n;
+    }
+
+    if (read_src == READ_SRC_PARTITION) {
+        /* Mapped flash goes straight into the response mbuf */
+        int n = part_src_append(om, pos, remaining);
+        if (n < 0) {
+            return -BLE_ATT_ERR_INSUFFICIENT_RES;
+        }
+        telemetry_out(n);
+        return n;
+    }
+
+    while (remaining > 0) {
+        int avail = read_cache_fill(pos);
+        if (avail < 0) {
+            return -BLE_ATT_ERR_UNLIKELY;
+        }
+        if (avail == 0) {
+            ESP_LOGD(TAG, "EOF reached");
+            break;
+        }
+
+        size_t n = MIN((size_t)avail, remaining);
+        if (os_mbuf_append(om, read_cache + (pos - read_cache_base), n) != 0) {
+            return -BLE_ATT_ERR_INSUFFICIENT_RES;
+        }
+
+        pos += n;
+        remaining -= n;
+    }
+
+    telemetry_out(len - remaining);
+    return len - remaining;
+}
+
+/*
+ * Plain reads and Read Blob requests both land here. The ATT offset is
+ * relative to the window selected with transfer_set_offset, so clients
+ * can walk a window with standard long reads and only move the offset
+ * to go to the next window. Appends at most mtu - 1 bytes to om, and
+ * nothing past BLE_ATT_ATTR_MAX_LEN: a window is one attribute value, so a
+ * long read ends there instead of walking the whole source.
+ */
+int transfer_read(struct os_mbuf *om, uint16_t att_offset, uint16_t mtu) {
+    uint32_t pos = file_read_offset + att_offset;
+
+    if (att_offset >= BLE_ATT_ATTR_MAX_LEN) {
+        return 0;
+    }
+
+    /* The peer asked for the same position again */
+    if (pos == last_read_pos) {
+        telemetry_retransmit();
+    }
+    last_read_pos = pos;
+    TRACE(TRACE_READ, pos, mtu - 1);
+
+    int n = transfer_read_at(om, pos,
+                             MIN(mtu - 1, BLE_ATT_ATTR_MAX_LEN - att_offset));
+    return n < 0 ? -n : 0;
+}
+
+/*
+ * Length of the current read source and, if crc is not NULL, its CRC-32
+ * (IEEE, same as zlib.crc32) so clients can check a download without
+ * guessing the end from short reads.
+ */
+esp_err_t transfer_source_info(uint32_t *size, uint32_t *crc) {
+    if (read_src == READ_SRC_MEMORY) {
+        *size = mem_src_len;
+        if (crc) {
+            *crc = esp_rom_crc32_le(0, mem_src, mem_src_len);
+        }
+        return ESP_OK;
+    }
+
+    if (read_src == READ_SRC_PARTITION) {
+        *size = part_src_size();
+        return crc ? part_src_crc32(crc) : ESP_OK;
+    }
+
+    return upload_info(size, crc);
+}
+
+void transfer_set_offset(uint32_t offset) {
+    file_read_offset = offset;
+    TRACE(TRACE_READ_OFFSET, offset, 0);
+    ESP_LOGD(TAG, "Set read offset to %" PRIu32, file_read_offset);
+}
+
+/* Serve reads from a raw flash partition */
+esp_err_t transfer_source_partition(const char *label) {
+    esp_err_t err = part_src_open(label);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    mem_src_free();
+    read_src = READ_SRC_PARTITION;
+    file_read_offset = 0;
+    return ESP_OK;
+}
+
+/* Serve reads from buf, allocated with malloc; it is freed by the next switch */
+void transfer_source_memory(void *buf, size_t len) {
+    mem_src_free();
+    part_src_close();
+    mem_src = buf;
+    mem_src_len = len;
+    read_src = READ_SRC_MEMORY;
+    file_read_offset = 0;
+}
+
+/* Serve reads from the upload again */
+void transfer_source_file(void) {
+    part_src_close();
+    mem_src_free();
+    read_src = READ_SRC_FILE;
+    file_read_offset = 0;
+    read_cache_invalidate();
+}
+
+/* The upload changed behind our back, e.g. another storage backend */
+void transfer_invalidate(void) { read_cache_invalidate(); }
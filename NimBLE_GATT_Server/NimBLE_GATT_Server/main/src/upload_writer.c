@@ -0,0 +1,215 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+/* Includes */
+#include "upload_writer.h"
+#include "common.h"
+#include "telemetry.h"
+#include "esp_timer.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include <inttypes.h>
+
+/*
+ * Upload writer
+ *      The GATT access callback copies each chunk into a free slot and
+ *      queues it; a separate task writes queued chunks to the storage
+ *      backend. The write response goes out without waiting for flash,
+ *      so a slow write or SPIFFS GC no longer holds up the host task
+ *      until all slots are in use. A write error is kept and returned
+ *      by the next submit or by upload_writer_end.
+ *
+ *      Every chunk gets a sequence number, and the time it reaches each
+ *      stage is kept for the last UPLOAD_LAT_CHUNKS chunks.
+ */
+
+/* Defines */
+#define UPLOAD_WRITER_TASK_STACK (4 * 1024)
+#define UPLOAD_WRITER_SLOT_WAIT_MS 2000
+
+typedef enum {
+    WRITER_OP_DATA,
+    WRITER_OP_SYNC,
+} writer_op_t;
+
+typedef struct {
+    uint8_t op;
+    uint8_t slot;
+    uint16_t len;
+    uint32_t seq;
+} writer_msg_t;
+
+/* Private variables */
+static uint8_t slots[UPLOAD_WRITER_SLOTS][UPLOAD_WRITER_CHUNK_MAX];
+static QueueHandle_t free_q = NULL;
+static QueueHandle_t work_q = NULL;
+static SemaphoreHandle_t sync_sem = NULL;
+static const storage_backend_t *backend = NULL;
+static volatile esp_err_t writer_err = ESP_OK;
+static uint32_t next_seq = 0;
+static upload_lat_t lat[UPLOAD_LAT_CHUNKS];
+
+/* Private functions */
+static inline uint32_t now_us(void) { return (uint32_t)esp_timer_get_time(); }
+
+static inline upload_lat_t *lat_slot(uint32_t seq) {
+    return &lat[seq % UPLOAD_LAT_CHUNKS];
+}
+
+static void upload_writer_task(void *param) {
+    writer_msg_t msg;
+
+    for (;;) {
+        xQueueReceive(work_q, &msg, portMAX_DELAY);
+        telemetry_queue_depth(uxQueueMessagesWaiting(work_q));
+
+        if (msg.op == WRITER_OP_SYNC) {
+            xSemaphoreGive(sync_sem);
+            continue;
+        }
+
+        upload_lat_t *l = lat_slot(msg.seq);
+        l->deq = now_us();
+        if (writer_err == ESP_OK) {
+            l->wr_start = now_us();
+            esp_err_t err = backend->write(slots[msg.slot], msg.len);
+            l->wr_end = now_us();
+            if (err != ESP_OK) {
+                ESP_LOGE(TAG, "upload chunk %" PRIu32 " write failed: %s",
+                         msg.seq, esp_err_to_name(err));
+                writer_err = err;
+            }
+        }
+        xQueueSend(free_q, &msg.slot, portMAX_DELAY);
+    }
+}
+
+/* Public functions */
+esp_err_t upload_writer_init(void) {
+    free_q = xQueueCreate(UPLOAD_WRITER_SLOTS, sizeof(uint8_t));
+    /* One extra entry so a sync marker always fits */
+    work_q = xQueueCreate(UPLOAD_WRITER_SLOTS + 1, sizeof(writer_msg_t));
+    sync_sem = xSemaphoreCreateBinary();
+    if (!free_q || !work_q || !sync_sem) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    for (uint8_t i = 0; i < UPLOAD_WRITER_SLOTS; i++) {
+        xQueueSend(free_q, &i, 0);
+    }
+
+    /* Below the NimBLE host task, which keeps receiving while we write */
+    if (xTaskCreate(upload_writer_task, "Upload Writer",
+                    UPLOAD_WRITER_TASK_STACK, NULL, 4, NULL) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+/* The caller has already opened the object with backend->write_begin */
+esp_err_t upload_writer_begin(const storage_backend_t *b) {
+    if (backend) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    writer_err = ESP_OK;
+    backend = b;
+    return ESP_OK;
+}
+
+esp_err_t upload_writer_submit(const uint8_t *data, size_t len, uint32_t rx,
+                               uint32_t *seq) {
+    writer_msg_t msg = {.op = WRITER_OP_DATA, .len = len};
+    upload_lat_t *l;
+
+    if (!backend) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (writer_err != ESP_OK) {
+        return writer_err;
+    }
+    if (len > UPLOAD_WRITER_CHUNK_MAX) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    /* All slots busy: flash is behind, hold the host task until one frees */
+    if (xQueueReceive(free_q, &msg.slot,
+                      pdMS_TO_TICKS(UPLOAD_WRITER_SLOT_WAIT_MS)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    memcpy(slots[msg.slot], data, len);
+    msg.seq = next_seq++;
+
+    l = lat_slot(msg.seq);
+    memset(l, 0, sizeof(*l));
+    l->seq = msg.seq;
+    l->len = len;
+    l->rx = rx;
+    l->enq = now_us();
+
+    xQueueSend(work_q, &msg, portMAX_DELAY);
+    l->depth = uxQueueMessagesWaiting(work_q);
+    telemetry_queue_depth(l->depth);
+
+    *seq = msg.seq;
+    return ESP_OK;
+}
+
+void upload_writer_ack(uint32_t seq) { lat_slot(seq)->ack = now_us(); }
+
+/* Wait until every queued chunk has reached the backend */
+esp_err_t upload_writer_sync(void) {
+    const writer_msg_t msg = {.op = WRITER_OP_SYNC};
+
+    if (!backend) {
+        return ESP_OK;
+    }
+    xQueueSend(work_q, &msg, portMAX_DELAY);
+    xSemaphoreTake(sync_sem, portMAX_DELAY);
+    return writer_err;
+}
+
+/* Drain the queue and commit the object */
+esp_err_t upload_writer_end(void) {
+    esp_err_t err;
+
+    if (!backend) {
+        return ESP_OK;
+    }
+
+    err = upload_writer_sync();
+    if (backend->write_end() != ESP_OK && err == ESP_OK) {
+        err = ESP_FAIL;
+    }
+    backend = NULL;
+    return err;
+}
+
+const storage_backend_t *upload_writer_backend(void) { return backend; }
+
+/*
+ * Latency records, oldest first, as CSV. Times are relative to rx, in us.
+ * Returns the length written, not counting the terminator.
+ */
+size_t upload_writer_csv(char *buf, size_t size) {
+    uint32_t first = next_seq > UPLOAD_LAT_CHUNKS ? next_seq - UPLOAD_LAT_CHUNKS
+                                                  : 0;
+    size_t pos;
+
+    pos = snprintf(buf, size, "seq,len,depth,rx,enq,ack,deq,wr_start,wr_end\n");
+    for (uint32_t seq = first; seq < next_seq && pos < size; seq++) {
+        const upload_lat_t *l = lat_slot(seq);
+
+#define REL(t) ((t) ? (int32_t)((t) - l->rx) : -1)
+        pos += snprintf(buf + pos, size - pos,
+                        "%" PRIu32 ",%u,%u,%" PRIu32 ",%" PRId32 ",%" PRId32
+                        ",%" PRId32 ",%" PRId32 ",%" PRId32 "\n",
+                        l->seq, l->len, l->depth, l->rx, REL(l->enq),
+                        REL(l->ack), REL(l->deq), REL(l->wr_start),
+                        REL(l->wr_end));
+#undef REL
+    }
+    return pos < size ? pos : size - 1;
+}
@@ -0,0 +1,557 @@
+"""Transports for esp32_ble_rw.py.
+
+BleakTransport talks to a real ESP32. SimTransport runs an in-process model
+of the NimBLE GATT server (same characteristics, same control commands) with
+a configurable MTU, connection interval and packet loss, so client changes
+can be developed and timed without Bluetooth hardware.
+
+Both expose the subset of the BleakClient API the client uses:
+write_gatt_char, read_gatt_char, start_notify / stop_notify, mtu_size and
+async with. The factories
+returned by parse_transport_args create them per connection and scan for
+devices.
+"""
+import asyncio
+import collections
+import hashlib
+import random
+import struct
+import sys
+import zlib
+
+# ESP32 MAC address
+DEVICE_ADDRESS = "14:2b:2f:da:dc:5e"
+DEVICE_NAME = "NimBLE_GATT"   # advertised name, see DEVICE_NAME in common.h
+
+# UUIDs for GATT characteristics
+FILE_RW_CHAR_UUID = "00001526-1212-efde-1523-785feabcd123"     # Read/write file data
+OFFSET_CHAR_UUID = "00001527-1212-efde-1523-785feabcd123"      # Set read offset
+CTRL_CHAR_UUID = "00001528-1212-efde-1523-785feabcd123"        # Control commands
+TELEMETRY_CHAR_UUID = "00001529-1212-efde-1523-785feabcd123"   # Transfer telemetry
+STATS_CHAR_UUID = "0000152a-1212-efde-1523-785feabcd123"       # Task / heap stats
+
+
+# --- Real hardware ---
+class BleakTransport:
+    def __init__(self, address=DEVICE_ADDRESS, adapter=None):
+        self.address = address
+        self.adapter = adapter
+        self.client = None
+
+    async def __aenter__(self):
+        # Imported here so the simulator works without bleak installed
+        from bleak import BleakClient
+        kwargs = {"adapter": self.adapter} if self.adapter else {}
+        self.client = BleakClient(self.address, **kwargs)
+        await self.client.connect()
+        return self
+
+    async def __aexit__(self, *exc):
+        await self.client.disconnect()
+
+    @property
+    def mtu_size(self):
+        return self.client.mtu_size
+
+    async def write_gatt_char(self, uuid, data, response=None):
+        # None keeps bleak's own default
+        if response is None:
+            await self.client.write_gatt_char(uuid, data)
+        else:
+            await self.client.write_gatt_char(uuid, data, response=response)
+
+    async def read_gatt_char(self, uuid):
+        return await self.client.read_gatt_char(uuid)
+
+    def supports_write_without_response(self, uuid):
+        char = self.client.services.get_characteristic(uuid)
+        return char is not None and "write-without-response" in char.properties
+
+    def supports_notify(self, uuid):
+        char = self.client.services.get_characteristic(uuid)
+        return char is not None and "notify" in char.properties
+
+    async def start_notify(self, uuid, callback):
+        await self.client.start_notify(uuid, lambda _char, data: callback(bytes(data)))
+
+    async def stop_notify(self, uuid):
+        await self.client.stop_notify(uuid)
+
+
+class BleakFactory:
+    reboot_wait = 5.0    # OTA_END to advertising again
+
+    def __init__(self, address=DEVICE_ADDRESS):
+        self.address = address
+
+    def __call__(self, address=None, adapter=None):
+        return BleakTransport(address or self.address, adapter)
+
+    async def scan(self, timeout=5.0, adapter=None):
+        from bleak import BleakScanner
+        kwargs = {"adapter": adapter} if adapter else {}
+        found = await BleakScanner.discover(timeout=timeout, **kwargs)
+        return sorted(d.address for d in found
+                      if (d.name or "").startswith(DEVICE_NAME))
+
+
+# --- Simulated peripheral ---
+ATT_MAX_VALUE = 512          # longest attribute value a long read returns
+OTA_MAGIC = 0xE9
+CTRL_RSP_MAX = 256
+
+# Mirrors the notification pump in gatt_svc.c
+STREAM_WINDOW = 4
+STREAM_RETRY_S = 0.005
+TX_BUFS = 12                 # ACL buffers notifications wait in
+
+# Characteristics declared with BLE_GATT_CHR_F_WRITE_NO_RSP / _NOTIFY
+WRITE_NO_RSP_UUIDS = (FILE_RW_CHAR_UUID,)
+NOTIFY_UUIDS = (FILE_RW_CHAR_UUID, TELEMETRY_CHAR_UUID)
+
+# Mirrors partitions.csv
+PARTITIONS = {"nvs": 0x6000, "phy_init": 0x1000, "factory": 0x100000,
+              "ota_0": 0x100000, "ota_1": 0x100000, "otadata": 0x2000,
+              "spiffs": 0x50000, "rawlog": 0x9E000}
+STORES = ("spiffs", "littlefs", "rawlog")
+DUMP_ALLOWED = ("factory", "ota_0", "ota_1", "spiffs", "rawlog")
+
+# Mirrors telemetry_t / sys_stats_t header in main/include
+TELEMETRY_FMT = "<BBBBHHIIIIIIHHIII16I16I"
+STATS_HDR_FMT = "<BBBBII" + "III" * 2
+
+
+class SimError(Exception):
+    """An ATT error response, or the link dropping."""
+
+
+def sim_image(body):
+    """An app image as esptool writes it, SHA-256 of the rest appended."""
+    return body + hashlib.sha256(body).digest()
+
+
+class SimDevice:
+    """Device side state; it survives reconnects like the real firmware."""
+
+    def __init__(self, factory_image=sim_image(b"\xe9sim factory image")):
+        self.upload = bytearray()
+        self.flash = {"factory": bytearray(factory_image)}
+        self.boot = "factory"
+        self.store = "spiffs"
+        self.session = 0
+        self.restarts = 0
+        self.ctrl_rsp = b"OK"
+        self.bytes_in = self.bytes_out = 0
+        self.chunks_in = self.chunks_out = 0
+        self.retransmits = 0
+        self.rebooting = False
+        self.connect(23, 0)
+        self.session = 0
+
+    # Same as transfer_reset() on the device
+    def connect(self, mtu, itvl):
+        self.mtu = mtu
+        self.itvl = itvl
+        self.session += 1
+        self.first_chunk = True
+        self.ota = None
+        self.read_offset = 0
+        self.read_src = None         # None = upload, else a partition label
+        self.last_read_pos = None
+        self.subscribed = False      # file_rw notifications enabled
+
+    def source(self):
+        if self.read_src is None:
+            return self.upload, len(self.upload)
+        return self.flash.get(self.read_src, b""), PARTITIONS[self.read_src]
+
+    def source_at(self, pos, n):
+        data, size = self.source()
+        n = max(0, min(n, size - pos))
+        chunk = bytes(data[pos:pos + n])
+        chunk += b"\xff" * (n - len(chunk))          # erased flash
+        self.bytes_out += len(chunk)
+        self.chunks_out += 1
+        return chunk
+
+    def source_info(self):
+        data, size = self.source()
+        return f"{size} {zlib.crc32(self.source_at(0, size)):08x}"
+
+    def write_file(self, data):
+        self.bytes_in += len(data)
+        self.chunks_in += 1
+        if self.first_chunk:
+            self.first_chunk = False
+            if data[0] == OTA_MAGIC:
+                self.ota = "ota_1" if self.boot == "ota_0" else "ota_0"
+                self.flash[self.ota] = bytearray()   # erase
+            else:
+                self.upload = bytearray()
+
+        if self.ota:
+            if data == b"OTA_END":
+                self.boot = self.ota
+                self.restarts += 1
+                self.rebooting = True
+                return
+            image = self.flash[self.ota]
+            if len(image) + len(data) > PARTITIONS[self.ota]:
+                raise SimError("ATT error 0x0e")
+            image.extend(data)
+        else:
+            self.upload.extend(data)
+
+    # One Read / Read Blob PDU of the file_rw characteristic, the value
+    # ends at ATT_MAX_VALUE like transfer_read()
+    def read_file(self, att_offset):
+        if att_offset >= ATT_MAX_VALUE:
+            return b""
+        pos = self.read_offset + att_offset
+        if pos == self.last_read_pos:
+            self.retransmits += 1
+        self.last_read_pos = pos
+        return self.source_at(pos, min(self.mtu - 1, ATT_MAX_VALUE - att_offset))
+
+    def control(self, cmd):
+        name, _, args = cmd.decode(errors="replace").partition(" ")
+        if name == "DUMP":
+            if args not in PARTITIONS:
+                return f"ERR no partition {args}"
+            if args not in DUMP_ALLOWED:
+                return f"ERR not allowed {args}"
+            self.read_src = args
+            self.read_offset = 0
+            return f"OK {args} {self.source_info()}"
+        if name == "FILE":
+            self.read_src = None
+            self.read_offset = 0
+            return f"OK upload.txt {self.source_info()}"
+        if name == "END":
+            if self.first_chunk or self.ota:
+                return "ERR no upload"
+            self.first_chunk = True
+            return f"OK upload.txt {len(self.upload)} {zlib.crc32(self.upload):08x}"
+        if name == "STREAM":
+            if not self.subscribed:
+                return "ERR not subscribed"
+            size = self.source()[1]
+            return f"OK {min(int(args or 0), size)} {size}"
+        if name == "INFO":
+            # esp_partition_get_sha256(): the digest appended to the image
+            image = hashlib.sha256(self.flash.get(self.boot, b"")[:-32]).hexdigest()
+            return f"OK {self.boot} sim {image}"
+        if name == "STORE":
+            if args and args not in STORES:
+                return f"ERR no backend {args}"
+            self.store = args or self.store
+            return f"OK {self.store}"
+        return f"ERR unknown command {name}"
+
+    def telemetry(self):
+        return struct.pack(TELEMETRY_FMT, 1, 2, 2, 0, self.mtu,
+                           int(self.itvl / 1.25), self.session,
+                           self.bytes_in, self.bytes_out, self.chunks_in,
+                           self.chunks_out, self.retransmits, 0, 0, 0, 0, 0,
+                           *([0] * 32))
+
+    def stats(self):
+        return struct.pack(STATS_HDR_FMT, 1, 0, 2, 0, 0, 1000, *([0] * 6))
+
+
+class SimTransport:
+    """Link layer model: every ATT request/response pair takes one
+    connection interval, every lost PDU one more (the link layer
+    retransmits, ATT never sees the loss). Writes without response and
+    notifications need no response, so up to ppe of them share a
+    connection event."""
+
+    def __init__(self, device, mtu=247, itvl_ms=30.0, loss=0.0, seed=None,
+                 ppe=4, drop=0.0, verbose=True):
+        self.device = device
+        self.mtu = mtu
+        self.itvl_ms = itvl_ms
+        self.loss = loss
+        self.ppe = ppe
+        self.drop = drop
+        self.verbose = verbose
+        self.rng = random.Random(seed)
+        self.connected = False
+        self.exchanges = 0
+        self.lost = 0
+        self.air_s = 0.0
+        self.notify_cbs = {}
+        self.stream_pos = self.stream_end = 0
+        self.stream_inflight = 0
+        self.stream_pumping = False
+        self.stream_resume_at = None
+        self.tx_queue = collections.deque()
+        self.tx_task = None
+
+    async def __aenter__(self):
+        await self._exchange(3)     # connect, MTU exchange, discovery
+        self.device.connect(self.mtu, self.itvl_ms)
+        self.connected = True
+        return self
+
+    async def __aexit__(self, *exc):
+        self._stream_stop()
+        self.connected = False
+        self.device.subscribed = False
+        if self.verbose:
+            print(f"[sim] mtu={self.mtu} itvl={self.itvl_ms}ms loss={self.loss:.1%}: "
+                  f"{self.exchanges} exchanges, {self.lost} lost PDUs, "
+                  f"{self.air_s:.2f}s on air", file=sys.stderr)
+
+    @property
+    def mtu_size(self):
+        return self.mtu
+
+    async def _exchange(self, count=1, pdus=2, share=1):
+        events = 0
+        for _ in range(count):
+            events += 1
+            for _pdu in range(pdus):
+                while self.loss and self.rng.random() < self.loss:
+                    self.lost += 1
+                    events += 1
+        self.exchanges += count
+        delay = events * self.itvl_ms / 1000 / share
+        self.air_s += delay
+        await asyncio.sleep(delay)
+        # Supervision timeout: the link is gone, ATT gets no response
+        if self.drop and self.rng.random() < self.drop * count:
+            self.connected = False
+            raise SimError("link lost")
+
+    def _check(self):
+        if not self.connected:
+            raise SimError("not connected")
+
+    async def write_gatt_char(self, uuid, data, response=None):
+        self._check()
+        data = bytes(data)
+        if len(data) > ATT_MAX_VALUE:
+            raise SimError("ATT error 0x0d")
+        # Values longer than one PDU go out as Prepare Write + Execute
+        if response is False:
+            if uuid not in WRITE_NO_RSP_UUIDS or len(data) > self.mtu - 3:
+                raise SimError(f"write without response not permitted on {uuid}")
+            await self._exchange(pdus=1, share=self.ppe)
+        elif len(data) <= self.mtu - 3:
+            await self._exchange()
+        else:
+            await self._exchange(-(-len(data) // (self.mtu - 5)) + 1)
+
+        if uuid == FILE_RW_CHAR_UUID:
+            self.device.write_file(data)
+        elif uuid == OFFSET_CHAR_UUID:
+            if len(data) != 4:
+                raise SimError("ATT error 0x0d")
+            self.device.read_offset = int.from_bytes(data, "little")
+        elif uuid == CTRL_CHAR_UUID:
+            rsp = self.device.control(data)
+            self.device.ctrl_rsp = rsp.encode()[:CTRL_RSP_MAX - 1]
+            # FILE, DUMP and STREAM end a running stream on the device
+            name = data.split(b" ")[0]
+            if name in (b"FILE", b"DUMP", b"STREAM"):
+                self._stream_stop()
+            if name == b"STREAM" and rsp.startswith("OK"):
+                self.stream_pos, self.stream_end = map(int, rsp.split()[1:3])
+                self.stream_inflight = 0
+                self._stream_pump()
+        else:
+            raise SimError(f"write not permitted on {uuid}")
+
+        # The firmware reboots into the new image, dropping the link
+        if self.device.rebooting:
+            self.device.rebooting = False
+            self.connected = False
+
+    def supports_write_without_response(self, uuid):
+        return uuid in WRITE_NO_RSP_UUIDS
+
+    def supports_notify(self, uuid):
+        return uuid in NOTIFY_UUIDS
+
+    async def start_notify(self, uuid, callback):
+        self._check()
+        if uuid not in NOTIFY_UUIDS:
+            raise SimError(f"notify not permitted on {uuid}")
+        await self._exchange()      # CCCD write
+        self.notify_cbs[uuid] = callback
+        if uuid == FILE_RW_CHAR_UUID:
+            self.device.subscribed = True
+
+    async def stop_notify(self, uuid):
+        self._check()
+        await self._exchange()
+        self.notify_cbs.pop(uuid, None)
+        if uuid == FILE_RW_CHAR_UUID:
+            self._stream_stop()
+            self.device.subscribed = False
+
+    def _stream_stop(self):
+        self.stream_pos = self.stream_end = 0
+        self.tx_queue.clear()
+        if self.tx_task:
+            self.tx_task.cancel()
+            self.tx_task = None
+
+    # Same pump as the firmware, see stream_pump() in gatt_svc.c
+    def _stream_pump(self):
+        if self.stream_pumping:
+            return
+        self.stream_pumping = True
+        while (self.stream_inflight < STREAM_WINDOW
+               and self.stream_pos < self.stream_end):
+            if len(self.tx_queue) >= TX_BUFS:
+                self._stream_schedule(STREAM_RETRY_S)
+                break
+            chunk = self.device.source_at(self.stream_pos,
+                                          min(self.mtu - 3,
+                                              self.stream_end - self.stream_pos))
+            self.stream_pos += len(chunk)
+            self.stream_inflight += 1
+            if not self._notify(chunk):
+                self._stream_stop()
+                break
+        self.stream_pumping = False
+
+    def _stream_resume(self):
+        self.stream_resume_at = None
+        self.stream_inflight = 0
+        self._stream_pump()
+
+    def _stream_schedule(self, delay=0):
+        if not self.stream_resume_at:
+            loop = asyncio.get_running_loop()
+            self.stream_resume_at = loop.call_later(delay, self._stream_resume)
+
+    # ble_gatts_notify_custom(): queue the PDU, then raise NOTIFY_TX
+    # before returning, as NimBLE does
+    def _notify(self, chunk):
+        status = 0 if self.connected else 1
+        if status == 0:
+            self.tx_queue.append(chunk)
+            if not self.tx_task:
+                self.tx_task = asyncio.ensure_future(self._send_notifications())
+        self._notify_tx(status)
+        return status == 0
+
+    def _notify_tx(self, status):
+        if status != 0:
+            self._stream_stop()
+        elif self.stream_pos < self.stream_end:
+            self._stream_schedule()
+
+    async def _send_notifications(self):
+        callback = self.notify_cbs[FILE_RW_CHAR_UUID]
+        try:
+            while self.tx_queue:
+                await self._exchange(pdus=1, share=self.ppe)
+                callback(self.tx_queue.popleft())
+        except SimError:
+            self.tx_queue.clear()
+            self.stream_pos = self.stream_end = 0
+        self.tx_task = None
+
+    async def read_gatt_char(self, uuid):
+        self._check()
+        if uuid == FILE_RW_CHAR_UUID:
+            read = self.device.read_file
+        else:
+            if uuid == CTRL_CHAR_UUID:
+                value = self.device.ctrl_rsp
+            elif uuid == TELEMETRY_CHAR_UUID:
+                value = self.device.telemetry()
+            elif uuid == STATS_CHAR_UUID:
+                value = self.device.stats()
+            else:
+                raise SimError(f"read not permitted on {uuid}")
+            def read(att_offset):
+                return value[att_offset:att_offset + self.mtu - 1]
+
+        # Long read: Read, then Read Blob while responses are full
+        data = bytearray()
+        while True:
+            await self._exchange()
+            chunk = read(len(data))
+            data.extend(chunk)
+            if len(chunk) < self.mtu - 1 or len(data) >= ATT_MAX_VALUE:
+                return bytes(data[:ATT_MAX_VALUE])
+
+
+class SimFactory:
+    """A fleet of simulated devices. Devices alternate between two
+    factory images so fleet runs see more than one firmware group."""
+
+    reboot_wait = 0.1
+
+    def __init__(self, count=1, **link):
+        self.devices = {}
+        for i in range(count):
+            image = sim_image(b"\xe9sim factory image " + (b"A" if i % 2 == 0 else b"B"))
+            self.devices[f"SIM:00:00:00:00:{i:02X}"] = SimDevice(image)
+        self.default = next(iter(self.devices))
+        self.link = link
+        self.connections = 0
+
+    def __call__(self, address=None, adapter=None):
+        device = self.devices.get(address or self.default)
+        if device is None:
+            raise SimError(f"no device {address}")
+        self.connections += 1
+        seed = self.link.get("seed")
+        link = dict(self.link, seed=None if seed is None else seed + self.connections,
+                    verbose=len(self.devices) == 1)
+        return SimTransport(device, **link)
+
+    async def scan(self, timeout=5.0, adapter=None):
+        await asyncio.sleep(min(timeout, 0.1))
+        return sorted(self.devices)
+
+
+# --- Command line ---
+TRANSPORT_USAGE = ("[--address MAC] | [--sim [--mtu N] [--itvl MS] "
+                   "[--loss P] [--ppe N] [--drop P] [--devices N] [--seed N]]")
+
+
+def parse_transport_args(argv):
+    """Pull the transport options out of argv.
+
+    Returns (factory, remaining argv); factory() gives a new transport
+    for every connection the client opens.
+    """
+    opts = {"--address": DEVICE_ADDRESS, "--mtu": "247", "--itvl": "30",
+            "--loss": "0", "--ppe": "4", "--drop": "0", "--devices": "1",
+            "--seed": None}
+    sim = False
+    rest = []
+    args = iter(argv)
+    for arg in args:
+        if arg == "--sim":
+            sim = True
+        elif arg in opts:
+            opts[arg] = next(args, None)
+            if opts[arg] is None:
+                raise SystemExit(f"Missing value for {arg}")
+        else:
+            rest.append(arg)
+
+    if not sim:
+        return BleakFactory(opts["--address"]), rest
+
+    mtu = int(opts["--mtu"])
+    itvl = float(opts["--itvl"])
+    loss = float(opts["--loss"])
+    ppe = int(opts["--ppe"])
+    drop = float(opts["--drop"])
+    devices = int(opts["--devices"])
+    seed = int(opts["--seed"]) if opts["--seed"] is not None else None
+    if (not 23 <= mtu <= 517 or not 7.5 <= itvl <= 4000 or not 0 <= loss < 1
+            or ppe < 1 or not 0 <= drop < 1 or not 1 <= devices <= 255):
+        raise SystemExit("--mtu 23..517, --itvl 7.5..4000 ms, --loss 0..<1, "
+                         "--ppe >= 1, --drop 0..<1, --devices 1..255")
+    return SimFactory(devices, mtu=mtu, itvl_ms=itvl, loss=loss, seed=seed,
+                      ppe=ppe, drop=drop), rest
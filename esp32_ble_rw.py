@@ -1,67 +1,588 @@
 import asyncio
+import hashlib
+import io
 import sys
 import os
-from bleak import BleakClient
+import struct
+import time
+import zlib
+from ble_transport import (CTRL_CHAR_UUID, FILE_RW_CHAR_UUID, OFFSET_CHAR_UUID,
+                           STATS_CHAR_UUID, TELEMETRY_CHAR_UUID,
+                           TRANSPORT_USAGE, BleakFactory,
+                           parse_transport_args)
 
-# ESP32 MAC address
-DEVICE_ADDRESS = "14:2b:2f:da:dc:5e"
+# Creates the transport for each connection, replaced by --sim
+connect = BleakFactory()
 
-# UUIDs for GATT characteristics
-FILE_RW_CHAR_UUID = "00001526-1212-efde-1523-785feabcd123"     # Read/write file data
-OFFSET_CHAR_UUID = "00001527-1212-efde-1523-785feabcd123"      # Set read offset
+# --- Upload ---
+ATT_MAX_VALUE = 512      # longest value a single write may carry
+UPLOAD_INFLIGHT = 8      # writes without response between acknowledged writes
+UPLOAD_READ_AHEAD = 16   # chunks read ahead from disk
+UPLOAD_RETRIES = 3
 
-CHUNK_SIZE = 500  # Must match ESP32 chunk size
+class Progress:
+    def __init__(self, total, label, quiet=False):
+        self.total = total
+        self.label = label
+        self.quiet = quiet
+        self.done = 0
+        self.retries = 0
+        self.start = time.monotonic()
+        self.last_print = 0
 
-# --- Upload ---
-async def write_file(client, filepath):
-    with open(filepath, "rb") as f:
-        data = f.read()
+    def elapsed(self):
+        return time.monotonic() - self.start
+
+    def add(self, n):
+        self.done += n
+        now = time.monotonic()
+        if self.quiet:
+            return
+        if now - self.last_print >= 0.5 or self.done >= self.total:
+            self.last_print = now
+            rate = self.done / max(self.elapsed(), 1e-6)
+            eta = (self.total - self.done) / rate if rate else 0
+            print(f"\r{self.label} {self.done}/{self.total} bytes "
+                  f"{rate / 1024:7.1f} KiB/s  ETA {eta:5.1f}s  "
+                  f"retries {self.retries}", end="", flush=True)
+
+async def read_chunks(f, chunk_size, queue):
+    while True:
+        chunk = f.read(chunk_size)
+        if not chunk:
+            break
+        await queue.put(chunk)
+    await queue.put(None)
+
+# How the backends report an ATT Error Response: BlueZ, WinRT, CoreBluetooth, --sim
+ATT_ERROR_MARKERS = ("att error", "protocol error", "cbatterrordomain")
+
+def is_att_error(e):
+    return any(m in str(e).lower() for m in ATT_ERROR_MARKERS)
+
+async def write_chunk(client, chunk, response, progress):
+    # The device appends every chunk it accepts. Only a write it answered
+    # with an ATT Error Response is known not to have been appended; after
+    # a timeout or a dropped link it may have been, so that is not retried
+    # (and neither is a write without response, which gets no answer).
+    for attempt in range(UPLOAD_RETRIES + 1):
+        try:
+            await client.write_gatt_char(FILE_RW_CHAR_UUID, chunk, response=response)
+            return
+        except Exception as e:
+            if attempt == UPLOAD_RETRIES or not response or not is_att_error(e):
+                raise
+            progress.retries += 1
+            await asyncio.sleep(0.05 * (attempt + 1))
+
+def upload_mode(client, inflight):
+    """Chunk size and writes in flight this connection supports."""
+    chunk_size = min(client.mtu_size - 3, ATT_MAX_VALUE)
+    if inflight > 1 and not client.supports_write_without_response(FILE_RW_CHAR_UUID):
+        inflight = 1
+    return chunk_size, inflight
+
+async def send_stream(client, f, chunk_size, inflight, progress):
+    queue = asyncio.Queue(maxsize=UPLOAD_READ_AHEAD)
+    reader = asyncio.ensure_future(read_chunks(f, chunk_size, queue))
+    chunks = 0
+
+    try:
+        chunk = await queue.get()
+        while chunk is not None:
+            following = await queue.get()
+            # Writes without response are sent in order on the same bearer;
+            # every inflight-th chunk and the last one is acknowledged, so at
+            # most inflight chunks are ever unconfirmed
+            chunks += 1
+            response = inflight == 1 or chunks % inflight == 0 or following is None
+            await write_chunk(client, chunk, response, progress)
+            progress.add(len(chunk))
+            chunk = following
+    finally:
+        reader.cancel()
+    return chunks
 
-    print(f"Sending {len(data)} bytes...")
-    for i in range(0, len(data), CHUNK_SIZE):
-        chunk = data[i:i+CHUNK_SIZE]
-        await client.write_gatt_char(FILE_RW_CHAR_UUID, chunk)
+async def send_ota_end(client, quiet=False):
+    # The device reboots from inside the write, the response may never come
+    try:
+        await client.write_gatt_char(FILE_RW_CHAR_UUID, b"OTA_END")
+    except Exception as e:
+        if not quiet:
+            print(f"OTA_END: {e} (device rebooting)")
+
+async def end_upload(client, size, crc):
+    """Commit the upload; False unless the device stored size bytes with crc.
+
+    Chunks are acknowledged before they reach flash, so END is the only
+    place a write error on the device shows up."""
+    try:
+        await client.write_gatt_char(CTRL_CHAR_UUID, b"END")
+    except Exception:
+        pass    # refused with an ATT error, the reason is in the response
+    rsp = (await client.read_gatt_char(CTRL_CHAR_UUID)).decode()
+    parts = rsp.split()
+    if len(parts) < 4 or parts[0] != "OK":
+        print(f"Upload failed: {rsp}")
+        return False
+    if int(parts[2]) != size or int(parts[3], 16) != crc:
+        print(f"Upload failed: device stored {parts[2]} bytes crc={parts[3]}, "
+              f"sent {size} bytes crc={crc:08x}")
+        return False
+    return True
+
+async def write_file(client, filepath, inflight=UPLOAD_INFLIGHT):
+    size = os.path.getsize(filepath)
+    chunk_size, inflight = upload_mode(client, inflight)
+    mode = "no-rsp" if inflight > 1 else "rsp"
+
+    print(f"Sending {size} bytes in {chunk_size} byte chunks ({mode}, {inflight} in flight)...")
+    progress = Progress(size, "Upload")
+    with open(filepath, "rb") as f:
+        chunks = await send_stream(client, f, chunk_size, inflight, progress)
+    print()
 
     # If it's a .bin file, send OTA_END to trigger esp_restart()
     if filepath.lower().endswith(".bin"):
         print("Sending OTA_END signal...")
-        await client.write_gatt_char(FILE_RW_CHAR_UUID, b"OTA_END")
+        await send_ota_end(client)
+        ok = True
+    else:
+        with open(filepath, "rb") as f:
+            crc = zlib.crc32(f.read())
+        ok = await end_upload(client, size, crc)
 
-    print("File sent to ESP32!")
+    seconds = progress.elapsed()
+    if ok:
+        print("File sent to ESP32!")
+    print(f"UPLOAD bytes={size} chunks={chunks} chunk_size={chunk_size} "
+          f"mode={mode} inflight={inflight} retries={progress.retries} "
+          f"seconds={seconds:.3f} kib_s={size / 1024 / max(seconds, 1e-6):.1f}")
+    return ok
 
 # --- Download ---
-async def read_file(client, filepath):
-    data = bytearray()
-    offset = 0
+# FILE and DUMP answer "OK <name> <size> <crc32>", the download is written
+# to disk as it arrives and checked against both.
+DOWNLOAD_MODES = ("notify", "read")
+DOWNLOAD_STALL_S = 3.0   # no notification for this long: fall back to reads
 
-    while True:
-        # Send read offset to ESP32
-        offset_bytes = offset.to_bytes(4, byteorder='little')
-        await client.write_gatt_char(OFFSET_CHAR_UUID, offset_bytes)
+class DownloadSink:
+    def __init__(self, f, size, progress):
+        self.f = f
+        self.size = size
+        self.progress = progress
+        self.crc = 0
+
+    @property
+    def done(self):
+        return self.progress.done
+
+    def write(self, chunk):
+        chunk = chunk[:self.size - self.done]
+        self.f.write(chunk)
+        self.crc = zlib.crc32(chunk, self.crc)
+        self.progress.add(len(chunk))
+
+async def select_source(client, cmd):
+    await client.write_gatt_char(CTRL_CHAR_UUID, cmd.encode())
+    rsp = (await client.read_gatt_char(CTRL_CHAR_UUID)).decode()
+    parts = rsp.split()
+    if len(parts) < 4 or parts[0] != "OK":
+        raise RuntimeError(f"{cmd} failed: {rsp}")
+    return int(parts[2]), int(parts[3], 16)
 
-        # Read chunk
+async def receive_notify(client, sink):
+    # Notifications arrive in order; the device stops on its own at the end
+    queue = asyncio.Queue()
+    await client.start_notify(FILE_RW_CHAR_UUID, queue.put_nowait)
+    try:
+        await client.write_gatt_char(CTRL_CHAR_UUID, f"STREAM {sink.done}".encode())
+        rsp = (await client.read_gatt_char(CTRL_CHAR_UUID)).decode()
+        if not rsp.startswith("OK"):
+            return
+        while sink.done < sink.size:
+            try:
+                sink.write(await asyncio.wait_for(queue.get(), DOWNLOAD_STALL_S))
+            except asyncio.TimeoutError:
+                return
+    finally:
+        await client.stop_notify(FILE_RW_CHAR_UUID)
+
+async def receive_reads(client, sink):
+    # One long read (up to ATT_MAX_VALUE bytes) per offset window
+    while sink.done < sink.size:
+        await client.write_gatt_char(OFFSET_CHAR_UUID, sink.done.to_bytes(4, byteorder='little'))
         chunk = await client.read_gatt_char(FILE_RW_CHAR_UUID)
         if not chunk:
             break
+        sink.write(chunk)
+
+async def download(client, filepath, size, crc, mode="notify"):
+    if mode == "notify" and not client.supports_notify(FILE_RW_CHAR_UUID):
+        mode = "read"
+    print(f"Downloading {size} bytes ({mode})...")
+
+    progress = Progress(size, "Download")
+    with open(filepath, "wb") as f:
+        sink = DownloadSink(f, size, progress)
+        if mode == "notify":
+            await receive_notify(client, sink)
+            if sink.done < size:
+                print(f"\nStream stopped at {sink.done}, continuing with reads")
+                mode = "notify+read"
+        await receive_reads(client, sink)
+    print()
+
+    seconds = progress.elapsed()
+    ok = sink.done == size and sink.crc == crc
+    print(f"DOWNLOAD bytes={sink.done} mode={mode} seconds={seconds:.3f} "
+          f"kib_s={sink.done / 1024 / max(seconds, 1e-6):.1f} "
+          f"crc={sink.crc:08x} {'ok' if ok else f'expected {size} bytes crc={crc:08x}'}")
+    return ok
+
+async def read_file(client, filepath, mode="notify"):
+    size, crc = await select_source(client, "FILE")
+    if await download(client, filepath, size, crc, mode):
+        print(f"File downloaded from ESP32! ({size} bytes)")
+
+# --- Partition dump ---
+async def dump_partition(client, label, filepath, mode="notify"):
+    try:
+        size, crc = await select_source(client, f"DUMP {label}")
+    except RuntimeError as e:
+        print(f"Dump failed: {e}")
+        return
+
+    print(f"Dumping partition {label} ({size} bytes)...")
+    ok = await download(client, filepath, size, crc, mode)
+    await client.write_gatt_char(CTRL_CHAR_UUID, b"FILE")
+    if ok:
+        print(f"Partition {label} saved to {filepath} ({size} bytes)")
+
+# --- Storage backend / benchmark ---
+async def select_store(client, backend):
+    await client.write_gatt_char(CTRL_CHAR_UUID, f"STORE {backend}".encode())
+    rsp = (await client.read_gatt_char(CTRL_CHAR_UUID)).decode()
+    print(f"Storage backend: {rsp}")
+
+async def run_bench(size_kb):
+    async with connect() as client:
+        await client.write_gatt_char(CTRL_CHAR_UUID, f"BENCH {size_kb}".encode())
+        while True:
+            await asyncio.sleep(1)
+            await client.write_gatt_char(CTRL_CHAR_UUID, b"BENCH")
+            rsp = (await client.read_gatt_char(CTRL_CHAR_UUID)).decode()
+            if rsp != "RUNNING":
+                break
+        # e.g. "64KB spiffs mnt=120 w=40 r=350 ops=25 rawlog mnt=2 w=120 r=900"
+        # (mount in ms, throughput in KB/s, small-file ops/s)
+        print(f"Storage benchmark: {rsp}")
+
+async def run_fs(fs_type):
+    async with connect() as client:
+        await client.write_gatt_char(CTRL_CHAR_UUID, f"FS {fs_type}".encode())
+        rsp = (await client.read_gatt_char(CTRL_CHAR_UUID)).decode()
+        print(f"File system: {rsp}")
+
+# --- Telemetry ---
+# Mirrors telemetry_t in main/include/telemetry.h
+TELEMETRY_FMT = "<BBBBHHIIIIIIHHIII16I16I"
+TELEMETRY_FIELDS = ("version", "tx_phy", "rx_phy", "reserved", "mtu",
+                    "conn_itvl", "session", "bytes_in", "bytes_out",
+                    "chunks_in", "chunks_out", "retransmits", "queue_depth",
+                    "queue_peak", "gc_slices", "gc_max_us", "write_stalls")
+
+def parse_telemetry(data):
+    values = struct.unpack(TELEMETRY_FMT, data[:struct.calcsize(TELEMETRY_FMT)])
+    n = len(TELEMETRY_FIELDS)
+    t = dict(zip(TELEMETRY_FIELDS, values[:n]))
+    t["write_hist"] = list(values[n:n + 16])
+    t["erase_hist"] = list(values[n + 16:n + 32])
+    return t
+
+def format_hist(hist):
+    # Bucket i holds latencies in [2^i, 2^(i+1)) us
+    return " ".join(f"{1 << i}us:{c}" for i, c in enumerate(hist) if c)
+
+async def run_telemetry():
+    async with connect() as client:
+        t = parse_telemetry(await client.read_gatt_char(TELEMETRY_CHAR_UUID))
+        print(f"session {t['session']}: mtu={t['mtu']} "
+              f"itvl={t['conn_itvl'] * 1.25:.2f}ms phy={t['tx_phy']}/{t['rx_phy']}")
+        print(f"  in:  {t['bytes_in']} bytes / {t['chunks_in']} chunks")
+        print(f"  out: {t['bytes_out']} bytes / {t['chunks_out']} chunks, "
+              f"{t['retransmits']} retransmits")
+        print(f"  queue: {t['queue_depth']} (peak {t['queue_peak']})")
+        print(f"  gc: {t['gc_slices']} slices, max {t['gc_max_us']}us, "
+              f"{t['write_stalls']} write stalls")
+        print(f"  flash write: {format_hist(t['write_hist'])}")
+        print(f"  flash erase: {format_hist(t['erase_hist'])}")
+
+# --- Task / heap stats ---
+# Mirrors sys_stats_t in main/include/sys_stats.h
+STATS_HDR_FMT = "<BBBBII" + "III" * 2
+STATS_TASK_FMT = "<12sBBHH"
+TASK_STATES = ("running", "ready", "blocked", "suspended", "deleted")
 
+async def run_stats():
+    async with connect() as client:
+        data = await client.read_gatt_char(STATS_CHAR_UUID)
+
+    hdr_size = struct.calcsize(STATS_HDR_FMT)
+    (_, count, cores, _, uptime_ms, period_ms,
+     i_free, i_largest, i_min, d_free, d_largest, d_min) = \
+        struct.unpack(STATS_HDR_FMT, data[:hdr_size])
+    print(f"uptime {uptime_ms / 1000:.1f}s, {cores} cores, "
+          f"CPU over the last {period_ms} ms")
+    print(f"heap internal: free={i_free} largest={i_largest} min={i_min}")
+    print(f"heap dma:      free={d_free} largest={d_largest} min={d_min}")
+    print(f"{'task':<13}{'prio':>5}  {'state':<10}{'cpu%':>6}{'stack free':>12}")
+    for name, prio, state, permille, stack_free in struct.iter_unpack(
+            STATS_TASK_FMT, data[hdr_size:hdr_size + count * struct.calcsize(STATS_TASK_FMT)]):
+        name = name.split(b"\0")[0].decode(errors="replace")
+        state = TASK_STATES[state] if state < len(TASK_STATES) else str(state)
+        print(f"{name:<13}{prio:>5}  {state:<10}{permille / 10:>6.1f}{stack_free:>12}")
+
+# --- Memory read source (TRACE, LAT) ---
+async def read_memory(client, size):
+    data = bytearray()
+    while len(data) < size:
+        await client.write_gatt_char(OFFSET_CHAR_UUID, len(data).to_bytes(4, byteorder='little'))
+        chunk = await client.read_gatt_char(FILE_RW_CHAR_UUID)
+        if not chunk:
+            break
         data.extend(chunk)
-        print(f"Read {len(chunk)} bytes at offset {offset}")
+    await client.write_gatt_char(CTRL_CHAR_UUID, b"FILE")
+    return bytes(data[:size])
 
-        if len(chunk) < CHUNK_SIZE:
-            break  # Last chunk
+# --- Upload latency ---
+# (name, from column, to column); columns are us relative to rx, -1 = not reached
+LAT_STAGES = (("host (rx->enq)", "rx", "enq"),
+              ("ack (rx->ack)", "rx", "ack"),
+              ("queue (enq->deq)", "enq", "deq"),
+              ("flash (wr_start->wr_end)", "wr_start", "wr_end"),
+              ("total (rx->wr_end)", "rx", "wr_end"))
 
-        offset += len(chunk)
+def percentile(values, p):
+    values = sorted(values)
+    return values[min(len(values) - 1, int(len(values) * p / 100))]
 
-    with open(filepath, "wb") as f:
-        f.write(data)
-    print(f"File downloaded from ESP32! ({len(data)} bytes)")
+def summarize_latency(csv_text):
+    lines = csv_text.strip().splitlines()
+    header = lines[0].split(",")
+    rows = [dict(zip(header, map(int, line.split(",")))) for line in lines[1:]]
+    if not rows:
+        print("No upload chunks recorded")
+        return
+    for row in rows:
+        row["rx_abs"], row["rx"] = row["rx"], 0
+
+    print(f"{len(rows)} chunks, {sum(r['len'] for r in rows)} bytes, "
+          f"max queue depth {max(r['depth'] for r in rows)}")
+    print(f"{'stage':<26}{'p50':>9}{'p95':>9}{'max':>9}  (us)")
+    for name, a, b in LAT_STAGES:
+        d = [r[b] - r[a] for r in rows if r[a] >= 0 and r[b] >= 0]
+        if d:
+            print(f"{name:<26}{percentile(d, 50):>9}{percentile(d, 95):>9}{max(d):>9}")
+
+    # Gaps between chunk arrivals are time spent on the radio / in the client
+    gaps = [(b["rx_abs"] - a["rx_abs"]) & 0xFFFFFFFF for a, b in zip(rows, rows[1:])]
+    if gaps:
+        print(f"{'radio (rx->next rx)':<26}{percentile(gaps, 50):>9}"
+              f"{percentile(gaps, 95):>9}{max(gaps):>9}")
+
+async def run_latency(filepath):
+    async with connect() as client:
+        await client.write_gatt_char(CTRL_CHAR_UUID, b"LAT")
+        rsp = (await client.read_gatt_char(CTRL_CHAR_UUID)).decode()
+        if not rsp.startswith("OK"):
+            print(f"Latency export failed: {rsp}")
+            return
+        csv_text = (await read_memory(client, int(rsp.split()[1]))).decode()
+
+    with open(filepath, "w") as f:
+        f.write(csv_text)
+    print(f"Latency trace saved to {filepath}")
+    summarize_latency(csv_text)
+
+# --- Binary trace ---
+# Mirrors trace_id_t / trace_entry_t in main/include/trace.h
+TRACE_NAMES = ("none", "connect", "disconnect", "conn_update", "mtu", "phy",
+               "upload_begin", "upload_chunk", "upload_end", "read",
+               "read_offset", "ota_begin", "ota_chunk", "ota_end")
+TRACE_ENTRY_FMT = "<IHHII"
+
+async def run_trace():
+    async with connect() as client:
+        await client.write_gatt_char(CTRL_CHAR_UUID, b"TRACE")
+        rsp = (await client.read_gatt_char(CTRL_CHAR_UUID)).decode()
+        if not rsp.startswith("OK"):
+            print(f"Trace failed: {rsp}")
+            return
+        _, count, entry_size = rsp.split()
+        size = int(count) * int(entry_size)
+        data = await read_memory(client, size)
+
+    first_ts = None
+    for ts, ev, seq, a0, a1 in struct.iter_unpack(TRACE_ENTRY_FMT, bytes(data[:size])):
+        first_ts = ts if first_ts is None else first_ts
+        name = TRACE_NAMES[ev] if ev < len(TRACE_NAMES) else f"#{ev}"
+        print(f"{seq:5} +{(ts - first_ts) & 0xFFFFFFFF:10}us {name:<12} {a0} {a1}")
+
+# --- Fleet OTA ---
+FLEET_CONCURRENCY = 4
+FLEET_RETRIES = 2
+
+class FleetDevice:
+    def __init__(self, address, adapter):
+        self.address = address
+        self.adapter = adapter
+        self.image = None        # sha256 reported by INFO before the update
+        self.result = "pending"
+        self.attempts = 0
+        self.upload_s = 0.0
+        self.kib_s = 0.0
+        self.total_s = 0.0
+        self.error = ""
+
+def image_sha256(image):
+    return hashlib.sha256(image[:-32]).hexdigest()
+
+async def device_info(client):
+    """(partition, version, sha256) of the running image, see INFO."""
+    await client.write_gatt_char(CTRL_CHAR_UUID, b"INFO")
+    rsp = (await client.read_gatt_char(CTRL_CHAR_UUID)).decode()
+    if not rsp.startswith("OK"):
+        raise RuntimeError(f"INFO failed: {rsp}")
+    _, label, version, image = rsp.split()
+    return label, version, image
+
+class PayloadCache:
+    """Payload per (running image, target image) pair, built once.
+
+    The firmware only takes plain images (no delta patching or
+    decompression on the device), so every pair maps to the target image
+    itself; the cache still keeps it to one read per pair."""
+
+    def __init__(self, image_path):
+        self.image_path = image_path
+        self.payloads = {}
+
+    def get(self, source, target):
+        if (source, target) not in self.payloads:
+            with open(self.image_path, "rb") as f:
+                self.payloads[(source, target)] = f.read()
+        return self.payloads[(source, target)]
+
+async def fleet_update(dev, target, cache, limit, connect_locks, inflight):
+    start = time.monotonic()
+
+    async def open_link():
+        # BlueZ connects to one device at a time per adapter
+        async with connect_locks[dev.adapter]:
+            client = connect(dev.address, dev.adapter)
+            await client.__aenter__()
+        return client
+
+    async with limit:
+        while dev.attempts <= FLEET_RETRIES:
+            dev.attempts += 1
+            try:
+                client = await open_link()
+                try:
+                    _, _, image = await device_info(client)
+                    dev.image = dev.image or image
+                    if image == target:
+                        # Done earlier, e.g. before a lost OTA_END response
+                        dev.result = "updated" if dev.attempts > 1 else "current"
+                        break
+                    payload = cache.get(image, target)
+                    chunk_size, n = upload_mode(client, inflight)
+                    progress = Progress(len(payload), dev.address, quiet=True)
+                    await send_stream(client, io.BytesIO(payload), chunk_size, n, progress)
+                    dev.upload_s = progress.elapsed()
+                    dev.kib_s = len(payload) / 1024 / max(dev.upload_s, 1e-6)
+                    await send_ota_end(client, quiet=True)
+                finally:
+                    await client.__aexit__(None, None, None)
+
+                # Check the new image booted; the OTA session does not survive
+                # a reconnect, so a failed attempt restarts from the beginning
+                await asyncio.sleep(connect.reboot_wait)
+                client = await open_link()
+                try:
+                    _, _, image = await device_info(client)
+                finally:
+                    await client.__aexit__(None, None, None)
+                if image != target:
+                    raise RuntimeError(f"still running {image[:12]}")
+                dev.result = "updated"
+                break
+            except Exception as e:
+                dev.error = str(e) or type(e).__name__
+                dev.result = "failed"
+                await asyncio.sleep(min(2 ** dev.attempts, 10) * connect.reboot_wait)
+    dev.total_s = time.monotonic() - start
+
+async def run_fleet(image_path, adapters, concurrency, inflight, scan_s):
+    with open(image_path, "rb") as f:
+        # What INFO reports: the digest appended to the image, which
+        # covers everything before it
+        target = image_sha256(f.read())
+    start = time.monotonic()
+
+    seen = {}    # address -> adapters that saw it, in scan order
+    for adapter in adapters:
+        for address in await connect.scan(scan_s, adapter):
+            seen.setdefault(address, []).append(adapter)
+    if not seen:
+        print("No devices found")
+        return
+    # Spread the devices over the adapters that can see them, least loaded first
+    load = {a: 0 for a in adapters}
+    devices = {}
+    for address, candidates in seen.items():
+        adapter = min(candidates, key=lambda a: load[a])
+        load[adapter] += 1
+        devices[address] = FleetDevice(address, adapter)
+    print(f"Found {len(devices)} devices, target image {target[:12]}")
+
+    cache = PayloadCache(image_path)
+    limit = asyncio.Semaphore(concurrency)
+    connect_locks = {a: asyncio.Lock() for a in adapters}
+    await asyncio.gather(*(fleet_update(d, target, cache, limit, connect_locks, inflight)
+                           for d in devices.values()))
+
+    groups = {}
+    for dev in devices.values():
+        groups.setdefault(dev.image or "unknown", []).append(dev)
+    print(f"{'device':<20}{'adapter':<9}{'from':<14}{'result':<9}{'tries':>6}"
+          f"{'upload s':>10}{'KiB/s':>8}{'total s':>9}")
+    for image, group in sorted(groups.items()):
+        for d in group:
+            print(f"{d.address:<20}{d.adapter or '-':<9}{image[:12]:<14}{d.result:<9}"
+                  f"{d.attempts:>6}{d.upload_s:>10.2f}{d.kib_s:>8.1f}{d.total_s:>9.2f}"
+                  + (f"  {d.error}" if d.result == "failed" else ""))
+
+    count = {r: sum(d.result == r for d in devices.values())
+             for r in ("updated", "current", "failed")}
+    print(f"FLEET devices={len(devices)} groups={len(groups)} updated={count['updated']} "
+          f"current={count['current']} failed={count['failed']} "
+          f"payloads={len(cache.payloads)} seconds={time.monotonic() - start:.2f}")
+
+async def run_dump(label, filepath, mode):
+    async with connect() as client:
+        await dump_partition(client, label, filepath, mode)
 
 # --- Main ---
-async def run(upload_path):
+async def run(upload_path, store=None, inflight=UPLOAD_INFLIGHT, mode="notify"):
     download_path = f"downloaded_{os.path.basename(upload_path)}"
 
-    async with BleakClient(DEVICE_ADDRESS) as client:
-        await write_file(client, upload_path)
+    async with connect() as client:
+        if store:
+            await select_store(client, store)
+        if not await write_file(client, upload_path, inflight):
+            return
 
         # Skip reading if it's a .bin file
         if upload_path.lower().endswith(".bin"):
@@ -69,20 +590,108 @@ async def run(upload_path):
             return
 
         try:
-            await read_file(client, download_path)
+            await read_file(client, download_path, mode)
         except Exception as e:
             print(f"Skipping read step due to error: {e}")
 
 if __name__ == "__main__":
+    connect, argv = parse_transport_args(sys.argv[1:])
+    sys.argv[1:] = argv
+
     if len(sys.argv) < 2:
-        print("Usage: python esp32_ble_rw.py <file_to_upload>")
+        print(f"Usage: python esp32_ble_rw.py [transport] <command>, transport is {TRANSPORT_USAGE}")
+        print("       python esp32_ble_rw.py [--store spiffs|littlefs|rawlog] [--inflight N] [--download notify|read] <file_to_upload>")
+        print("       python esp32_ble_rw.py --dump [--download notify|read] <partition_label> [output_file]")
+        print("       python esp32_ble_rw.py --fleet [--adapters hci0,hci1] [--concurrency N] [--inflight N] <image.bin>")
+        print("       python esp32_ble_rw.py --bench [size_kb]")
+        print("       python esp32_ble_rw.py --fs spiffs|littlefs")
+        print("       python esp32_ble_rw.py --telemetry")
+        print("       python esp32_ble_rw.py --stats")
+        print("       python esp32_ble_rw.py --trace")
+        print("       python esp32_ble_rw.py --latency [output.csv]")
+        sys.exit(1)
+
+    if sys.argv[1] == "--dump":
+        args = sys.argv[2:]
+        mode = "notify"
+        if len(args) > 2 and args[0] == "--download":
+            mode = args[1]
+            args = args[2:]
+        if not args or mode not in DOWNLOAD_MODES:
+            print("Missing partition label, e.g. ota_0, ota_1 or spiffs")
+            sys.exit(1)
+        label = args[0]
+        out = args[1] if len(args) > 1 else f"{label}.bin"
+        asyncio.run(run_dump(label, out, mode))
+        sys.exit(0)
+
+    if sys.argv[1] == "--fleet":
+        args = sys.argv[2:]
+        adapters, concurrency, inflight = [None], FLEET_CONCURRENCY, UPLOAD_INFLIGHT
+        while len(args) > 2 and args[0] in ("--adapters", "--concurrency", "--inflight"):
+            if args[0] == "--adapters":
+                adapters = args[1].split(",")
+            elif args[0] == "--concurrency":
+                concurrency = max(1, int(args[1]))
+            else:
+                inflight = max(1, int(args[1]))
+            args = args[2:]
+        if not args or not os.path.isfile(args[0]):
+            print("Missing OTA image")
+            sys.exit(1)
+        asyncio.run(run_fleet(args[0], adapters, concurrency, inflight, 5.0))
+        sys.exit(0)
+
+    if sys.argv[1] == "--bench":
+        size_kb = int(sys.argv[2]) if len(sys.argv) > 2 else 64
+        asyncio.run(run_bench(size_kb))
+        sys.exit(0)
+
+    if sys.argv[1] == "--latency":
+        out = sys.argv[2] if len(sys.argv) > 2 else "latency.csv"
+        asyncio.run(run_latency(out))
+        sys.exit(0)
+
+    if sys.argv[1] == "--trace":
+        asyncio.run(run_trace())
+        sys.exit(0)
+
+    if sys.argv[1] == "--stats":
+        asyncio.run(run_stats())
+        sys.exit(0)
+
+    if sys.argv[1] == "--telemetry":
+        asyncio.run(run_telemetry())
+        sys.exit(0)
+
+    if sys.argv[1] == "--fs":
+        if len(sys.argv) < 3:
+            print("Missing file system type, e.g. spiffs or littlefs")
+            sys.exit(1)
+        asyncio.run(run_fs(sys.argv[2]))
+        sys.exit(0)
+
+    store = None
+    inflight = UPLOAD_INFLIGHT
+    mode = "notify"
+    args = sys.argv[1:]
+    while len(args) > 2 and args[0] in ("--store", "--inflight", "--download"):
+        if args[0] == "--store":
+            store = args[1]
+        elif args[0] == "--download":
+            mode = args[1]
+        else:
+            inflight = max(1, int(args[1]))
+        args = args[2:]
+    if mode not in DOWNLOAD_MODES:
+        print(f"--download is one of {', '.join(DOWNLOAD_MODES)}")
         sys.exit(1)
 
-    filepath = sys.argv[1]
+    filepath = args[0]
 
     if not os.path.isfile(filepath):
         print(f"File not found: {filepath}")
         sys.exit(1)
 
-    asyncio.run(run(filepath))
+    asyncio.run(run(filepath, store, inflight, mode))
 